@@ -26,6 +26,10 @@ static DWORD WINAPI searchCompactBiomesThread(LPVOID data)
     LayerStack g = setupGenerator(MC_1_14);
     int *cache = allocCache(&g.layers[L_VORONOI_ZOOM_1], w, h);
 
+    // the structure checks for a seed share most of the continental layers
+    if (setupTileCache(&g, 4, 256))
+        enableTileCache(&g, L_DEEP_OCEAN_256);
+
     for (s = info.seedStart; s != info.seedEnd; s++)
     {
         if (checkForBiomes(&g, cache, s, ax, az, w, h, info.filter, info.minscale))
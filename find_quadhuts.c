@@ -65,6 +65,7 @@ int main(int argc, char *argv[])
         g = setupGenerator(MC_1_7);
         // Use the 1.13 Hills layer to get the correct modified biomes.
         g.layers[L_HILLS_64].getMap = mapHills113;
+        setLayerInfo(&g.layers[L_HILLS_64]);
     }
     else
     {
@@ -90,7 +91,6 @@ int main(int argc, char *argv[])
 
 
     Layer *lFilterBiome = &g.layers[L_BIOME_256];
-    int *biomeCache = allocCache(lFilterBiome, 3, 3);
 
 
     // Load the positions of the four structures that make up the quad-structure
@@ -182,9 +182,7 @@ int main(int argc, char *argv[])
 
             // Dismiss seeds that don't have a swamp near the quad temple.
             setWorldSeed(lFilterBiome, seed);
-            genArea(lFilterBiome, biomeCache, (regPosX<<1)+2, (regPosZ<<1)+2, 1, 1);
-
-            if (biomeCache[0] != swamp)
+            if (genPoint(lFilterBiome, (regPosX<<1)+2, (regPosZ<<1)+2) != swamp)
                 continue;
 
             applySeed(&g, seed);
@@ -198,7 +196,6 @@ int main(int argc, char *argv[])
         }
     }
 
-    free(biomeCache);
     freeGenerator(g);
 
     return 0;
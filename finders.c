@@ -944,11 +944,7 @@ int isTreasureChunk(int64_t seed, const int chunkX, const int chunkZ)
 
 int getBiomeAtPos(const LayerStack g, const Pos pos)
 {
-    int *map = allocCache(&g.layers[L_VORONOI_ZOOM_1], 1, 1);
-    genArea(&g.layers[L_VORONOI_ZOOM_1], map, pos.x, pos.z, 1, 1);
-    int biomeID = map[0];
-    free(map);
-    return biomeID;
+    return genPoint(&g.layers[L_VORONOI_ZOOM_1], pos.x, pos.z);
 }
 
 Pos findBiomePosition(
@@ -1047,8 +1043,6 @@ int areBiomesViable(
     int z2 = (posZ + radius) >> 2;
     int width = x2 - x1 + 1;
     int height = z2 - z1 + 1;
-    int i;
-    int *map;
 
     Layer *layer = &g.layers[L_RIVER_MIX_4];
 
@@ -1058,25 +1052,23 @@ int areBiomesViable(
                 layer->scale, L_RIVER_MIX_4);
     }
 
-    map = cache ? cache : allocCache(layer, width, height);
-    genArea(layer, map, x1, z1, width, height);
+    // the cache is deprecated: the memo of the check lives in the scratch
+    // memory of the generator, as its size depends on the whole layer graph
+    (void) cache;
 
-    for (i = 0; i < width*height; i++)
-    {
-        if (!isValid[ map[i] & 0xff ])
-        {
-            if (cache == NULL) free(map);
-            return 0;
-        }
-    }
-
-    if (cache == NULL) free(map);
-    return 1;
+    // most positions are rejected, so stop at the first invalid biome
+    return checkArea(layer, x1, z1, width, height, isValid);
 }
 
 
-int getBiomeRadius(
-        const int *         map,
+static inline int getMapCell(const void *map, int cellSize, int i)
+{
+    return cellSize == 1 ? ((const uint8_t *)map)[i] : ((const int *)map)[i];
+}
+
+static int findBiomeRadius(
+        const void *        map,
+        const int           cellSize,
         const int           mapSide,
         const int *         biomes,
         const int           bnum,
@@ -1098,10 +1090,10 @@ int getBiomeRadius(
     {
         for (i = radiusMax-r; i <= radiusMax+r; i++)
         {
-            blist[ map[(radiusMax-r) * mapSide+ i]    & mask ] = 1;
-            blist[ map[(radiusMax+r-1) * mapSide + i] & mask ] = 1;
-            blist[ map[mapSide*i + (radiusMax-r)]     & mask ] = 1;
-            blist[ map[mapSide*i + (radiusMax+r-1)]   & mask ] = 1;
+            blist[ getMapCell(map, cellSize, (radiusMax-r) * mapSide+ i)    & mask ] = 1;
+            blist[ getMapCell(map, cellSize, (radiusMax+r-1) * mapSide + i) & mask ] = 1;
+            blist[ getMapCell(map, cellSize, mapSide*i + (radiusMax-r))     & mask ] = 1;
+            blist[ getMapCell(map, cellSize, mapSide*i + (radiusMax+r-1))   & mask ] = 1;
         }
 
         for (b = 0; b < bnum && blist[biomes[b] & mask]; b++);
@@ -1114,6 +1106,26 @@ int getBiomeRadius(
     return r != radiusMax ? r : -1;
 }
 
+int getBiomeRadius(
+        const int *         map,
+        const int           mapSide,
+        const int *         biomes,
+        const int           bnum,
+        const int           ignoreMutations)
+{
+    return findBiomeRadius(map, sizeof(int), mapSide, biomes, bnum, ignoreMutations);
+}
+
+int getBiomeRadius8(
+        const uint8_t *     map,
+        const int           mapSide,
+        const int *         biomes,
+        const int           bnum,
+        const int           ignoreMutations)
+{
+    return findBiomeRadius(map, 1, mapSide, biomes, bnum, ignoreMutations);
+}
+
 
 
 //==============================================================================
@@ -1389,10 +1401,9 @@ Pos estimateSpawn(const int mcversion, LayerStack *g, int *cache, int64_t worldS
 int isViableFeaturePos(const int structureType, const LayerStack g, int *cache,
         const int blockX, const int blockZ)
 {
-    int *map = cache ? cache : allocCache(&g.layers[L_VORONOI_ZOOM_1], 1, 1);
-    genArea(&g.layers[L_VORONOI_ZOOM_1], map, blockX, blockZ, 1, 1);
-    int biomeID = map[0];
-    if (!cache) free(map);
+    int biomeID = genPoint(&g.layers[L_VORONOI_ZOOM_1], blockX, blockZ);
+
+    (void) cache;
 
     switch(structureType)
     {
@@ -1605,7 +1616,7 @@ int64_t filterAllTempCats(
     int64_t sidx, hits, seed;
     int types[9];
     int specialCnt;
-    int i, j;
+    int i;
 
     hits = 0;
 
@@ -1619,16 +1630,13 @@ int64_t filterAllTempCats(
         // tested for without going through the previous layers. (We'll get
         // false positives due to Oceans, but this works fine to rule out some
         // seeds early on.)
-        setWorldSeed(&layerSpecial, seed);
+        genChunkInts(processWorldSeed(seed, layerSpecial.baseSeed), types,
+                pX, pZ, sX, sZ, 13);
         specialCnt = 0;
-        for (i = 0; i < sX; i++)
+        for (i = 0; i < sX*sZ; i++)
         {
-            for (j = 0; j < sZ; j++)
-            {
-                setChunkSeed(&layerSpecial, (int64_t)(i+pX), (int64_t)(j+pZ));
-                if (mcNextInt(&layerSpecial, 13) == 0)
-                    specialCnt++;
-            }
+            if (types[i] == 0)
+                specialCnt++;
         }
 
         if (specialCnt < 3)
@@ -1708,84 +1716,100 @@ int64_t filterAllMajorBiomes(
         const unsigned int  sX,
         const unsigned int  sZ)
 {
-    Layer *lFilterMushroom = &g->layers[L_ADD_MUSHROOM_256];
-    Layer *lFilterBiomes = &g->layers[L_BIOME_256];
-
-    int *map;
-    int64_t sidx, seed, hits;
+    int *map, *lane;
+    int64_t sidx, hits;
     unsigned int i, id, hasAll;
+    int k, cnt, mask;
 
     int types[BIOME_NUM];
 
-    map = cache ? cache : allocCache(lFilterBiomes, sX, sZ);
+    // the maps of a batch of seeds do not fit into a buffer for one map
+    (void) cache;
+    map = (int *) malloc(SEED_LANES * sX*sZ * sizeof(int));
 
     hits = 0;
 
-    for (sidx = 0; sidx < seedCnt; sidx++)
+    for (sidx = 0; sidx < seedCnt; sidx += SEED_LANES)
     {
+        cnt = seedCnt - sidx < SEED_LANES ? (int)(seedCnt - sidx) : SEED_LANES;
+        mask = (1 << cnt) - 1;
+
         /* We can use the Mushroom layer both to check for mushroom_fields biomes
          * and to make sure all temperature categories are present in the area.
          */
-        seed = seedsIn[sidx];
-        setWorldSeed(lFilterMushroom, seed);
-        genArea(lFilterMushroom, map, pX,pZ, sX,sZ);
+        genAreaSeeds(g, L_ADD_MUSHROOM_256, seedsIn + sidx, mask, map, pX,pZ, sX,sZ);
 
-        memset(types, 0, sizeof(types));
-        for (i = 0; i < sX*sZ; i++)
+        for (k = 0; k < cnt; k++)
         {
-            id = map[i];
-            if (id >= BIOME_NUM) id = (id & 0xf) + 4;
-            types[id]++;
+            lane = map + k*sX*sZ;
+
+            memset(types, 0, sizeof(types));
+            for (i = 0; i < sX*sZ; i++)
+            {
+                id = lane[i];
+                if (id >= BIOME_NUM) id = (id & 0xf) + 4;
+                types[id]++;
+            }
+
+            if ( types[Ocean] < 1  || types[Warm] < 1     || types[Lush] < 1 ||
+             /* types[Cold] < 1   || */ types[Freezing] < 1 ||
+                types[Warm+4] < 1 || types[Lush+4] < 1   || types[Cold+4] < 1 ||
+                types[mushroom_fields] < 1)
+            {
+                mask &= ~(1 << k);
+            }
         }
 
-        if ( types[Ocean] < 1  || types[Warm] < 1     || types[Lush] < 1 ||
-         /* types[Cold] < 1   || */ types[Freezing] < 1 ||
-            types[Warm+4] < 1 || types[Lush+4] < 1   || types[Cold+4] < 1 ||
-            types[mushroom_fields] < 1)
-        {
+        if (mask == 0)
             continue;
-        }
 
         /***  Find all major biomes  ***/
 
-        setWorldSeed(lFilterBiomes, seed);
-        genArea(lFilterBiomes, map, pX,pZ, sX,sZ);
+        genAreaSeeds(g, L_BIOME_256, seedsIn + sidx, mask, map, pX,pZ, sX,sZ);
 
-        memset(types, 0, sizeof(types));
-        for (i = 0; i < sX*sZ; i++)
+        for (k = 0; k < cnt; k++)
         {
-            types[map[i]]++;
-        }
+            if (!((mask >> k) & 1))
+                continue;
 
-        hasAll = 1;
-        for (i = 0; i < sizeof(majorBiomes) / sizeof(*majorBiomes); i++)
-        {
-            // plains, taiga and deep_ocean can be generated in later layers.
-            // Also small islands of Forests can be generated in deep_ocean
-            // biomes, but we are going to ignore those.
-            if (majorBiomes[i] == plains ||
-                majorBiomes[i] == taiga ||
-                majorBiomes[i] == deep_ocean)
+            lane = map + k*sX*sZ;
+
+            memset(types, 0, sizeof(types));
+            for (i = 0; i < sX*sZ; i++)
             {
-                continue;
+                types[lane[i]]++;
             }
 
-            if (types[majorBiomes[i]] < 1)
+            hasAll = 1;
+            for (i = 0; i < sizeof(majorBiomes) / sizeof(*majorBiomes); i++)
             {
-                hasAll = 0;
-                break;
+                // plains, taiga and deep_ocean can be generated in later layers.
+                // Also small islands of Forests can be generated in deep_ocean
+                // biomes, but we are going to ignore those.
+                if (majorBiomes[i] == plains ||
+                    majorBiomes[i] == taiga ||
+                    majorBiomes[i] == deep_ocean)
+                {
+                    continue;
+                }
+
+                if (types[majorBiomes[i]] < 1)
+                {
+                    hasAll = 0;
+                    break;
+                }
+            }
+            if (!hasAll)
+            {
+                continue;
             }
-        }
-        if (!hasAll)
-        {
-            continue;
-        }
 
-        seedsOut[hits] = seed;
-        hits++;
+            seedsOut[hits] = seedsIn[sidx + k];
+            hits++;
+        }
     }
 
-    if (cache == NULL) free(map);
+    free(map);
     return hits;
 }
 
@@ -1923,8 +1947,6 @@ int64_t checkForBiomes(
     Layer *lbiomes = &g->layers[L14_BAMBOO_256];
     Layer *loceantemp = NULL;
 
-    int *map = cache ? cache : allocCache(&g->layers[L_VORONOI_ZOOM_1], width, height);
-
     uint64_t potential, required, modified;
     int64_t ss, cs;
     int id, types[0x100];
@@ -1932,6 +1954,11 @@ int64_t checkForBiomes(
     int areaX1024, areaZ1024, areaWidth1024, areaHeight1024;
     int areaX256, areaZ256, areaWidth256, areaHeight256;
     int areaX4, areaZ4, areaWidth4, areaHeight4;
+    int mapBuf[1024];
+    int *map;
+    size_t n;
+
+    (void) cache;
 
     // 1:1024 scale
     areaX1024 = blockX >> 10;
@@ -1945,6 +1972,22 @@ int64_t checkForBiomes(
     areaWidth256 = ((width-1) >> 8) + 2;
     areaHeight256 = ((height-1) >> 8) + 2;
 
+    // 1:4 scale
+    areaX4 = blockX >> 2;
+    areaZ4 = blockZ >> 2;
+    areaWidth4 = ((width-1) >> 2) + 2;
+    areaHeight4 = ((height-1) >> 2) + 2;
+
+    // the maps of all scales share one buffer, which is sized for the
+    // largest of them, as they can exceed the block area for small areas
+    n = (size_t)areaWidth4 * areaHeight4;
+    if ((size_t)areaWidth256 * areaHeight256 > n)
+        n = (size_t)areaWidth256 * areaHeight256;
+    if ((size_t)areaWidth1024 * areaHeight1024 > n)
+        n = (size_t)areaWidth1024 * areaHeight1024;
+
+    map = n <= sizeof(mapBuf) / sizeof(*mapBuf) ? mapBuf : (int *) malloc(n * sizeof(int));
+
 
     /*** BIOME CHECKS THAT DON'T NEED OTHER LAYERS ***/
 
@@ -1954,15 +1997,11 @@ int64_t checkForBiomes(
     {
         ss = processWorldSeed(seed, lspecial->baseSeed);
 
+        genChunkInts(ss, map, areaX1024, areaZ1024, areaWidth1024, areaHeight1024, 13);
+
         types[0] = types[1] = 0;
-        for (z = 0; z < areaHeight1024; z++)
-        {
-            for (x = 0; x < areaWidth1024; x++)
-            {
-                cs = getChunkSeed(ss, (int64_t)(x + areaX1024), (int64_t)(z + areaZ1024));
-                types[(cs >> 24) % 13 == 0]++;
-            }
-        }
+        for (i = 0; i < areaWidth1024 * areaHeight1024; i++)
+            types[map[i] == 0]++;
 
         if (types[0] < filter.tempNormal || types[1] < filter.tempSpecial)
         {
@@ -1975,15 +2014,13 @@ int64_t checkForBiomes(
     {
         ss = processWorldSeed(seed, lmushroom->baseSeed);
 
-        for (z = 0; z < areaHeight256; z++)
+        genChunkInts(ss, map, areaX256, areaZ256, areaWidth256, areaHeight256, 100);
+
+        for (i = 0; i < areaWidth256 * areaHeight256; i++)
         {
-            for (x = 0; x < areaWidth256; x++)
+            if (map[i] == 0)
             {
-                cs = getChunkSeed(ss, (int64_t)(x + areaX256), (int64_t)(z + areaZ256));
-                if ((cs >> 24) % 100 == 0)
-                {
-                    goto after_protomushroom;
-                }
+                goto after_protomushroom;
             }
         }
 
@@ -2171,12 +2208,6 @@ int64_t checkForBiomes(
 
     if (filter.doScale4Check)
     {
-        // 1:4 scale
-        areaX4 = blockX >> 2;
-        areaZ4 = blockZ >> 2;
-        areaWidth4 = ((width-1) >> 2) + 2;
-        areaHeight4 = ((height-1) >> 2) + 2;
-
         applySeed(g, seed);
         if (filter.doOceanTypeCheck)
             genArea(&g->layers[L13_OCEAN_MIX_4], map, areaX4, areaZ4, areaWidth4, areaHeight4);
@@ -2216,7 +2247,7 @@ int64_t checkForBiomes(
         ret = 0;
     }
 
-    if (cache == NULL) free(map);
+    if (map != mapBuf) free(map);
 
     return ret;
 }
@@ -319,10 +319,12 @@ Pos findBiomePosition(
 /* Determines if the given area contains only biomes specified by 'biomeList'.
  * This function is used to determine the positions of villages, ocean monuments
  * and mansions.
- * Warning: accurate, but slow!
+ * The check stops at the first biome that is not valid (see checkArea()).
  *
  * @g          : generator layer stack
- * @cache      : biome buffer, set to NULL for temporary allocation
+ * @cache      : unused (deprecated), pass NULL or any buffer; the entries
+ *               are memoized in the scratch memory of the generator instead,
+ *               which grows as needed and is released by freeGenerator()
  * @posX, posZ : centre for the check
  * @radius     : 'radius' of the check area
  * @isValid    : boolean array of valid biome ids (size = 256)
@@ -356,6 +358,14 @@ int getBiomeRadius(
         const int       bnum,
         const int       ignoreMutations);
 
+/* Like getBiomeRadius() for a map of 8-bit biome IDs, see genArea8(). */
+int getBiomeRadius8(
+        const uint8_t * map,
+        const int       mapSide,
+        const int *     biomes,
+        const int       bnum,
+        const int       ignoreMutations);
+
 
 
 //==============================================================================
@@ -441,7 +451,9 @@ Pos estimateSpawn(const int mcversion, LayerStack *g, int *cache, int64_t worldS
  * the block positions using the appropriate getXXXPos() function.
  *
  * @g              : generator layer stack [set seed using applySeed()]
- * @cache          : biome buffer, set to NULL for temporary allocation
+ * @cache          : unused (deprecated), pass NULL or any buffer; the check
+ *                   uses the scratch memory of the generator instead, see
+ *                   areBiomesViable()
  * @blockX, blockZ : block coordinates
  *
  * In the case of isViableFeaturePos() the 'type' argument specifies the type of
@@ -527,10 +539,13 @@ int64_t filterAllTempCats(
 
 /* Looks through the list of seeds in 'seedsIn' and copies those that have all
  * major overworld biomes in the specified area into 'seedsOut'. These checks
- * are done at a scale of 1:256.
+ * are done at a scale of 1:256, for SEED_LANES seeds at a time (see
+ * genAreaSeeds()).
  *
  * @g           : generator layer stack, (NOTE: seed will be modified)
- * @cache       : biome buffer, set to NULL for temporary allocation
+ * @cache       : unused (deprecated), pass NULL or any buffer; the maps of a
+ *                batch of seeds are allocated internally instead and freed
+ *                before the function returns
  * @seedsIn     : list of seeds to check
  * @seedsOut    : output buffer for the candidate seeds
  * @seedCnt     : number of seeds in 'seedsIn'
@@ -559,6 +574,10 @@ BiomeFilter setupBiomeFilter(const int *biomeList, int listLen);
  * this seed within the specified area. The smallest layer scale checked is
  * given by 'minscale'. Lowering this value terminate the search earlier and
  * yield more false positives.
+ * The 'cache' argument is unused (deprecated) and may be NULL or any buffer:
+ * the maps of the coarse scales do not fit into a buffer for the block area,
+ * so they are kept on the stack, or in a temporary allocation for large
+ * areas, instead.
  */
 int64_t checkForBiomes(
         LayerStack *        g,
@@ -4,16 +4,21 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+
+#ifdef _WIN32
+#include <Windows.h>
+typedef HANDLE thread_id_t;
+#else
+#define USE_PTHREAD
+#include <pthread.h>
+typedef pthread_t thread_id_t;
+#endif
 
 
 void setupLayer(int scale, Layer *l, Layer *p, int s, void (*getMap)(Layer *layer, int *out, int x, int z, int w, int h))
 {
-    setBaseSeed(l, s);
-    l->scale = scale;
-    l->p = p;
-    l->p2 = NULL;
-    l->getMap = getMap;
-    l->oceanRnd = NULL;
+    setupMultiLayer(scale, l, p, NULL, s, getMap);
 }
 
 void setupMultiLayer(int scale, Layer *l, Layer *p1, Layer *p2, int s, void (*getMap)(Layer *layer, int *out, int x, int z, int w, int h))
@@ -24,6 +29,15 @@ void setupMultiLayer(int scale, Layer *l, Layer *p1, Layer *p2, int s, void (*ge
     l->p2 = p2;
     l->getMap = getMap;
     l->oceanRnd = NULL;
+    setLayerInfo(l);
+    l->arena = NULL;
+    l->tiles = NULL;
+    l->data = NULL;
+    l->areaX = l->areaZ = l->areaW = l->areaH = 0;
+    l->valid = 0;
+    l->refs = 0;
+    l->slot = -1;
+    l->next = NULL;
 }
 
 
@@ -38,7 +52,10 @@ LayerStack setupGenerator(const int mcversion)
     LayerStack g;
     g.layerCnt = L_NUM;
     g.layers = (Layer *) calloc(g.layerCnt, sizeof(Layer));
+    g.arena = (LayerArena *) calloc(1, sizeof(LayerArena));
+    g.tiles = NULL;
     Layer *l = g.layers;
+    int i;
 
     //        SCALE  LAYER                      PARENT                      SEED  LAYER_FUNCTION
     setupLayer(4096, &l[L_ISLAND_4096],         NULL,                       1,    mapIsland);
@@ -113,6 +130,7 @@ LayerStack setupGenerator(const int mcversion)
         // ocean variants
         setupLayer(256, &l[L13_OCEAN_TEMP_256], NULL,                       2,    mapOceanTemp);
         l[L13_OCEAN_TEMP_256].oceanRnd = (OceanRnd *) malloc(sizeof(OceanRnd));
+        l[L13_OCEAN_TEMP_256].oceanRnd->init = 0;
         setupLayer(128, &l[L13_ZOOM_128],       &l[L13_OCEAN_TEMP_256],     2001, mapZoom);
         setupLayer(64,  &l[L13_ZOOM_64],        &l[L13_ZOOM_128],           2002, mapZoom);
         setupLayer(32,  &l[L13_ZOOM_32],        &l[L13_ZOOM_64],            2003, mapZoom);
@@ -125,6 +143,10 @@ LayerStack setupGenerator(const int mcversion)
         setupLayer(1,   &l[L_VORONOI_ZOOM_1],   &l[L13_OCEAN_MIX_4],        10,   mapVoronoiZoom);
     }
 
+    // all layers share the scratch memory of the generator
+    for (i = 0; i < g.layerCnt; i++)
+        l[i].arena = g.arena;
+
     return g;
 }
 
@@ -139,55 +161,54 @@ void freeGenerator(LayerStack g)
     }
 
     free(g.layers);
+
+    if (g.arena != NULL)
+    {
+        free(g.arena->mem);
+        free(g.arena);
+    }
+
+    if (g.tiles != NULL)
+    {
+        free(g.tiles->slots);
+        free(g.tiles->data);
+        free(g.tiles);
+    }
 }
 
 
-/* Recursively calculates the minimum buffer size required to generate an area
- * of the specified size from the current layer onwards.
+/* Finds the largest dimensions of the areas that the layer and its ancestors
+ * cover when an area of size 'w' by 'h' is requested, for any alignment.
  */
-static void getMaxArea(Layer *layer, int areaX, int areaZ, int *maxX, int *maxZ)
+static void getMaxArea(const Layer *l, int w, int h, int *maxW, int *maxH)
 {
-    if (layer == NULL)
+    if (l == NULL)
         return;
 
-    if (layer->getMap == mapZoom)
-    {
-        areaX = (areaX >> 1) + 2;
-        areaZ = (areaZ >> 1) + 2;
-    }
-    else if (layer->getMap == mapVoronoiZoom)
-    {
-        areaX = (areaX >> 2) + 2;
-        areaZ = (areaZ >> 2) + 2;
-    }
-    else if (layer->getMap == mapOceanMix)
+    if (w > *maxW) *maxW = w;
+    if (h > *maxH) *maxH = h;
+
+    if (l->zoom == 1)
     {
-        areaX += 17;
-        areaZ += 17;
+        getMaxArea(l->p, w + 2*l->edge, h + 2*l->edge, maxW, maxH);
+        getMaxArea(l->p2, w + 2*l->edge2, h + 2*l->edge2, maxW, maxH);
     }
     else
     {
-        if (layer->getMap != mapNull &&
-            layer->getMap != mapSkip &&
-            layer->getMap != mapIsland &&
-            layer->getMap != mapSpecial &&
-            layer->getMap != mapBiome &&
-            layer->getMap != mapRiverInit &&
-            layer->getMap != mapRiverMix &&
-            layer->getMap != mapOceanTemp)
-        {
-            areaX += 2;
-            areaZ += 2;
-        }
+        // an unaligned area touches one more parent entry
+        const int s = l->zoom == 4 ? 2 : 1;
+        getMaxArea(l->p, ((w-1) >> s) + 2 + l->edge, ((h-1) >> s) + 2 + l->edge,
+                maxW, maxH);
+        getMaxArea(l->p2, ((w-1) >> s) + 2 + l->edge2, ((h-1) >> s) + 2 + l->edge2,
+                maxW, maxH);
     }
-
-    if (areaX > *maxX) *maxX = areaX;
-    if (areaZ > *maxZ) *maxZ = areaZ;
-
-    getMaxArea(layer->p, areaX, areaZ, maxX, maxZ);
-    getMaxArea(layer->p2, areaX, areaZ, maxX, maxZ);
 }
 
+/* The generator itself only writes the requested area to the buffer, but
+ * callers may reuse it for the areas of the ancestors of the layer, which can
+ * be larger for small or thin areas. The buffer is therefore padded to the
+ * largest area of any layer that the request involves.
+ */
 int calcRequiredBuf(Layer *layer, int areaX, int areaZ)
 {
     int maxX = areaX, maxZ = areaZ;
@@ -206,20 +227,1544 @@ int *allocCache(Layer *layer, int sizeX, int sizeZ)
     return ret;
 }
 
+uint8_t *allocCache8(Layer *layer, int sizeX, int sizeZ)
+{
+    return (uint8_t *) calloc(calcRequiredBuf(layer, sizeX, sizeZ), sizeof(uint8_t));
+}
+
+uint16_t *allocCache16(Layer *layer, int sizeX, int sizeZ)
+{
+    return (uint16_t *) calloc(calcRequiredBuf(layer, sizeX, sizeZ), sizeof(uint16_t));
+}
+
+
+int setupTileCache(LayerStack *g, int tileShift, int tileCnt)
+{
+    TileCache *tc;
+    int setCnt = tileCnt / TILE_WAYS;
+
+    if (g->tiles != NULL || tileShift < 0 || tileShift > 12 || setCnt <= 0)
+        return 0;
+
+    tc = (TileCache *) calloc(1, sizeof(TileCache));
+    if (tc == NULL)
+        return 0;
+
+    tc->tileShift = tileShift;
+    tc->setCnt = setCnt;
+    tc->epoch = 1;
+    tc->epoch48 = 1;
+    tc->slots = (TileSlot *) calloc(setCnt * TILE_WAYS, sizeof(TileSlot));
+    tc->data = (int *) malloc((size_t)setCnt * TILE_WAYS *
+            (sizeof(int) << (2*tileShift)));
+
+    if (tc->slots == NULL || tc->data == NULL)
+    {
+        free(tc->slots);
+        free(tc->data);
+        free(tc);
+        return 0;
+    }
+
+    g->tiles = tc;
+    return 1;
+}
+
+/* Whether 'a' is 'l' or one of its ancestors. */
+static int isAncestor(const Layer *a, const Layer *l)
+{
+    if (l == NULL)
+        return 0;
+    return a == l || isAncestor(a, l->p) || isAncestor(a, l->p2);
+}
+
+int enableTileCache(LayerStack *g, int layerId)
+{
+    Layer *l;
+    int i;
+
+    if (g->tiles == NULL || layerId < 0 || layerId >= g->layerCnt)
+        return 0;
+
+    // each tile of a layer needs several tiles of a cached ancestor, which
+    // can evict each other, such that the work grows exponentially with the
+    // number of cached layers along a chain; at most one is therefore allowed
+    l = &g->layers[layerId];
+    for (i = 0; i < g->layerCnt; i++)
+    {
+        Layer *t = &g->layers[i];
+        if (t != l && t->tiles != NULL && (isAncestor(t, l) || isAncestor(l, t)))
+            return 0;
+    }
+
+    l->tiles = g->tiles;
+    return 1;
+}
 
 void applySeed(LayerStack *g, int64_t seed)
 {
     // the seed has to be applied recursively
     setWorldSeed(&g->layers[L_VORONOI_ZOOM_1], seed);
+
+    // cached tiles of the previous seed can no longer be used, except for
+    // those of the ocean temperatures if the lower 48 bits are the same
+    if (g->tiles != NULL)
+    {
+        g->tiles->epoch++;
+        if ((seed ^ g->tiles->seed) & 0xffffffffffff)
+            g->tiles->epoch48++;
+        g->tiles->seed = seed;
+    }
+}
+
+/* Whether a layer generates its parents on demand, such that the graph above
+ * it is not part of the plan. Layers with a tile cache do so tile by tile.
+ * For areas, mapAddSnow() generates the land/ocean layers as bits, while
+ * point queries keep them in the plan to memoize their entries.
+ */
+static int isPlanLeaf(const Layer *l, int points)
+{
+    return l->tiles != NULL || (!points &&
+            l->getMap == mapAddSnow && l->p != NULL && hasLandBits(l->p));
+}
+
+/* Counts how many children request each layer in the graph below 'l'. */
+static void countRefs(Layer *l, int points)
+{
+    if (isPlanLeaf(l, points))
+        return;
+    if (l->p != NULL && l->p->refs++ == 0)
+        countRefs(l->p, points);
+    if (l->p2 != NULL && l->p2->refs++ == 0)
+        countRefs(l->p2, points);
+}
+
+/* Adds the area that 'l' requests from its parent 'p' to the planned area of
+ * the parent, which is ready to be planned further once all its children
+ * have been planned.
+ */
+static void planParent(Layer *l, Layer *p, int edge, Layer **ready)
+{
+    int x = l->areaX, z = l->areaZ, w = l->areaW, h = l->areaH;
+
+    if (p == NULL)
+        return;
+
+    getParentArea(l, edge, &x, &z, &w, &h);
+
+    if (p->areaW == 0)
+    {
+        p->areaX = x; p->areaZ = z;
+        p->areaW = w; p->areaH = h;
+    }
+    else
+    {
+        int x1 = p->areaX + p->areaW, z1 = p->areaZ + p->areaH;
+        if (x + w > x1) x1 = x + w;
+        if (z + h > z1) z1 = z + h;
+        if (x < p->areaX) p->areaX = x;
+        if (z < p->areaZ) p->areaZ = z;
+        p->areaW = x1 - p->areaX;
+        p->areaH = z1 - p->areaZ;
+    }
+
+    if (--p->refs == 0)
+    {
+        p->next = *ready;
+        *ready = p;
+    }
+}
+
+/* Plans the area of every layer that is needed to generate the area (x,z,w,h)
+ * of 'root' and returns the layers in the order of generation, linked via
+ * 'next', such that each layer comes after all of its parents. The plan of
+ * point queries ('points') serves as a memo of the entries instead.
+ */
+static Layer *planAreas(Layer *root, int x, int z, int w, int h, int points)
+{
+    Layer *ready = root, *order = NULL, *l;
+
+    countRefs(root, points);
+
+    root->areaX = x; root->areaZ = z;
+    root->areaW = w; root->areaH = h;
+    root->next = NULL;
+
+    while (ready != NULL)
+    {
+        l = ready;
+        ready = l->next;
+
+        // the children are planned before their parents, so the order of
+        // generation is the reverse
+        l->next = order;
+        order = l;
+
+        if (!isPlanLeaf(l, points))
+        {
+            planParent(l, l->p, l->edge, &ready);
+            planParent(l, l->p2, l->edge2, &ready);
+        }
+    }
+
+    return order;
+}
+
+enum { MAX_SLOTS = 16 };
+
+static void releaseSlot(Layer *p, int *slotUsed)
+{
+    if (p != NULL && --p->refs == 0 && p->slot >= 0)
+        slotUsed[p->slot] = 0;
+}
+
+/* Assigns the planned layers to buffer slots. A slot is reused once all the
+ * children of its layer have been generated, so a chain of layers alternates
+ * between two buffers. The root is generated directly into the output.
+ * Returns the number of slots, whose sizes are stored in 'slotSize'.
+ */
+static int assignSlots(Layer *root, Layer *order, size_t *slotSize)
+{
+    int slotUsed[MAX_SLOTS];
+    int slotCnt = 0, i, s;
+    Layer *l;
+
+    countRefs(root, 0);
+
+    for (l = order; l != NULL; l = l->next)
+    {
+        size_t n = (size_t)l->areaW * l->areaH;
+
+        if (l != root)
+        {
+            // best fit among the free slots, otherwise grow the largest one
+            s = -1;
+            for (i = 0; i < slotCnt; i++)
+            {
+                if (slotUsed[i])
+                    continue;
+                if (s < 0 ||
+                    (slotSize[i] >= n && (slotSize[s] < n || slotSize[i] < slotSize[s])) ||
+                    (slotSize[s] < n && slotSize[i] > slotSize[s]))
+                    s = i;
+            }
+            if (s < 0 && slotCnt < MAX_SLOTS)
+            {
+                s = slotCnt++;
+                slotSize[s] = 0;
+            }
+            // without a slot, the layer is generated on demand by its children
+            if (s >= 0)
+            {
+                if (slotSize[s] < n)
+                    slotSize[s] = n;
+                slotUsed[s] = 1;
+            }
+            l->slot = s;
+        }
+
+        if (!isPlanLeaf(l, 0))
+        {
+            releaseSlot(l->p, slotUsed);
+            releaseSlot(l->p2, slotUsed);
+        }
+    }
+
+    return slotCnt;
+}
+
+static size_t getGenScratch(Layer *l, int w, int h);
+
+/* Determines an upper bound for the scratch memory that a layer function uses
+ * to generate an area of size w x h. Parents with a slot are viewed in place,
+ * while the others are generated into scratch memory.
+ */
+static size_t getLayerScratch(Layer *l, int w, int h)
+{
+    size_t peak = 0, held = 0, n;
+    int x, z, pw, ph;
+
+    if (l->p != NULL && l->p->slot < 0)
+    {
+        x = z = 0; pw = w; ph = h;
+        getParentArea(l, l->edge, &x, &z, &pw, &ph);
+        held = (size_t)pw * ph;
+        peak = held + getGenScratch(l->p, pw, ph);
+    }
+    if (l->p2 != NULL && l->p2->slot < 0)
+    {
+        x = z = 0; pw = w; ph = h;
+        getParentArea(l, l->edge2, &x, &z, &pw, &ph);
+        n = held + (size_t)pw * ph + getGenScratch(l->p2, pw, ph);
+        held += (size_t)pw * ph;
+        if (n > peak) peak = n;
+    }
+    if (l->getMap == mapVoronoiZoom)
+    {
+        // jitters of two rows of corners
+        n = held + 4 * ((size_t)(w >> 2) + 3);
+        if (n > peak) peak = n;
+    }
+    if (l->getMap == mapOceanMix)
+    {
+        // land proximity rows of bytes
+        n = held + ((size_t)(h + 16) * w + (w + 16) + 3) / 4;
+        if (n > peak) peak = n;
+    }
+
+    return peak;
+}
+
+/* Like getLayerScratch(), but for genLayerArea(), which generates layers with
+ * a tile cache one tile at a time.
+ */
+static size_t getGenScratch(Layer *l, int w, int h)
+{
+    if (l->tiles != NULL)
+    {
+        const int tileW = 1 << l->tiles->tileShift;
+        return (size_t)tileW * tileW + getLayerScratch(l, tileW, tileW);
+    }
+    return getLayerScratch(l, w, h);
+}
+
+/* Resets the plan of the layers in 'order' once a request is complete. */
+static void clearPlan(Layer *order)
+{
+    Layer *l, *next;
+
+    for (l = order; l != NULL; l = next)
+    {
+        next = l->next;
+        l->data = NULL;
+        l->areaX = l->areaZ = l->areaW = l->areaH = 0;
+        l->valid = 0;
+        l->slot = -1;
+        l->next = NULL;
+    }
+}
+
+/* Grows the scratch arena of the layer ahead of a request, such that it holds
+ * at least 'n' ints. An arena that is in use is left as it is.
+ */
+static void reserveScratch(Layer *layer, size_t n)
+{
+    LayerArena *arena = layer->arena;
+
+    if (arena != NULL && arena->used == 0 && n > arena->size)
+    {
+        free(arena->mem);
+        arena->mem = (int *) malloc(n * sizeof(int));
+        arena->size = arena->mem != NULL ? n : 0;
+    }
+}
+
+/* Plans a request for the area (x,z,w,h) of 'layer' and assigns the buffer
+ * of each layer, with the requested layer writing into 'out'. The buffers are
+ * taken from the scratch memory at '*mem', which is grown ahead of time to
+ * also fit 'scratch' further ints. Returns the layers in order of generation.
+ */
+static Layer *beginRequest(Layer *layer, int *out, int x, int z, int w, int h,
+        int **mem, size_t *scratch)
+{
+    size_t slotSize[MAX_SLOTS], slotOff[MAX_SLOTS], total = 0, n;
+    int slotCnt, i;
+    Layer *order, *l;
+
+    // plan the area of each layer, such that layers which are shared by
+    // several branches are only generated once for the whole request
+    order = planAreas(layer, x, z, w, h, 0);
+    slotCnt = assignSlots(layer, order, slotSize);
+
+    for (i = 0; i < slotCnt; i++)
+    {
+        slotOff[i] = total;
+        total += slotSize[i];
+    }
+    *scratch = 0;
+    for (l = order; l != NULL; l = l->next)
+    {
+        if (l == layer || l->slot >= 0)
+        {
+            n = getGenScratch(l, l->areaW, l->areaH);
+            if (n > *scratch) *scratch = n;
+        }
+    }
+
+    // make sure that the whole request fits into the scratch memory
+    reserveScratch(layer, total + *scratch);
+
+    *mem = total > 0 ? allocScratch(layer, total) : NULL;
+
+    for (l = order; l != NULL; l = l->next)
+    {
+        if (l == layer)
+            l->data = out;
+        else if (l->slot >= 0)
+            l->data = *mem + slotOff[l->slot];
+    }
+
+    // the references are resolved again while the layers are generated
+    countRefs(layer, 0);
+
+    return order;
+}
+
+/* Marks a layer as generated and releases the buffers of the parents for
+ * which it was the last child.
+ */
+static void finishLayer(Layer *l)
+{
+    if (l->data != NULL)
+        l->valid = 1;
+
+    if (!isPlanLeaf(l, 0))
+    {
+        if (l->p != NULL && --l->p->refs == 0)
+            l->p->valid = 0;
+        if (l->p2 != NULL && --l->p2->refs == 0)
+            l->p2->valid = 0;
+    }
+}
+
+static void endRequest(Layer *layer, Layer *order, int *mem, size_t base)
+{
+    clearPlan(order);
+
+    if (mem != NULL)
+        freeScratch(layer, mem);
+
+    if (layer->arena != NULL)
+        layer->arena->used = base;
 }
 
 void genArea(Layer *layer, int *out, int areaX, int areaZ, int areaWidth, int areaHeight)
 {
-    memset(out, 0, areaWidth*areaHeight*sizeof(*out));
-    layer->getMap(layer, out, areaX, areaZ, areaWidth, areaHeight);
+    size_t base = layer->arena != NULL ? layer->arena->used : 0;
+    size_t scratch;
+    Layer *order, *l;
+    int *mem;
+
+    order = beginRequest(layer, out, areaX, areaZ, areaWidth, areaHeight,
+            &mem, &scratch);
+
+    // generate the layers in order, parents first
+    for (l = order; l != NULL; l = l->next)
+    {
+        if (l->data != NULL)
+            genLayerArea(l, l->data, l->areaX, l->areaZ, l->areaW, l->areaH);
+        finishLayer(l);
+    }
+
+    endRequest(layer, order, mem, base);
+}
+
+void genAreaStrided(Layer *layer, int *out, size_t rowStride,
+        int areaX, int areaZ, int areaWidth, int areaHeight)
+{
+    size_t base = layer->arena != NULL ? layer->arena->used : 0;
+    size_t scratch;
+    Layer *order, *l;
+    int *mem;
+
+    if (rowStride == (size_t)areaWidth)
+    {
+        genArea(layer, out, areaX, areaZ, areaWidth, areaHeight);
+        return;
+    }
+
+    // the requested layer is not read by any other layer, so the planned
+    // buffer is only a marker for it
+    order = beginRequest(layer, out, areaX, areaZ, areaWidth, areaHeight,
+            &mem, &scratch);
+
+    for (l = order; l != NULL; l = l->next)
+    {
+        if (l == layer)
+            genLayerAreaStrided(l, out, rowStride, l->areaX, l->areaZ, l->areaW, l->areaH);
+        else if (l->data != NULL)
+            genLayerArea(l, l->data, l->areaX, l->areaZ, l->areaW, l->areaH);
+        finishLayer(l);
+    }
+
+    endRequest(layer, order, mem, base);
+}
+
+
+/* Longest chain of layers that genAreaSeeds() evaluates in seed lanes. */
+enum { MAX_LANE_CHAIN = 32 };
+
+/* Fewest seeds for which genAreaSeeds() uses the lanes. A full set of lanes
+ * costs about as much as generating six seeds one after another.
+ */
+enum { MIN_LANES = 6 };
+
+/* Whether setWorldSeed() on 'root' reaches the layer 'l'. The branch that the
+ * hills of 1.7 - 1.12 take from the river layers is not seeded on its own.
+ */
+static int isSeededFrom(const Layer *root, const Layer *l)
+{
+    if (root == l)
+        return 1;
+    if (root->p2 != NULL && root->getMap != mapHills && isSeededFrom(root->p2, l))
+        return 1;
+    return root->p != NULL && isSeededFrom(root->p, l);
+}
+
+/* Generates the area in seed lanes if every layer down from 'layer' has them,
+ * see mapLayerLanes(), and writes the maps of the lanes in 'mask' to 'out'.
+ * The lanes derive the seed of each layer from the world seed, so the layers
+ * that applySeed() leaves as they are have to be generated one seed at a
+ * time. Returns zero otherwise.
+ */
+static int genLanes(Layer *root, Layer *layer, const int64_t *seeds, int mask,
+        int *out, int areaX, int areaZ, int areaWidth, int areaHeight)
+{
+    const size_t n = (size_t)areaWidth * areaHeight;
+    Layer *chain[MAX_LANE_CHAIN];
+    int area[MAX_LANE_CHAIN][4];
+    size_t size = 0, j;
+    int *lanes, *buf[2];
+    int cnt, i, k;
+    Layer *l;
+
+    for (cnt = 0, l = layer; l != NULL; l = l->p)
+    {
+        if (cnt == MAX_LANE_CHAIN || l->p2 != NULL || !hasLayerLanes(l) ||
+            !isSeededFrom(root, l))
+            return 0;
+        chain[cnt++] = l;
+    }
+
+    area[0][0] = areaX; area[0][1] = areaZ;
+    area[0][2] = areaWidth; area[0][3] = areaHeight;
+    for (i = 1; i < cnt; i++)
+    {
+        memcpy(area[i], area[i-1], sizeof(area[i]));
+        getParentArea(chain[i-1], chain[i-1]->edge,
+                &area[i][0], &area[i][1], &area[i][2], &area[i][3]);
+        j = (size_t)area[i][2] * area[i][3];
+        if (j > size) size = j;
+    }
+
+    // the parents alternate between two buffers
+    reserveScratch(layer, (n + 2 * size) * SEED_LANES);
+    lanes = allocScratch(layer, n * SEED_LANES);
+    buf[0] = allocScratch(layer, size * SEED_LANES);
+    buf[1] = allocScratch(layer, size * SEED_LANES);
+
+    for (i = cnt-1; i >= 0; i--)
+    {
+        mapLayerLanes(chain[i], seeds, i == 0 ? lanes : buf[i & 1], buf[(i+1) & 1],
+                area[i][0], area[i][1], area[i][2], area[i][3]);
+    }
+
+    for (k = 0; k < SEED_LANES; k++)
+    {
+        if ((mask >> k) & 1)
+        {
+            for (j = 0; j < n; j++)
+                out[k*n + j] = lanes[j*SEED_LANES + k];
+        }
+    }
+
+    freeScratch(layer, buf[1]);
+    freeScratch(layer, buf[0]);
+    freeScratch(layer, lanes);
+    return 1;
+}
+
+void genAreaSeeds(LayerStack *g, int layerId, const int64_t *seeds, int mask,
+        int *out, int areaX, int areaZ, int areaWidth, int areaHeight)
+{
+    Layer *layer = &g->layers[layerId];
+    const size_t n = (size_t)areaWidth * areaHeight;
+    int64_t ws[SEED_LANES];
+    int k, cnt;
+
+    mask &= (1 << SEED_LANES) - 1;
+
+    for (k = 0, cnt = 0; k < SEED_LANES; k++)
+        cnt += (mask >> k) & 1;
+
+    // the lanes are all evaluated regardless of the mask, which only pays
+    // off while most of them are in use
+    if (cnt >= MIN_LANES)
+    {
+        for (k = 0; k < SEED_LANES; k++)
+            ws[k] = (mask >> k) & 1 ? seeds[k] : 0;
+
+        if (genLanes(&g->layers[L_VORONOI_ZOOM_1], layer, ws, mask, out,
+                areaX, areaZ, areaWidth, areaHeight))
+            return;
+    }
+
+    for (k = 0; k < SEED_LANES; k++)
+    {
+        if ((mask >> k) & 1)
+        {
+            applySeed(g, seeds[k]);
+            genArea(layer, out + k*n, areaX, areaZ, areaWidth, areaHeight);
+        }
+    }
+}
+
+
+/* Size of the stack buffer in which genPoint() memoizes the entries of the
+ * layers. A point query of the default generators needs less than 6000.
+ */
+enum { POINT_BUF = 8192 };
+
+int genPoint(Layer *layer, int x, int z)
+{
+    int memo[POINT_BUF];
+    size_t total = 0;
+    Layer *order, *l;
+    int *e = memo;
+    int v;
+
+    // the planned area of each layer bounds the entries that can be needed
+    order = planAreas(layer, x, z, 1, 1, 1);
+
+    for (l = order; l != NULL; l = l->next)
+        total += (size_t)l->areaW * l->areaH;
+
+    if (total > POINT_BUF)
+    {
+        clearPlan(order);
+        genArea(layer, &v, x, z, 1, 1);
+        return v;
+    }
+
+    memset(memo, 0x80, total * sizeof(int)); // POINT_UNSET
+    for (l = order; l != NULL; l = l->next)
+    {
+        l->data = e;
+        e += (size_t)l->areaW * l->areaH;
+    }
+
+    v = getLayerPoint(layer, x, z);
+
+    clearPlan(order);
+    return v;
 }
 
 
+/* Width of the clusters of genPoints() in blocks. Points within a cluster
+ * share the entries of the layers that they have in common, which is mostly
+ * the case for the layers of scale 256 and above.
+ */
+enum { POINTS_CLUSTER = 1024 };
+/* A cluster is generated as a whole with genArea() once it has at least one
+ * point for every POINTS_DENSE entries of its bounding box.
+ */
+enum { POINTS_DENSE = 32 };
 
+STRUCT(PointRef)
+{
+    int cx, cz;         // cluster cell of the point
+    int i;              // index of the point
+};
 
+/* Memo of the layers during genPoints(). The layers are planned in the same
+ * order for any request of the same layer, so they are indexed by position.
+ */
+STRUCT(PointMemo)
+{
+    int cnt;            // number of planned layers
+    int *rect;          // shared area and memo offset of each layer (or -1)
+    int *mem;
+    size_t cap;
+};
+
+static int cmpPointRef(const void *a, const void *b)
+{
+    const PointRef *p = (const PointRef*) a, *q = (const PointRef*) b;
+    if (p->cz != q->cz) return p->cz < q->cz ? -1 : 1;
+    if (p->cx != q->cx) return p->cx < q->cx ? -1 : 1;
+    return p->i < q->i ? -1 : (p->i > q->i);
+}
+
+static int growPointMemo(PointMemo *m, size_t n)
+{
+    int *mem;
+    if (n <= m->cap)
+        return 1;
+    if (n < 2 * m->cap)
+        n = 2 * m->cap;
+    mem = (int *) realloc(m->mem, n * sizeof(int));
+    if (mem == NULL)
+        return 0;
+    m->mem = mem;
+    m->cap = n;
+    return 1;
+}
+
+/* Generates the points 'ref[0..cnt)' of one cluster. Layers whose planned
+ * area for the bounding box of the cluster is no larger than the areas of
+ * separate point queries keep one memo for the whole cluster. The others,
+ * typically the layers near the requested scale, get a fresh memo per point.
+ */
+static void genCluster(Layer *layer, const int *x, const int *z, int *out,
+        const PointRef *ref, int cnt, PointMemo *m)
+{
+    int x0 = INT_MAX, z0 = INT_MAX, x1 = INT_MIN, z1 = INT_MIN;
+    int *rect = m->rect;
+    size_t shared = 0, n, w, h;
+    int perPoint = 0, i, k;
+    Layer *order, *l;
+
+    for (i = 0; i < cnt; i++)
+    {
+        int px = x[ref[i].i], pz = z[ref[i].i];
+        if (px < x0) x0 = px;
+        if (px > x1) x1 = px;
+        if (pz < z0) z0 = pz;
+        if (pz > z1) z1 = pz;
+    }
+    w = (size_t)x1 - x0 + 1;
+    h = (size_t)z1 - z0 + 1;
+
+    if (cnt == 1)
+    {
+        out[ref[0].i] = genPoint(layer, x[ref[0].i], z[ref[0].i]);
+        return;
+    }
+    if (w * h <= (size_t)cnt * POINTS_DENSE && growPointMemo(m, w * h))
+    {
+        genArea(layer, m->mem, x0, z0, (int)w, (int)h);
+        for (i = 0; i < cnt; i++)
+        {
+            int j = ref[i].i;
+            out[j] = m->mem[(z[j] - z0) * w + (x[j] - x0)];
+        }
+        return;
+    }
+
+    // compare the plan of the bounding box with that of a single point
+    order = planAreas(layer, x[ref[0].i], z[ref[0].i], 1, 1, 1);
+    for (l = order, k = 0; l != NULL; l = l->next, k++)
+        rect[5*k+4] = l->areaW * l->areaH;
+    clearPlan(order);
+
+    order = planAreas(layer, x0, z0, (int)w, (int)h, 1);
+    for (l = order, k = 0; l != NULL; l = l->next, k++)
+    {
+        n = (size_t)l->areaW * l->areaH;
+        rect[5*k+0] = l->areaX;
+        rect[5*k+1] = l->areaZ;
+        rect[5*k+2] = l->areaW;
+        rect[5*k+3] = l->areaH;
+        if (n <= (size_t)cnt * rect[5*k+4])
+        {
+            rect[5*k+4] = (int) shared;
+            shared += n;
+        }
+        else
+        {
+            rect[5*k+4] = -1;
+            perPoint = 1;
+        }
+    }
+
+    if (!growPointMemo(m, shared + (perPoint ? POINT_BUF : 0)))
+    {
+        clearPlan(order);
+        for (i = 0; i < cnt; i++)
+            out[ref[i].i] = genPoint(layer, x[ref[i].i], z[ref[i].i]);
+        return;
+    }
+    memset(m->mem, 0x80, shared * sizeof(int)); // POINT_UNSET
+
+    if (!perPoint)
+    {
+        for (l = order, k = 0; l != NULL; l = l->next, k++)
+            l->data = m->mem + rect[5*k+4];
+        for (i = 0; i < cnt; i++)
+            out[ref[i].i] = getLayerPoint(layer, x[ref[i].i], z[ref[i].i]);
+        clearPlan(order);
+        return;
+    }
+    clearPlan(order);
+
+    for (i = 0; i < cnt; i++)
+    {
+        int px = x[ref[i].i], pz = z[ref[i].i];
+        int *e;
+
+        order = planAreas(layer, px, pz, 1, 1, 1);
+        n = shared;
+        for (l = order, k = 0; l != NULL; l = l->next, k++)
+        {
+            if (rect[5*k+4] < 0)
+                n += (size_t)l->areaW * l->areaH;
+        }
+        if (!growPointMemo(m, n))
+        {
+            clearPlan(order);
+            out[ref[i].i] = genPoint(layer, px, pz);
+            continue;
+        }
+
+        e = m->mem + shared;
+        for (l = order, k = 0; l != NULL; l = l->next, k++)
+        {
+            if (rect[5*k+4] < 0)
+            {
+                l->data = e;
+                e += (size_t)l->areaW * l->areaH;
+            }
+            else
+            {
+                l->areaX = rect[5*k+0];
+                l->areaZ = rect[5*k+1];
+                l->areaW = rect[5*k+2];
+                l->areaH = rect[5*k+3];
+                l->data = m->mem + rect[5*k+4];
+            }
+        }
+        memset(m->mem + shared, 0x80, (n - shared) * sizeof(int));
+
+        out[ref[i].i] = getLayerPoint(layer, px, pz);
+        clearPlan(order);
+    }
+}
+
+void genPoints(Layer *layer, const int *x, const int *z, int *out, int n)
+{
+    PointMemo m;
+    PointRef *ref;
+    Layer *order, *l;
+    int shift = 0, i, j;
+
+    if (n <= 0)
+        return;
+
+    while ((layer->scale << shift) < POINTS_CLUSTER)
+        shift++;
+
+    memset(&m, 0, sizeof(m));
+    ref = (PointRef *) malloc(n * sizeof(*ref));
+    if (ref != NULL)
+    {
+        order = planAreas(layer, x[0], z[0], 1, 1, 1);
+        for (l = order; l != NULL; l = l->next)
+            m.cnt++;
+        clearPlan(order);
+        m.rect = (int *) malloc(m.cnt * 5 * sizeof(int));
+    }
+    if (m.rect == NULL)
+    {
+        free(ref);
+        for (i = 0; i < n; i++)
+            out[i] = genPoint(layer, x[i], z[i]);
+        return;
+    }
+
+    // sort the points by cluster, so that nearby points are generated together
+    j = 1;
+    for (i = 0; i < n; i++)
+    {
+        ref[i].cx = x[i] >> shift;
+        ref[i].cz = z[i] >> shift;
+        ref[i].i = i;
+        j &= ref[i].cx == ref[0].cx && ref[i].cz == ref[0].cz;
+    }
+    if (!j)
+        qsort(ref, n, sizeof(*ref), cmpPointRef);
+
+    for (i = 0; i < n; i = j)
+    {
+        for (j = i+1; j < n; j++)
+        {
+            if (ref[j].cx != ref[i].cx || ref[j].cz != ref[i].cz)
+                break;
+        }
+        genCluster(layer, x, z, out, ref + i, j - i, &m);
+    }
+
+    free(m.mem);
+    free(m.rect);
+    free(ref);
+}
+
+int checkArea(Layer *layer, int areaX, int areaZ, int areaWidth, int areaHeight,
+        const int *isValid)
+{
+    size_t total = 0;
+    Layer *order, *l;
+    int *memo, *e;
+    int top, step, i, j, ok = 1;
+
+    // the entries are evaluated as for point queries, with a memo over the
+    // planned area of each layer, so that nothing is generated beyond the
+    // dependencies of the entries that were checked before an invalid one
+    order = planAreas(layer, areaX, areaZ, areaWidth, areaHeight, 1);
+    for (l = order; l != NULL; l = l->next)
+        total += (size_t)l->areaW * l->areaH;
+
+    reserveScratch(layer, total);
+    memo = allocScratch(layer, total);
+    if (memo != NULL)
+    {
+        memset(memo, 0x80, total * sizeof(int)); // POINT_UNSET
+        for (e = memo, l = order; l != NULL; l = l->next)
+        {
+            l->data = e;
+            e += (size_t)l->areaW * l->areaH;
+        }
+    }
+
+    // check the area coarse to fine, such that an invalid region is found
+    // after a few entries wherever it lies
+    for (top = 1; top < areaWidth || top < areaHeight; top <<= 1);
+
+    for (step = top; ok && step > 0; step >>= 1)
+    {
+        const int mask = 2*step - 1;
+        for (j = 0; ok && j < areaHeight; j += step)
+        {
+            for (i = 0; i < areaWidth; i += step)
+            {
+                // skip the entries of the coarser steps
+                if (step < top && (i & mask) == 0 && (j & mask) == 0)
+                    continue;
+                if (!isValid[getLayerPoint(layer, areaX+i, areaZ+j) & 0xff])
+                {
+                    ok = 0;
+                    break;
+                }
+            }
+        }
+    }
+
+    clearPlan(order);
+    if (memo != NULL)
+        freeScratch(layer, memo);
+
+    return ok;
+}
+
+
+/* Window of rows that a layer keeps while an area is generated band by band.
+ * The columns are those of the planned area of the layer.
+ */
+STRUCT(RowWindow)
+{
+    Layer *l;
+    int *buf;           // rows [lo, hi) of the layer
+    int lo, hi;
+    int need0, need1;   // rows needed for the current band
+    int cap;            // capacity of the window in rows
+};
+
+static void needRows(RowWindow *win, Layer *l, Layer *p, int edge, int z0, int z1)
+{
+    int x = l->areaX, z = z0, w = l->areaW, h = z1 - z0;
+    RowWindow *pw;
+
+    if (p == NULL)
+        return;
+
+    getParentArea(l, edge, &x, &z, &w, &h);
+
+    pw = &win[p->slot];
+    if (pw->need1 <= pw->need0)
+    {
+        pw->need0 = z;
+        pw->need1 = z + h;
+    }
+    else
+    {
+        if (z < pw->need0) pw->need0 = z;
+        if (z + h > pw->need1) pw->need1 = z + h;
+    }
+}
+
+/* Determines the rows that each layer needs for the rows [z0, z1) of the
+ * requested layer, which is the last of the 'cnt' windows.
+ */
+static void planRows(RowWindow *win, int cnt, int z0, int z1)
+{
+    int i;
+
+    for (i = 0; i < cnt - 1; i++)
+        win[i].need0 = win[i].need1 = 0;
+
+    win[cnt-1].need0 = z0;
+    win[cnt-1].need1 = z1;
+
+    // children come after their parents
+    for (i = cnt - 1; i >= 0; i--)
+    {
+        Layer *l = win[i].l;
+        if (isPlanLeaf(l, 0))
+            continue;
+        needRows(win, l, l->p, l->edge, win[i].need0, win[i].need1);
+        needRows(win, l, l->p2, l->edge2, win[i].need0, win[i].need1);
+    }
+}
+
+/* Drops the rows of a window that are no longer needed and generates the new
+ * ones. Each row of a layer is therefore only generated once.
+ */
+static void advanceRows(RowWindow *w)
+{
+    Layer *l = w->l;
+    const size_t width = l->areaW;
+
+    if (w->hi > w->need0 && w->need0 > w->lo)
+    {
+        memmove(w->buf, w->buf + (w->need0 - w->lo) * width,
+                (w->hi - w->need0) * width * sizeof(int));
+    }
+    if (w->hi < w->need0)
+        w->hi = w->need0;
+    w->lo = w->need0;
+
+    l->data = w->buf;
+    l->areaZ = w->lo;
+    l->areaH = w->hi - w->lo;
+    l->valid = 1;
+
+    if (w->need1 > w->hi)
+    {
+        genLayerArea(l, w->buf + (w->hi - w->lo) * width,
+                l->areaX, w->hi, l->areaW, w->need1 - w->hi);
+        w->hi = w->need1;
+        l->areaH = w->hi - w->lo;
+    }
+}
+
+int genAreaRows(Layer *layer, int areaX, int areaZ, int areaWidth, int areaHeight,
+        int bandHeight, int (*consume)(void *data, const int *rows, int z, int rowCnt),
+        void *data)
+{
+    LayerArena *arena = layer->arena;
+    size_t base = arena != NULL ? arena->used : 0;
+    size_t total = 0, scratch = 0, n;
+    RowWindow *win;
+    Layer *order, *l;
+    int *mem = NULL;
+    int cnt, i, z, z1, ret = 0;
+
+    if (areaWidth <= 0 || areaHeight <= 0)
+        return 0;
+    if (bandHeight <= 0 || bandHeight > areaHeight)
+        bandHeight = areaHeight;
+
+    // the columns of each layer are the same for all bands
+    order = planAreas(layer, areaX, areaZ, areaWidth, bandHeight, 0);
+
+    for (cnt = 0, l = order; l != NULL; l = l->next)
+        cnt++;
+
+    win = (RowWindow *) malloc(cnt * sizeof(*win));
+    if (win == NULL)
+    {
+        clearPlan(order);
+        return -1;
+    }
+
+    for (i = 0, l = order; l != NULL; l = l->next, i++)
+    {
+        win[i].l = l;
+        win[i].lo = win[i].hi = INT_MIN;
+        win[i].cap = 0;
+        l->slot = i;
+    }
+
+    // find the largest number of rows that each layer has to hold
+    for (z = areaZ; z < areaZ + areaHeight; z += bandHeight)
+    {
+        z1 = z + bandHeight < areaZ + areaHeight ? z + bandHeight : areaZ + areaHeight;
+        planRows(win, cnt, z, z1);
+        for (i = 0; i < cnt; i++)
+        {
+            if (win[i].need1 - win[i].need0 > win[i].cap)
+                win[i].cap = win[i].need1 - win[i].need0;
+        }
+    }
+
+    for (i = 0; i < cnt; i++)
+    {
+        l = win[i].l;
+        total += (size_t)l->areaW * win[i].cap;
+        n = getGenScratch(l, l->areaW, win[i].cap);
+        if (n > scratch) scratch = n;
+    }
+
+    if (arena != NULL && base == 0 && total + scratch > arena->size)
+    {
+        free(arena->mem);
+        arena->mem = (int *) malloc((total + scratch) * sizeof(int));
+        arena->size = arena->mem != NULL ? total + scratch : 0;
+    }
+
+    mem = allocScratch(layer, total);
+    if (mem == NULL)
+    {
+        ret = -1;
+    }
+    else
+    {
+        for (i = 0, n = 0; i < cnt; i++)
+        {
+            win[i].buf = mem + n;
+            n += (size_t)win[i].l->areaW * win[i].cap;
+        }
+
+        for (z = areaZ; z < areaZ + areaHeight && ret == 0; z += bandHeight)
+        {
+            z1 = z + bandHeight < areaZ + areaHeight ? z + bandHeight : areaZ + areaHeight;
+            planRows(win, cnt, z, z1);
+            for (i = 0; i < cnt; i++)
+                advanceRows(&win[i]);
+
+            ret = consume(data, win[cnt-1].buf, z, z1 - z);
+        }
+
+        freeScratch(layer, mem);
+    }
+
+    clearPlan(order);
+    free(win);
+
+    if (arena != NULL)
+        arena->used = base;
+
+    return ret;
+}
+
+
+/* Number of int entries that genArea8() and genArea16() generate at a time. */
+enum { CELL_BAND = 1 << 16 };
+
+STRUCT(CellOutput)
+{
+    void *out;
+    int cellSize;       // bytes per output entry
+    int areaZ, areaWidth;
+};
+
+static int storeCells(void *data, const int *rows, int z, int rowCnt)
+{
+    CellOutput *c = (CellOutput *) data;
+    size_t i = (size_t)(z - c->areaZ) * c->areaWidth;
+    size_t n = (size_t)rowCnt * c->areaWidth, j;
+
+    if (c->cellSize == 1)
+    {
+        uint8_t *out = (uint8_t *) c->out + i;
+        for (j = 0; j < n; j++)
+            out[j] = (uint8_t) rows[j];
+    }
+    else
+    {
+        uint16_t *out = (uint16_t *) c->out + i;
+        for (j = 0; j < n; j++)
+            out[j] = (uint16_t) rows[j];
+    }
+    return 0;
+}
+
+static int genAreaCells(Layer *layer, void *out, int cellSize,
+        int areaX, int areaZ, int areaWidth, int areaHeight)
+{
+    CellOutput c = { out, cellSize, areaZ, areaWidth };
+    int bandHeight = areaWidth > 0 ? CELL_BAND / areaWidth : 1;
+
+    if (bandHeight < 1)
+        bandHeight = 1;
+
+    return genAreaRows(layer, areaX, areaZ, areaWidth, areaHeight,
+            bandHeight, storeCells, &c);
+}
+
+int genArea8(Layer *layer, uint8_t *out, int areaX, int areaZ, int areaWidth, int areaHeight)
+{
+    return genAreaCells(layer, out, 1, areaX, areaZ, areaWidth, areaHeight);
+}
+
+int genArea16(Layer *layer, uint16_t *out, int areaX, int areaZ, int areaWidth, int areaHeight)
+{
+    return genAreaCells(layer, out, 2, areaX, areaZ, areaWidth, areaHeight);
+}
+
+
+/* Layers with fewer entries are generated as a single task. */
+enum { PARALLEL_MIN_AREA = 1 << 14 };
+
+/* A thread of genAreaThreaded() with its own copy of the generator layers,
+ * since the layer functions keep their random state in the layers.
+ */
+STRUCT(AreaWorker)
+{
+    struct AreaSchedule *sched;
+    Layer *layers;
+    LayerArena arena;
+};
+
+/* Tasks of genAreaThreaded() that are shared by its threads. Each planned
+ * layer is generated by one or more tasks (strips of rows), which become
+ * ready once the parents of the layer have been generated and the buffer
+ * that it reuses has been released by the children of the previous owner.
+ * Thus independent branches of the layer graph are generated concurrently.
+ */
+STRUCT(AreaSchedule)
+{
+    LayerStack *g;
+    Layer **layers;     // planned layers in order of generation
+    int cnt;
+    int threads;
+    char *dep;          // dep[i*cnt + j]: layer j has to wait for layer i
+    int *deps;          // unresolved dependencies of each layer
+    int *strips;        // number of tasks of each layer
+    int *pending;       // tasks of each layer that are not done yet
+    int *queue;         // ready tasks: layer * threads + strip
+    int head, tail;
+    int done;           // number of completed layers
+
+#ifdef USE_PTHREAD
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_mutex_t serial;
+#else
+    CRITICAL_SECTION lock;
+    CONDITION_VARIABLE cond;
+    CRITICAL_SECTION serial;
+#endif
+};
+
+#ifdef USE_PTHREAD
+#define SCHED_LOCK(m)       pthread_mutex_lock(m)
+#define SCHED_UNLOCK(m)     pthread_mutex_unlock(m)
+#define SCHED_WAIT(c, m)    pthread_cond_wait(c, m)
+#define SCHED_WAKE(c)       pthread_cond_broadcast(c)
+#else
+#define SCHED_LOCK(m)       EnterCriticalSection(m)
+#define SCHED_UNLOCK(m)     LeaveCriticalSection(m)
+#define SCHED_WAIT(c, m)    SleepConditionVariableCS(c, m, INFINITE)
+#define SCHED_WAKE(c)       WakeAllConditionVariable(c)
+#endif
+
+static int findPlanned(AreaSchedule *s, Layer *l)
+{
+    int i;
+    for (i = 0; i < s->cnt; i++)
+        if (s->layers[i] == l)
+            return i;
+    return -1;
+}
+
+/* Layers with a tile cache, and layers outside of the generator, can only be
+ * generated with the shared layer state, by one thread at a time.
+ */
+static int isSerialLayer(AreaSchedule *s, Layer *l)
+{
+    return l->tiles != NULL ||
+            l < s->g->layers || l >= s->g->layers + s->g->layerCnt;
+}
+
+static void pushLayer(AreaSchedule *s, int i)
+{
+    int k;
+    for (k = 0; k < s->strips[i]; k++)
+        s->queue[s->tail++] = i * s->threads + k;
+}
+
+/* Generates one task of the schedule. */
+static void runTask(AreaWorker *w, int task)
+{
+    AreaSchedule *s = w->sched;
+    Layer *l = s->layers[task / s->threads];
+    const int k = task % s->threads;
+
+    if (isSerialLayer(s, l))
+    {
+        SCHED_LOCK(&s->serial);
+        genLayerArea(l, l->data, l->areaX, l->areaZ, l->areaW, l->areaH);
+        SCHED_UNLOCK(&s->serial);
+    }
+    else
+    {
+        const int rows = (l->areaH + s->strips[task / s->threads] - 1) /
+                s->strips[task / s->threads];
+        int z0 = l->areaZ + k * rows;
+        int z1 = z0 + rows;
+
+        if (z1 > l->areaZ + l->areaH)
+            z1 = l->areaZ + l->areaH;
+        if (z1 > z0)
+        {
+            Layer *wl = &w->layers[l - s->g->layers];
+            wl->getMap(wl, l->data + (size_t)(z0 - l->areaZ) * l->areaW,
+                    l->areaX, z0, l->areaW, z1 - z0);
+        }
+    }
+}
+
+static void runSchedule(AreaWorker *w)
+{
+    AreaSchedule *s = w->sched;
+    int task, i, j;
+
+    SCHED_LOCK(&s->lock);
+    while (1)
+    {
+        while (s->head == s->tail && s->done < s->cnt)
+            SCHED_WAIT(&s->cond, &s->lock);
+        if (s->done == s->cnt)
+            break;
+
+        task = s->queue[s->head++];
+
+        // the parents of the layer stay valid until the task is done
+        for (j = 0; j < s->g->layerCnt; j++)
+        {
+            w->layers[j].data = s->g->layers[j].data;
+            w->layers[j].valid = s->g->layers[j].valid;
+        }
+
+        SCHED_UNLOCK(&s->lock);
+        runTask(w, task);
+        SCHED_LOCK(&s->lock);
+
+        i = task / s->threads;
+        if (--s->pending[i] == 0)
+        {
+            finishLayer(s->layers[i]);
+            s->done++;
+            for (j = i + 1; j < s->cnt; j++)
+            {
+                if (s->dep[i * s->cnt + j] && --s->deps[j] == 0)
+                    pushLayer(s, j);
+            }
+            SCHED_WAKE(&s->cond);
+        }
+    }
+    SCHED_UNLOCK(&s->lock);
+}
+
+#ifdef USE_PTHREAD
+static void *genWorkerThread(void *data)
+#else
+static DWORD WINAPI genWorkerThread(LPVOID data)
+#endif
+{
+    runSchedule((AreaWorker *) data);
+    return 0;
+}
+
+/* Determines the dependencies and the tasks of the planned layers. Returns
+ * zero if the plan cannot be scheduled, because a layer is generated on
+ * demand rather than into a buffer of its own.
+ */
+static int initSchedule(AreaSchedule *s, Layer *layer)
+{
+    int i, j, k, c;
+
+    for (i = 0; i < s->cnt; i++)
+    {
+        Layer *l = s->layers[i];
+        if (l->data == NULL)
+            return 0;
+
+        if (!isSerialLayer(s, l) && l->areaH >= s->threads &&
+            (size_t)l->areaW * l->areaH >= PARALLEL_MIN_AREA)
+            s->strips[i] = s->threads;
+        else
+            s->strips[i] = 1;
+        s->pending[i] = s->strips[i];
+
+        // wait for the parents
+        if (!isPlanLeaf(l, 0))
+        {
+            if (l->p != NULL && (j = findPlanned(s, l->p)) >= 0)
+                s->dep[j * s->cnt + i] = 1;
+            if (l->p2 != NULL && (j = findPlanned(s, l->p2)) >= 0)
+                s->dep[j * s->cnt + i] = 1;
+        }
+
+        // wait for the children of the previous owner of the buffer
+        if (l != layer)
+        {
+            for (j = i - 1; j >= 0; j--)
+                if (s->layers[j] != layer && s->layers[j]->slot == l->slot)
+                    break;
+            for (k = j + 1; j >= 0 && k < i; k++)
+            {
+                Layer *ch = s->layers[k];
+                if (!isPlanLeaf(ch, 0) &&
+                    (ch->p == s->layers[j] || ch->p2 == s->layers[j]))
+                    s->dep[k * s->cnt + i] = 1;
+            }
+        }
+    }
+
+    for (i = 0; i < s->cnt; i++)
+    {
+        for (c = 0, j = 0; j < i; j++)
+            c += s->dep[j * s->cnt + i];
+        s->deps[i] = c;
+        if (c == 0)
+            pushLayer(s, i);
+    }
+
+    return 1;
+}
+
+void genAreaThreaded(LayerStack *g, int layerId, int *out, int areaX, int areaZ,
+        int areaWidth, int areaHeight, int threads)
+{
+    Layer *layer = &g->layers[layerId];
+    size_t base = layer->arena != NULL ? layer->arena->used : 0;
+    size_t scratch;
+    AreaSchedule s;
+    AreaWorker *wk;
+    Layer *order, *l, *p;
+    int *mem;
+    thread_id_t *threadID;
+    int t, i, cnt, ok, started;
+
+    if (threads <= 1)
+    {
+        genArea(layer, out, areaX, areaZ, areaWidth, areaHeight);
+        return;
+    }
+
+    order = beginRequest(layer, out, areaX, areaZ, areaWidth, areaHeight,
+            &mem, &scratch);
+
+    for (cnt = 0, l = order; l != NULL; l = l->next)
+        cnt++;
+
+    memset(&s, 0, sizeof(s));
+    s.g = g;
+    s.cnt = cnt;
+    s.threads = threads;
+    s.layers = (Layer **) malloc(cnt * sizeof(Layer *));
+    s.dep = (char *) calloc((size_t)cnt * cnt, 1);
+    s.deps = (int *) malloc(cnt * sizeof(int));
+    s.strips = (int *) malloc(cnt * sizeof(int));
+    s.pending = (int *) malloc(cnt * sizeof(int));
+    s.queue = (int *) malloc((size_t)cnt * threads * sizeof(int));
+    wk = (AreaWorker *) calloc(threads, sizeof(AreaWorker));
+    threadID = (thread_id_t *) malloc(threads * sizeof(thread_id_t));
+
+    ok = s.layers && s.dep && s.deps && s.strips && s.pending && s.queue && wk &&
+            threadID;
+
+    for (t = 0; ok && t < threads; t++)
+        ok = (wk[t].layers = (Layer *) malloc(g->layerCnt * sizeof(Layer))) != NULL;
+
+    if (ok)
+    {
+        for (i = 0, l = order; l != NULL; l = l->next, i++)
+            s.layers[i] = l;
+        ok = initSchedule(&s, layer);
+    }
+
+    if (!ok)
+    {
+        // generate the plan in order on the calling thread
+        for (l = order; l != NULL; l = l->next)
+        {
+            if (l->data != NULL)
+                genLayerArea(l, l->data, l->areaX, l->areaZ, l->areaW, l->areaH);
+            finishLayer(l);
+        }
+    }
+    else
+    {
+        for (t = 0; t < threads; t++)
+        {
+            wk[t].sched = &s;
+            memcpy(wk[t].layers, g->layers, g->layerCnt * sizeof(Layer));
+            for (i = 0; i < g->layerCnt; i++)
+            {
+                l = &wk[t].layers[i];
+                p = l->p;
+                if (p >= g->layers && p < g->layers + g->layerCnt)
+                    l->p = wk[t].layers + (p - g->layers);
+                p = l->p2;
+                if (p >= g->layers && p < g->layers + g->layerCnt)
+                    l->p2 = wk[t].layers + (p - g->layers);
+                // the tile cache is not shared between threads
+                l->tiles = NULL;
+                l->arena = &wk[t].arena;
+            }
+            if (scratch > 0)
+            {
+                wk[t].arena.mem = (int *) malloc(scratch * sizeof(int));
+                wk[t].arena.size = wk[t].arena.mem != NULL ? scratch : 0;
+            }
+        }
+
+        // the tasks are taken from a shared queue, so the calling thread also
+        // runs the share of any thread that could not be started
+#ifdef USE_PTHREAD
+        pthread_mutex_init(&s.lock, NULL);
+        pthread_mutex_init(&s.serial, NULL);
+        pthread_cond_init(&s.cond, NULL);
+
+        for (t = 1, started = 0; t < threads; t++)
+        {
+            if (pthread_create(&threadID[started], NULL, genWorkerThread, (void*)&wk[t]) == 0)
+                started++;
+        }
+
+        runSchedule(&wk[0]);
+
+        for (t = 0; t < started; t++)
+            pthread_join(threadID[t], NULL);
+
+        pthread_cond_destroy(&s.cond);
+        pthread_mutex_destroy(&s.serial);
+        pthread_mutex_destroy(&s.lock);
+#else
+        InitializeCriticalSection(&s.lock);
+        InitializeCriticalSection(&s.serial);
+        InitializeConditionVariable(&s.cond);
+
+        for (t = 1, started = 0; t < threads; t++)
+        {
+            threadID[started] = CreateThread(NULL, 0, genWorkerThread, (LPVOID)&wk[t], 0, NULL);
+            if (threadID[started] != NULL)
+                started++;
+        }
+
+        runSchedule(&wk[0]);
+
+        // (WaitForMultipleObjects() is limited to 64 handles)
+        for (t = 0; t < started; t++)
+        {
+            WaitForSingleObject(threadID[t], INFINITE);
+            CloseHandle(threadID[t]);
+        }
+
+        DeleteCriticalSection(&s.serial);
+        DeleteCriticalSection(&s.lock);
+#endif
+    }
+
+    endRequest(layer, order, mem, base);
+
+    if (wk != NULL)
+    {
+        for (t = 0; t < threads; t++)
+        {
+            free(wk[t].arena.mem);
+            free(wk[t].layers);
+        }
+        free(wk);
+    }
+    free(threadID);
+    free(s.queue);
+    free(s.pending);
+    free(s.strips);
+    free(s.deps);
+    free(s.dep);
+    free(s.layers);
+}
 
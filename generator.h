@@ -187,6 +187,8 @@ STRUCT(LayerStack)
 {
     Layer *layers;
     int layerCnt;
+    LayerArena *arena;  // scratch memory shared by the layers
+    TileCache *tiles;   // optional cache of generated tiles
 };
 
 #ifdef __cplusplus
@@ -202,7 +204,10 @@ void freeGenerator(LayerStack g);
 
 
 /* Calculates the minimum size of the buffers required to generate an area of
- * dimensions 'sizeX' by 'sizeZ' at the specified layer.
+ * dimensions 'sizeX' by 'sizeZ' at the specified layer. The intermediate
+ * layers are generated into scratch memory of the generator, but the buffer
+ * is large enough to also hold the area of any ancestor of the layer that the
+ * request involves, so that it can be reused for those layers.
  */
 int calcRequiredBuf(Layer *layer, int areaX, int areaZ);
 
@@ -211,6 +216,10 @@ int calcRequiredBuf(Layer *layer, int areaX, int areaZ);
  */
 int *allocCache(Layer *layer, int sizeX, int sizeZ);
 
+/* Allocates a buffer for genArea8() or genArea16() respectively. */
+uint8_t *allocCache8(Layer *layer, int sizeX, int sizeZ);
+uint16_t *allocCache16(Layer *layer, int sizeX, int sizeZ);
+
 
 /* Set up custom layers. */
 void setupLayer(int scale, Layer *l, Layer *p, int s, void (*getMap)(Layer *layer, int *out, int x, int z, int w, int h));
@@ -220,14 +229,133 @@ void setupMultiLayer(int scale, Layer *l, Layer *p1, Layer *p2, int s, void (*ge
 /* Sets the world seed for the generator */
 void applySeed(LayerStack *g, int64_t seed);
 
+/* Sets up a bounded cache of generated tiles for the generator. The tiles are
+ * (1 << tileShift) entries wide and up to 'tileCnt' of them are kept, shared
+ * between all layers that opt in using enableTileCache(). Repeated requests
+ * for the same seed, such as structure checks around one region, then reuse
+ * the tiles that have already been generated. The cache is invalidated by
+ * applySeed(), except for the tiles of the ocean temperatures
+ * (L13_OCEAN_TEMP_256 or one of the L13_ZOOM_* layers), which only depend on
+ * the lower 48 bits of the seed and are kept while these bits stay the same.
+ * Returns zero on failure.
+ */
+int setupTileCache(LayerStack *g, int tileShift, int tileCnt);
+
+/* Makes the given layer of the generator use the tile cache. Returns zero if
+ * no tile cache has been set up, or if an ancestor or descendant of the layer
+ * already uses it: the tiles of a layer each need several tiles of a cached
+ * ancestor, which can evict each other, so the work would grow exponentially
+ * with the number of cached layers along a chain.
+ * Caching a layer of each independent branch (e.g. L_DEEP_OCEAN_256 for point
+ * queries across a region) works best.
+ */
+int enableTileCache(LayerStack *g, int layerId);
+
 /* Generates the specified area using the current generator settings and stores
  * the biomeIDs in 'out'.
  * The biomeIDs will be indexed in the form: out[x + z*areaWidth]
- * It is recommended that 'out' is allocated using allocCache() for the correct
- * buffer size.
+ * The area that is needed from each layer is planned ahead using the zoom and
+ * margins of the layers. The layers are then generated parents first, each
+ * into a scratch buffer of exactly its planned size, and buffers are reused as
+ * soon as all children of a layer are done. The requested layer writes into
+ * 'out' directly, which only has to hold areaWidth*areaHeight entries.
  */
 void genArea(Layer *layer, int *out, int areaX, int areaZ, int areaWidth, int areaHeight);
 
+/* Like genArea(), but the rows of the area are stored 'rowStride' entries
+ * apart, in the form: out[x + z*rowStride]. The entries in between are left
+ * untouched, so the area can go directly into a row of an image, a slice of a
+ * larger map, etc. The zoom layers L_VORONOI_ZOOM_1 and the L_ZOOM_* layers
+ * write their rows into 'out' in place, while other layers are generated into
+ * scratch memory first.
+ */
+void genAreaStrided(Layer *layer, int *out, size_t rowStride,
+        int areaX, int areaZ, int areaWidth, int areaHeight);
+
+/* Generates the specified area of the layer 'layerId' for up to SEED_LANES
+ * world seeds at once, for searches that check the same area for many seeds,
+ * with the same result as applySeed() followed by genArea() for each seed.
+ * The map of seeds[k] is stored in out[k*areaWidth*areaHeight + x +
+ * z*areaWidth], but only for the lanes k whose bit is set in 'mask', which
+ * lets seeds that a filter already rejected drop out. The layers down to the
+ * 1:256 biomes (but not those of the ocean variants) are evaluated with one
+ * seed per vector lane, which takes AVX-512. The lanes cost the same no matter
+ * how many of them are in the mask, so once fewer than six seeds remain, or
+ * without AVX-512, the seeds are generated one after another.
+ * (NOTE: the world seed of the layers will be modified)
+ */
+void genAreaSeeds(LayerStack *g, int layerId, const int64_t *seeds, int mask,
+        int *out, int areaX, int areaZ, int areaWidth, int areaHeight);
+
+/* Generates the single entry (x,z) of a layer, with the same result as a 1x1
+ * area of genArea(). Rather than generating the whole planned area of each
+ * layer, only the parent entries that the result actually depends on are
+ * evaluated (see getLayerPoint()), and they are memoized in a fixed-size
+ * buffer on the stack. This is considerably faster for scattered positions.
+ */
+int genPoint(Layer *layer, int x, int z);
+
+/* Generates the entries (x[i],z[i]) of a layer for i in [0,n) into out[i],
+ * with the same results as genPoint(). The points are grouped into clusters
+ * of 1024x1024 blocks, and the layer entries that the points of a cluster
+ * have in common, notably those of the large scale layers, are evaluated
+ * only once. Dense clusters are generated as a whole with genArea().
+ * This is faster than separate queries for any set of points that are not
+ * all far apart, and faster than a bounding box for sparse sets.
+ */
+void genPoints(Layer *layer, const int *x, const int *z, int *out, int n);
+
+/* Checks whether all the entries of the specified area of a layer are valid,
+ * as given by the table 'isValid', which is indexed by the biome ID (& 0xff).
+ * The entries are evaluated one at a time like in genPoint(), coarse to fine
+ * across the area, and the check stops at the first invalid entry. The
+ * layers are therefore only generated as far as that entry depends on them,
+ * which makes rejections cheap. Returns 1 if all entries are valid, 0 if not.
+ */
+int checkArea(Layer *layer, int areaX, int areaZ, int areaWidth, int areaHeight,
+        const int *isValid);
+
+/* Generates the specified area in bands of 'bandHeight' rows (the last band
+ * may be shorter) and passes each band to 'consume' as soon as it is done.
+ * The band holds the rows [z, z+rowCnt) and is indexed in the form:
+ * rows[x + (z'-z)*areaWidth]. It is only valid during the call.
+ * Each layer keeps a rolling window of the rows that the next band needs, so
+ * the memory use is proportional to the width of the area rather than to the
+ * whole area, and no row of any layer is generated more than once.
+ * Generation stops early if 'consume' returns a non-zero value, which is then
+ * returned. Otherwise the return value is zero (or -1 if out of memory).
+ */
+int genAreaRows(Layer *layer, int areaX, int areaZ, int areaWidth, int areaHeight,
+        int bandHeight, int (*consume)(void *data, const int *rows, int z, int rowCnt),
+        void *data);
+
+/* Like genArea(), but stores the entries as 8-bit or 16-bit values, which
+ * takes a quarter or half of the memory for large maps. Only the requested
+ * layer is narrowed: the layers are generated as usual in bands of rows (see
+ * genAreaRows()) that are converted as they are done, so no int buffer of the
+ * whole area is needed either.
+ * The biome IDs of the final layers fit into 8 bits. The intermediate layers
+ * that keep extra bits in their entries, like the special flags of the 1:1024
+ * to 1:256 layers (bits 8-11), need 16 bits. Negative values, such as the
+ * unset entries of the river layers, are truncated to the low bits, and the
+ * noise of the river branch before L_RIVER_4 does not fit at all.
+ * Returns zero on success or -1 if out of memory.
+ */
+int genArea8(Layer *layer, uint8_t *out, int areaX, int areaZ, int areaWidth, int areaHeight);
+int genArea16(Layer *layer, uint16_t *out, int areaX, int areaZ, int areaWidth, int areaHeight);
+
+/* Like genArea() for the layer 'layerId' of the generator, but spreads the
+ * work over 'threads' threads. A layer is generated as soon as its parents are
+ * done, so the independent branches that feed a layer with two parents (such
+ * as the biome and river branches of the river mix) run concurrently. The rows
+ * of each layer with a large enough area are further divided between the
+ * threads. The halos at the seams are never generated twice and the result is
+ * identical to genArea(). Layers with a tile cache are generated by one thread
+ * at a time.
+ */
+void genAreaThreaded(LayerStack *g, int layerId, int *out, int areaX, int areaZ,
+        int areaWidth, int areaHeight, int threads);
+
 
 #ifdef __cplusplus
 }
@@ -1,6 +1,7 @@
 #include "layers.h"
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <stdio.h>
 
 
@@ -23,10 +24,47 @@ void createMutation(int id)
     biomes[id+128].id = id+128;
 }
 
+/* Instruction set level of the vectorised layer functions. */
+static int simdLevel = SIMD_NONE;
+
+#ifdef SIMD_DISPATCH
+static void initBiomeCats();
+static inline int isBiomeJFTO(int id);
+#endif
+
+int setSimdLevel(int level)
+{
+    int best = SIMD_NONE;
+
+#ifdef SIMD_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq"))
+        best = SIMD_AVX512;
+    else if (__builtin_cpu_supports("avx2"))
+        best = SIMD_AVX2;
+    else if (__builtin_cpu_supports("sse4.2"))
+        best = SIMD_SSE4_2;
+#endif
+
+    if (level > best)
+        level = best;
+    if (level < SIMD_NONE)
+        level = SIMD_NONE;
+    simdLevel = level;
+    return level;
+}
+
+int getSimdLevel()
+{
+    return simdLevel;
+}
+
 /* initBiomes() has to be called before any of the generators can be used */
 void initBiomes()
 {
     int i;
+
+    setSimdLevel(SIMD_BEST);
     for (i = 0; i < 256; i++) biomes[i].id = none;
 
     const double hDefault = 0.1, hShallowWaters = -0.5, hOceans = -1.0, hDeepOceans = -1.8, hLowPlains = 0.125;
@@ -117,18 +155,107 @@ void initBiomes()
     initAddBiome(crimson_forest, Warm, Nether, 2.0, hDefault);
     initAddBiome(warped_forest, Warm, Nether, 2.0, hDefault);
     initAddBiome(basalt_deltas, Warm, Nether, 2.0, hDefault);
+
+#ifdef SIMD_DISPATCH
+    initBiomeCats();
+#endif
 }
 
+#ifdef SIMD_DISPATCH
 
-void setWorldSeed(Layer *layer, int64_t seed)
+/* Categories of the biomes that the neighbour rules of the vectorised layers
+ * test for, as bit flags in a table that can be gathered from.
+ */
+enum
+{
+    BC_SHALLOW  = 0x001,    // isShallowOcean()
+    BC_OCEANIC  = 0x002,    // isOceanic()
+    BC_SNOWY    = 0x004,    // isBiomeSnowy()
+    BC_JUNGLE   = 0x008,    // existing biome of type Jungle
+    BC_JFTO     = 0x010,    // isBiomeJFTO()
+    BC_MESA     = 0x020,    // getBiomeType() == Mesa, also beyond 0xff
+    BC_EQ_WBP   = 0x040,    // equalOrPlateau(id, wooded_badlands_plateau)
+    BC_EQ_BP    = 0x080,    // equalOrPlateau(id, badlands_plateau)
+    BC_EQ_GTT   = 0x100,    // equalOrPlateau(id, giant_tree_taiga)
+};
+
+static int biomeCats[256];
+
+static void initBiomeCats()
+{
+    int id, c;
+
+    for (id = 0; id < 256; id++)
+    {
+        c = 0;
+        if (isShallowOcean(id)) c |= BC_SHALLOW;
+        if (isOceanic(id)) c |= BC_OCEANIC;
+        if (isBiomeSnowy(id)) c |= BC_SNOWY;
+        if (biomeExists(id) && getBiomeType(id) == Jungle) c |= BC_JUNGLE;
+        if (isBiomeJFTO(id)) c |= BC_JFTO;
+        if (getBiomeType(id) == Mesa) c |= BC_MESA;
+        if (equalOrPlateau(id, wooded_badlands_plateau)) c |= BC_EQ_WBP;
+        if (equalOrPlateau(id, badlands_plateau)) c |= BC_EQ_BP;
+        if (equalOrPlateau(id, giant_tree_taiga)) c |= BC_EQ_GTT;
+        biomeCats[id] = c;
+    }
+}
+
+/* The categories of 16 biome IDs. IDs outside of [0, 0xff] do not exist and
+ * only keep the type, which getBiomeType() takes from the lowest byte.
+ */
+SIMD_AVX512_FUNC static inline __m512i biomeCats16(__m512i id)
+{
+    __mmask16 valid = _mm512_cmple_epu32_mask(id, _mm512_set1_epi32(0xff));
+    __m512i c = _mm512_i32gather_epi32(_mm512_and_si512(id, _mm512_set1_epi32(0xff)), biomeCats, 4);
+    return _mm512_mask_and_epi32(c, ~valid, c, _mm512_set1_epi32(BC_MESA));
+}
+
+/* The categories of 8 biome IDs in 64-bit lanes, see biomeCats16(). */
+SIMD_AVX512_FUNC static inline __m512i biomeCats8(__m512i id)
+{
+    __mmask8 valid = _mm512_cmple_epu64_mask(id, _mm512_set1_epi64(0xff));
+    __m512i c = _mm512_cvtepi32_epi64(_mm512_i64gather_epi32(
+            _mm512_and_si512(id, _mm512_set1_epi64(0xff)), biomeCats, 4));
+    return _mm512_mask_and_epi64(c, ~valid, c, _mm512_set1_epi64(BC_MESA));
+}
+
+/* Loads 8 entries into 64-bit lanes. */
+SIMD_AVX512_FUNC static inline __m512i load8Ints64(const int *p)
+{
+    return _mm512_cvtepi32_epi64(_mm256_loadu_si256((const __m256i*)p));
+}
+
+#endif // SIMD_DISPATCH
+
+
+/* Counts the references to each layer from children that pass on the world
+ * seed. Shared parents are only descended into on their first reference.
+ */
+static void countSeedRefs(Layer *layer)
+{
+    if (layer->p2 != NULL && layer->getMap != mapHills && layer->p2->refs++ == 0)
+        countSeedRefs(layer->p2);
+
+    if (layer->p != NULL && layer->p->refs++ == 0)
+        countSeedRefs(layer->p);
+}
+
+/* Seeds the layer and moves on to each parent once its last reference has
+ * been resolved, so that every layer in the graph is visited exactly once.
+ */
+static void seedLayer(Layer *layer, int64_t seed)
 {
-    if (layer->p2 != NULL && layer->getMap != mapHills)
-        setWorldSeed(layer->p2, seed);
+    if (layer->p2 != NULL && layer->getMap != mapHills && --layer->p2->refs == 0)
+        seedLayer(layer->p2, seed);
 
-    if (layer->p != NULL)
-        setWorldSeed(layer->p, seed);
+    if (layer->p != NULL && --layer->p->refs == 0)
+        seedLayer(layer->p, seed);
 
-    if (layer->oceanRnd != NULL)
+    // the ocean data only depends on the lower 48 bits, as it is drawn from a
+    // Java Random, so sweeps over the upper 16 bits can keep it
+    if (layer->oceanRnd != NULL && (!layer->oceanRnd->init ||
+        layer->oceanRnd->seed != (seed & 0xffffffffffff)))
         oceanRndInit(layer->oceanRnd, seed);
 
     layer->worldSeed = seed;
@@ -140,6 +267,258 @@ void setWorldSeed(Layer *layer, int64_t seed)
     layer->worldSeed += layer->baseSeed;
 }
 
+void setWorldSeed(Layer *layer, int64_t seed)
+{
+    countSeedRefs(layer);
+    seedLayer(layer, seed);
+}
+
+
+/* Whether the tiles of a layer only depend on the lower 48 bits of the world
+ * seed. This holds for the ocean temperatures and the zoom layers above them,
+ * as the zoom only uses the lower 32 bits of its seeds.
+ */
+static int hasSeed48Tiles(const Layer *l)
+{
+    while (l != NULL && l->getMap == mapZoom)
+        l = l->p;
+    return l != NULL && l->oceanRnd != NULL;
+}
+
+/* The epoch that a tile of the layer has to match to be valid. */
+static unsigned int getTileEpoch(const TileCache *tc, const Layer *l)
+{
+    return l != NULL && hasSeed48Tiles(l) ? tc->epoch48 : tc->epoch;
+}
+
+/* Looks up the tile (tx,tz) of a layer in its tile cache and generates it if
+ * it is not present. The returned tile stays valid until the next lookup.
+ */
+static const int *getLayerTile(Layer *l, int tx, int tz)
+{
+    TileCache *tc = l->tiles;
+    const int tileW = 1 << tc->tileShift;
+    const int seed48 = hasSeed48Tiles(l);
+    const unsigned int epoch = seed48 ? tc->epoch48 : tc->epoch;
+    const int64_t seed = seed48 ? l->worldSeed & 0xffffffffffff : l->worldSeed;
+    uint64_t hash;
+    TileSlot *set, *slot;
+    int *buf, *data, i;
+
+    hash = (uint64_t)(uintptr_t) l * 0x9E3779B97F4A7C15ULL;
+    hash ^= (uint64_t) seed;
+    hash ^= (uint64_t)(uint32_t) tx * 0xC2B2AE3D27D4EB4FULL;
+    hash ^= (uint64_t)(uint32_t) tz * 0x165667B19E3779F9ULL;
+    hash ^= hash >> 29;
+    hash *= 0xBF58476D1CE4E5B9ULL;
+    hash ^= hash >> 32;
+
+    set = tc->slots + (hash % tc->setCnt) * TILE_WAYS;
+    for (i = 0; i < TILE_WAYS; i++)
+    {
+        slot = &set[i];
+        if (slot->epoch == epoch && slot->layer == l &&
+            slot->seed == seed && slot->x == tx && slot->z == tz)
+        {
+            slot->stamp = ++tc->clock;
+            return tc->data + (size_t)(slot - tc->slots) * tileW * tileW;
+        }
+    }
+
+    // generate the tile before picking a slot, since the generation of the
+    // parents can also end up in this set
+    buf = allocScratch(l, tileW * tileW);
+    l->getMap(l, buf, tx * tileW, tz * tileW, tileW, tileW);
+
+    slot = set;
+    for (i = 0; i < TILE_WAYS; i++)
+    {
+        if (set[i].epoch != getTileEpoch(tc, set[i].layer))
+        {
+            slot = &set[i];
+            break;
+        }
+        if (set[i].stamp < slot->stamp)
+            slot = &set[i];
+    }
+
+    slot->layer = l;
+    slot->seed = seed;
+    slot->x = tx;
+    slot->z = tz;
+    slot->epoch = epoch;
+    slot->stamp = ++tc->clock;
+
+    data = tc->data + (size_t)(slot - tc->slots) * tileW * tileW;
+    memcpy(data, buf, tileW * tileW * sizeof(int));
+    freeScratch(l, buf);
+
+    return data;
+}
+
+static void genTiledArea(Layer *l, int * __restrict out, size_t stride,
+        int x, int z, int w, int h)
+{
+    const int s = l->tiles->tileShift;
+    const int tileW = 1 << s;
+    int tx, tz, j;
+
+    for (tz = z >> s; tz <= (z + h - 1) >> s; tz++)
+    {
+        int z0 = tz << s, z1 = z0 + tileW;
+        if (z0 < z) z0 = z;
+        if (z1 > z + h) z1 = z + h;
+
+        for (tx = x >> s; tx <= (x + w - 1) >> s; tx++)
+        {
+            int x0 = tx << s, x1 = x0 + tileW;
+            if (x0 < x) x0 = x;
+            if (x1 > x + w) x1 = x + w;
+
+            const int *tile = getLayerTile(l, tx, tz);
+
+            for (j = z0; j < z1; j++)
+            {
+                memcpy(&out[(x0 - x) + (j - z) * stride],
+                        &tile[(x0 - (tx << s)) + (size_t)(j - (tz << s)) * tileW],
+                        (x1 - x0) * sizeof(int));
+            }
+        }
+    }
+}
+
+void genLayerArea(Layer *l, int * __restrict out, int x, int z, int w, int h)
+{
+    if (l->valid &&
+        x >= l->areaX && x + w <= l->areaX + l->areaW &&
+        z >= l->areaZ && z + h <= l->areaZ + l->areaH)
+    {
+        const int *src = l->data + (x - l->areaX) + (size_t)(z - l->areaZ) * l->areaW;
+        int j;
+
+        for (j = 0; j < h; j++)
+            memcpy(&out[(size_t)j*w], &src[(size_t)j*l->areaW], w*sizeof(int));
+        return;
+    }
+
+    if (l->tiles != NULL)
+    {
+        genTiledArea(l, out, w, x, z, w, h);
+        return;
+    }
+
+    l->getMap(l, out, x, z, w, h);
+}
+
+static void zoomArea(Layer *l, int * __restrict out, size_t outStride,
+        int areaX, int areaZ, int areaWidth, int areaHeight);
+static void voronoiArea(Layer *l, int * __restrict out, size_t outStride,
+        int areaX, int areaZ, int areaWidth, int areaHeight);
+
+void genLayerAreaStrided(Layer *l, int * __restrict out, size_t stride,
+        int x, int z, int w, int h)
+{
+    int j;
+
+    if (stride == (size_t)w)
+    {
+        genLayerArea(l, out, x, z, w, h);
+        return;
+    }
+
+    if (l->valid &&
+        x >= l->areaX && x + w <= l->areaX + l->areaW &&
+        z >= l->areaZ && z + h <= l->areaZ + l->areaH)
+    {
+        const int *src = l->data + (x - l->areaX) + (size_t)(z - l->areaZ) * l->areaW;
+
+        for (j = 0; j < h; j++)
+            memcpy(&out[j*stride], &src[(size_t)j*l->areaW], w*sizeof(int));
+        return;
+    }
+
+    if (l->tiles != NULL)
+    {
+        genTiledArea(l, out, stride, x, z, w, h);
+        return;
+    }
+
+    if (l->getMap == mapZoom)
+    {
+        zoomArea(l, out, stride, x, z, w, h);
+        return;
+    }
+    if (l->getMap == mapVoronoiZoom)
+    {
+        voronoiArea(l, out, stride, x, z, w, h);
+        return;
+    }
+
+    // other layers write contiguous rows
+    int *buf = allocScratch(l, (size_t)w * h);
+    l->getMap(l, buf, x, z, w, h);
+    for (j = 0; j < h; j++)
+        memcpy(&out[j*stride], &buf[(size_t)j*w], w*sizeof(int));
+    freeScratch(l, buf);
+}
+
+void requestArea(Layer *l, LayerView *v, int x, int z, int w, int h)
+{
+    if (l->valid &&
+        x >= l->areaX && x + w <= l->areaX + l->areaW &&
+        z >= l->areaZ && z + h <= l->areaZ + l->areaH)
+    {
+        v->data = l->data + (x - l->areaX) + (size_t)(z - l->areaZ) * l->areaW;
+        v->stride = l->areaW;
+        v->buf = NULL;
+        return;
+    }
+
+    v->buf = allocScratch(l, (size_t)w * h);
+    genLayerArea(l, v->buf, x, z, w, h);
+    v->data = v->buf;
+    v->stride = w;
+}
+
+void releaseArea(Layer *l, LayerView *v)
+{
+    if (v->buf != NULL)
+        freeScratch(l, v->buf);
+    v->buf = NULL;
+}
+
+/* Large parts of the world are uniform at a given scale, such as the open and
+ * deep oceans. Several layers map a neighbourhood of equal entries to a single
+ * value, which does not depend on the random values, and fill a uniform area
+ * of their parents without visiting the entries. Their output is uniform in
+ * turn, which lets the next layers down the stack do the same.
+ */
+static int isUniformArea(const LayerView *v, int w, int h)
+{
+    const int u = v->data[0];
+    int x, z, d;
+
+    for (z = 0; z < h; z++)
+    {
+        const int *row = v->data + (size_t)z * v->stride;
+        for (d = 0, x = 0; x < w; x++)
+            d |= row[x] ^ u;
+        if (d)
+            return 0;
+    }
+    return 1;
+}
+
+static void fillArea(int *out, size_t stride, int v, int w, int h)
+{
+    int i, j;
+    for (j = 0; j < h; j++, out += stride)
+    {
+        for (i = 0; i < w; i++)
+            out[i] = v;
+    }
+}
+
 
 void mapNull(Layer *l, int * __restrict out, int x, int z, int w, int h)
 {
@@ -152,9 +531,49 @@ void mapSkip(Layer *l, int * __restrict out, int x, int z, int w, int h)
         printf("mapSkip() requires a non-null parent layer.\n");
         exit(1);
     }
-    l->p->getMap(l->p, out, x, z, w, h);
+    genLayerArea(l->p, out, x, z, w, h);
+}
+
+
+#ifdef SIMD_DISPATCH
+
+/* Generates the entries [0, w) of the row z of mapIsland() starting at x, in
+ * groups of 8 with the full 64-bit chunk seeds, and returns the number done.
+ */
+SIMD_AVX512_FUNC
+static int islandRowAVX512(int *row, int x, int z, int w, int64_t ss)
+{
+    const __m512i vss = _mm512_set1_epi64(ss);
+    const __m512i zs = _mm512_set1_epi64(z);
+    // (cs >> 24) lies in [-2^39, 2^39), which this offset makes positive
+    // without changing the remainder by 10
+    const __m512i off = _mm512_set1_epi64(5LL << 40);
+    const __m512i inv5 = _mm512_set1_epi64((int64_t)0xCCCCCCCCCCCCCCCDULL);
+    const __m512i max5 = _mm512_set1_epi64(0x3333333333333333LL);
+    const __m512i one = _mm512_set1_epi64(1);
+    __m512i xs = _mm512_add_epi64(_mm512_set1_epi64(x),
+            _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7));
+    __m512i v;
+    __mmask8 m;
+    int i;
+
+    for (i = 0; i + 8 <= w; i += 8)
+    {
+        v = _mm512_add_epi64(_mm512_srai_epi64(set8ChunkSeeds64(vss, xs, zs), 24), off);
+        // divisible by 10: even, and half of it times the inverse of 5
+        // modulo 2^64 does not exceed (2^64-1) / 5
+        m = _mm512_testn_epi64_mask(v, one);
+        v = _mm512_mullo_epi64(_mm512_srli_epi64(v, 1), inv5);
+        m &= _mm512_cmple_epu64_mask(v, max5);
+        _mm256_storeu_si256((__m256i*)(row + i),
+                _mm512_cvtepi64_epi32(_mm512_maskz_mov_epi64(m, one)));
+        xs = _mm512_add_epi64(xs, _mm512_set1_epi64(8));
+    }
+
+    return i;
 }
 
+#endif // SIMD_DISPATCH
 
 void mapIsland(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
 {
@@ -165,7 +584,12 @@ void mapIsland(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWid
 
     for (z = 0; z < areaHeight; z++)
     {
-        for (x = 0; x < areaWidth; x++)
+        x = 0;
+#ifdef SIMD_DISPATCH
+        if (simdLevel >= SIMD_AVX512)
+            x = islandRowAVX512(out + z*areaWidth, areaX, areaZ + z, areaWidth, ss);
+#endif
+        for (; x < areaWidth; x++)
         {
             const int64_t chunkX = (int64_t)(x + areaX);
             const int64_t chunkZ = (int64_t)(z + areaZ);
@@ -188,229 +612,476 @@ void mapIsland(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWid
     }
 }
 
-// FIXME: currently SIMD only works properly for certain sizes
-#if defined USE_SIMD && defined __AVX2__
+#ifdef SIMD_DISPATCH
 
-void mapZoom(Layer *l, int* __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+SIMD_AVX512_FUNC
+static int chunkIntsRowAVX512(int *row, int x, int z, int w, int64_t ss, int mod)
 {
-    int pWidth = (areaWidth>>1)+2, pHeight = (areaHeight>>1)+1;
-    
-    l->p->getMap(l->p, out, areaX>>1, areaZ>>1, pWidth, pHeight+1);
-    
-    __m256i (*selectRand)(__m256i* cs, int ws, __m256i a1, __m256i a2, __m256i a3, __m256i a4) = (l->p->getMap == mapIsland) ? select8Random4 : select8ModeOrRandom;
-    int newWidth = (areaWidth+10)&0xFFFFFFFE;//modified to ignore ends
-    int x, z;
-    __m256i cs, a, b, a1, b1, toBuf1, toBuf2, aSuf;
-    __m256i mask1 = _mm256_setr_epi32(0xFFFFFFFF, 0x0, 0xFFFFFFFF, 0x0, 0xFFFFFFFF, 0x0, 0xFFFFFFFF, 0x0), mask2 = _mm256_setr_epi32(0x0, 0xFFFFFFFF, 0x0, 0xFFFFFFFF, 0x0, 0xFFFFFFFF, 0x0, 0xFFFFFFFF);
-    __m256i shuffle = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
-    int pX = areaX&0xFFFFFFFE;
-    __m256i xs = _mm256_set_epi32(pX+14, pX+12, pX+10, pX+8, pX+6, pX+4, pX+2, pX), zs;
-    __m256i v2 = _mm256_set1_epi32(2), v16 = _mm256_set1_epi32(16);
-    int* buf = (int*) malloc((newWidth+1)*((areaHeight+2)|1)*sizeof(*buf));
-    int* idx = buf;
-    int* outIdx = out;    
-    //z first!
-    for (x = 0; x < pWidth-1; x += 8)
-    {
-        a = _mm256_loadu_si256((__m256i*)(outIdx));//0, 0
-        b = _mm256_loadu_si256((__m256i*)(outIdx+1));//1, 0
-        zs = _mm256_set1_epi32(areaZ&0xFFFFFFFE);
-        for (z = 0; z < pHeight; z++)
-        {
-            cs = set8ChunkSeeds(l->worldSeed, xs, zs);
-            outIdx += pWidth;
-            a1 = _mm256_loadu_si256((__m256i*)(outIdx));//0, 1
-            b1 = _mm256_loadu_si256((__m256i*)(outIdx+1));//1, 1
-            toBuf1 = _mm256_permutevar8x32_epi32(select8Random2(&cs, l->worldSeed, a, a1), shuffle);
-            toBuf2 = _mm256_permutevar8x32_epi32(select8Random2(&cs, l->worldSeed, a, b), shuffle);
-            aSuf = _mm256_permutevar8x32_epi32(a, shuffle);
-            _mm256_maskstore_epi32(idx, mask1, aSuf);
-            _mm256_maskstore_epi32(idx+1, mask1, toBuf2);
-            _mm256_maskstore_epi32(idx+7, mask2, aSuf);
-            _mm256_maskstore_epi32(idx+8, mask2, toBuf2);
-            idx += newWidth;
-            toBuf2 = _mm256_permutevar8x32_epi32(selectRand(&cs, l->worldSeed, a, b, a1, b1), shuffle);
-            _mm256_maskstore_epi32(idx, mask1, toBuf1);
-            _mm256_maskstore_epi32(idx+1, mask1, toBuf2);
-            _mm256_maskstore_epi32(idx+7, mask2, toBuf1);
-            _mm256_maskstore_epi32(idx+8, mask2, toBuf2);
-            idx += newWidth;
-            a = a1;
-            b = b1;
-            zs = _mm256_add_epi32(zs, v2);
-        }
-        outIdx += 8-pHeight*pWidth;        
-        idx += 16-pHeight*2*newWidth;    
-        xs = _mm256_add_epi32(xs, v16);
-    }
+    const __m512i vss = _mm512_set1_epi64(ss);
+    const __m512i zs = _mm512_set1_epi64(z);
+    __m512i xs = _mm512_add_epi64(_mm512_set1_epi64(x),
+            _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7));
+    __m512i v;
+    int i;
 
-    for (z = 0; z < areaHeight; z++)
+    for (i = 0; i + 8 <= w; i += 8)
     {
-        memcpy(&out[z*areaWidth], &buf[(z + (areaZ & 1))*newWidth + (areaX & 1)], areaWidth*sizeof(int));
+        v = _mm512_srai_epi64(set8ChunkSeeds64(vss, xs, zs), 24);
+        _mm256_storeu_si256((__m256i*)(row + i), _mm512_cvtepi64_epi32(mod8Int64(v, mod)));
+        xs = _mm512_add_epi64(xs, _mm512_set1_epi64(8));
     }
 
-    free(buf);
+    return i;
 }
 
-#elif defined USE_SIMD && defined __SSE4_2__
+#endif // SIMD_DISPATCH
 
-void mapZoom(Layer *l, int* __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+void genChunkInts(int64_t ss, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight, int mod)
 {
-    int pWidth = (areaWidth>>1)+2, pHeight = (areaHeight>>1)+1;
-    
-    l->p->getMap(l->p, out, areaX>>1, areaZ>>1, pWidth, pHeight+1);
-    
-    __m128i (*selectRand)(__m128i* cs, int ws, __m128i a1, __m128i a2, __m128i a3, __m128i a4) = (l->p->getMap == mapIsland) ? select4Random4 : select4ModeOrRandom;
-    int newWidth = areaWidth+6&0xFFFFFFFE;//modified to ignore ends
+    ChunkSeedRow row;
     int x, z;
-    __m128i cs, a, b, a1, b1, toBuf1, toBuf2, aSuf;
-    __m128i mask1 = _mm_setr_epi32(0xFFFFFFFF, 0x0, 0xFFFFFFFF, 0x0), mask2 = _mm_setr_epi32(0x0, 0xFFFFFFFF, 0x0, 0xFFFFFFFF);
-    int pX = areaX&0xFFFFFFFE;
-    __m128i xs = _mm_set_epi32(pX+6, pX+4, pX+2, pX), zs;
-    __m128i v2 = _mm_set1_epi32(2), v8 = _mm_set1_epi32(8);
-    int* buf = (int*) malloc((newWidth+1)*(areaHeight+2|1)*sizeof(*buf));
-    int* idx = buf;
-    int* outIdx = out;
-    //z first!
-    for (x = 0; x < pWidth-1; x += 4)
-    {
-        a = _mm_loadu_si128((__m128i_u*)(outIdx));//0, 0
-        b = _mm_loadu_si128((__m128i_u*)(outIdx+1));//1, 0
-        zs = _mm_set1_epi32(areaZ&0xFFFFFFFE);
-        for (z = 0; z < pHeight; z++)
-        {
-            cs = set4ChunkSeeds(l->worldSeed, xs, zs);
-            outIdx += pWidth;
-            a1 = _mm_loadu_si128((__m128i_u*)(outIdx));//0, 1
-            b1 = _mm_loadu_si128((__m128i_u*)(outIdx+1));//1, 1
-            toBuf1 = _mm_shuffle_epi32(select4Random2(&cs, l->worldSeed, a, a1), 0xD8);//11011000->3120->1324
-            toBuf2 = _mm_shuffle_epi32(select4Random2(&cs, l->worldSeed, a, b), 0xD8);
-            aSuf = _mm_shuffle_epi32(a, 0xD8);
-            _mm_maskmoveu_si128(aSuf, mask1, (char*)(idx));
-            _mm_maskmoveu_si128(toBuf2, mask1, (char*)(idx+1));
-            _mm_maskmoveu_si128(aSuf, mask2, (char*)(idx+3));
-            _mm_maskmoveu_si128(toBuf2, mask2, (char*)(idx+4));
-            idx += newWidth;
-            toBuf2 = _mm_shuffle_epi32(selectRand(&cs, l->worldSeed, a, b, a1, b1), 0xD8);
-            _mm_maskmoveu_si128(toBuf1, mask1, (char*)(idx));
-            _mm_maskmoveu_si128(toBuf2, mask1, (char*)(idx+1));
-            _mm_maskmoveu_si128(toBuf1, mask2, (char*)(idx+3));
-            _mm_maskmoveu_si128(toBuf2, mask2, (char*)(idx+4));
-            idx += newWidth;            
-            a = a1;
-            b = b1;
-            zs = _mm_add_epi32(zs, v2);
-        }
-        outIdx += 4-pHeight*pWidth;
-        idx += 8-pHeight*2*newWidth;
-        xs = _mm_add_epi32(xs, v8);
-    }
 
     for (z = 0; z < areaHeight; z++)
     {
-        memcpy(&out[z*areaWidth], &buf[(z + (areaZ & 1))*newWidth + (areaX & 1)], areaWidth*sizeof(int));
+        x = 0;
+#ifdef SIMD_DISPATCH
+        if (simdLevel >= SIMD_AVX512)
+            x = chunkIntsRowAVX512(out + z*areaWidth, areaX, areaZ + z, areaWidth, ss, mod);
+#endif
+        initChunkSeedRow(&row, ss, x + areaX, z + areaZ, 1, areaWidth - x);
+        for (; x < areaWidth; x++, nextChunkSeedRow(&row))
+        {
+            int64_t cs = getRowChunkSeed(&row);
+            int r = (int)((cs >> 24) % mod);
+            out[x + z*areaWidth] = r < 0 ? r + mod : r;
+        }
+    }
+}
+
+#ifdef SIMD_DISPATCH
+
+/* Zooms the parent columns [x, xmax) of the rows 'in0' and 'in1' in groups of
+ * 8 (which are read up to column xmax) into the output rows 'row0' and 'row1',
+ * where the block of column x starts at 'ox'. Rows that are NULL are not
+ * stored. Returns the column at which the remainder starts.
+ */
+SIMD_AVX2_FUNC
+static int zoomRowAVX2(int *row0, int *row1, int ox, const int *in0, const int *in1,
+        int x, int xmax, int chunkX, int chunkZ, int ws, int isIsland)
+{
+    const __m256i zs = _mm256_set1_epi32(chunkZ);
+    __m256i xs = _mm256_add_epi32(_mm256_set1_epi32(chunkX),
+            _mm256_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14));
+    __m256i a, a1, b, b1, cs, v01, v10, v11, lo, hi;
+    int i;
+
+    for (i = ox; x + 8 <= xmax; x += 8, i += 16)
+    {
+        a  = _mm256_loadu_si256((const __m256i*)(in0 + x));
+        a1 = _mm256_loadu_si256((const __m256i*)(in0 + x + 1));
+        b  = _mm256_loadu_si256((const __m256i*)(in1 + x));
+        b1 = _mm256_loadu_si256((const __m256i*)(in1 + x + 1));
+        cs = _mm256_and_si256(_mm256_cmpeq_epi32(a, a1),
+                _mm256_and_si256(_mm256_cmpeq_epi32(a, b), _mm256_cmpeq_epi32(a, b1)));
+
+        if (_mm256_movemask_epi8(cs) == -1)
+        {
+            // uniform blocks need no random values
+            v01 = v10 = v11 = a;
+        }
+        else
+        {
+            cs = set8ChunkSeeds(ws, xs, zs);
+            v01 = select8Random2(&cs, ws, a, b);
+            v10 = select8Random2(&cs, ws, a, a1);
+            if (isIsland)
+                v11 = select8Random4(&cs, ws, a, a1, b, b1);
+            else
+                v11 = select8ModeOrRandom(&cs, ws, a, a1, b, b1);
+        }
+        xs = _mm256_add_epi32(xs, _mm256_set1_epi32(16));
+
+        // interleave the columns of the 2x2 blocks
+        if (row0)
+        {
+            lo = _mm256_unpacklo_epi32(a, v10);
+            hi = _mm256_unpackhi_epi32(a, v10);
+            _mm256_storeu_si256((__m256i*)(row0 + i), _mm256_permute2x128_si256(lo, hi, 0x20));
+            _mm256_storeu_si256((__m256i*)(row0 + i + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+        }
+        if (row1)
+        {
+            lo = _mm256_unpacklo_epi32(v01, v11);
+            hi = _mm256_unpackhi_epi32(v01, v11);
+            _mm256_storeu_si256((__m256i*)(row1 + i), _mm256_permute2x128_si256(lo, hi, 0x20));
+            _mm256_storeu_si256((__m256i*)(row1 + i + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+        }
     }
 
-    free(buf);
+    return x;
 }
 
-#else
+/* Like zoomRowAVX2(), in groups of 16 columns. */
+SIMD_AVX512_FUNC
+static int zoomRowAVX512(int *row0, int *row1, int ox, const int *in0, const int *in1,
+        int x, int xmax, int chunkX, int chunkZ, int ws, int isIsland)
+{
+    const __m512i zs = _mm512_set1_epi32(chunkZ);
+    const __m512i lo = _mm512_setr_epi32(0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23);
+    const __m512i hi = _mm512_setr_epi32(8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31);
+    __m512i xs = _mm512_add_epi32(_mm512_set1_epi32(chunkX),
+            _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30));
+    __m512i a, a1, b, b1, cs, v01, v10, v11;
+    int i;
 
-void mapZoom(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+    for (i = ox; x + 16 <= xmax; x += 16, i += 32)
+    {
+        a  = _mm512_loadu_si512((const void*)(in0 + x));
+        a1 = _mm512_loadu_si512((const void*)(in0 + x + 1));
+        b  = _mm512_loadu_si512((const void*)(in1 + x));
+        b1 = _mm512_loadu_si512((const void*)(in1 + x + 1));
+        if ((_mm512_cmpeq_epi32_mask(a, a1) & _mm512_cmpeq_epi32_mask(a, b) &
+             _mm512_cmpeq_epi32_mask(a, b1)) == 0xffff)
+        {
+            // uniform blocks need no random values
+            v01 = v10 = v11 = a;
+        }
+        else
+        {
+            cs = set16ChunkSeeds(ws, xs, zs);
+            v01 = select16Random2(&cs, ws, a, b);
+            v10 = select16Random2(&cs, ws, a, a1);
+            if (isIsland)
+                v11 = select16Random4(&cs, ws, a, a1, b, b1);
+            else
+                v11 = select16ModeOrRandom(&cs, ws, a, a1, b, b1);
+        }
+        xs = _mm512_add_epi32(xs, _mm512_set1_epi32(32));
+
+        // interleave the columns of the 2x2 blocks
+        if (row0)
+        {
+            _mm512_storeu_si512((void*)(row0 + i), _mm512_permutex2var_epi32(a, lo, v10));
+            _mm512_storeu_si512((void*)(row0 + i + 16), _mm512_permutex2var_epi32(a, hi, v10));
+        }
+        if (row1)
+        {
+            _mm512_storeu_si512((void*)(row1 + i), _mm512_permutex2var_epi32(v01, lo, v11));
+            _mm512_storeu_si512((void*)(row1 + i + 16), _mm512_permutex2var_epi32(v01, hi, v11));
+        }
+    }
+
+    return x;
+}
+
+/* Like zoomRowAVX2(), in groups of 4 columns. */
+SIMD_SSE4_2_FUNC
+static int zoomRowSSE42(int *row0, int *row1, int ox, const int *in0, const int *in1,
+        int x, int xmax, int chunkX, int chunkZ, int ws, int isIsland)
+{
+    const __m128i zs = _mm_set1_epi32(chunkZ);
+    __m128i xs = _mm_add_epi32(_mm_set1_epi32(chunkX), _mm_setr_epi32(0, 2, 4, 6));
+    __m128i a, a1, b, b1, cs, v01, v10, v11;
+    int i;
+
+    for (i = ox; x + 4 <= xmax; x += 4, i += 8)
+    {
+        a  = _mm_loadu_si128((const __m128i*)(in0 + x));
+        a1 = _mm_loadu_si128((const __m128i*)(in0 + x + 1));
+        b  = _mm_loadu_si128((const __m128i*)(in1 + x));
+        b1 = _mm_loadu_si128((const __m128i*)(in1 + x + 1));
+        cs = _mm_and_si128(_mm_cmpeq_epi32(a, a1),
+                _mm_and_si128(_mm_cmpeq_epi32(a, b), _mm_cmpeq_epi32(a, b1)));
+
+        if (_mm_movemask_epi8(cs) == 0xffff)
+        {
+            // uniform blocks need no random values
+            v01 = v10 = v11 = a;
+        }
+        else
+        {
+            cs = set4ChunkSeeds(ws, xs, zs);
+            v01 = select4Random2(&cs, ws, a, b);
+            v10 = select4Random2(&cs, ws, a, a1);
+            if (isIsland)
+                v11 = select4Random4(&cs, ws, a, a1, b, b1);
+            else
+                v11 = select4ModeOrRandom(&cs, ws, a, a1, b, b1);
+        }
+        xs = _mm_add_epi32(xs, _mm_set1_epi32(8));
+
+        // interleave the columns of the 2x2 blocks
+        if (row0)
+        {
+            _mm_storeu_si128((__m128i*)(row0 + i), _mm_unpacklo_epi32(a, v10));
+            _mm_storeu_si128((__m128i*)(row0 + i + 4), _mm_unpackhi_epi32(a, v10));
+        }
+        if (row1)
+        {
+            _mm_storeu_si128((__m128i*)(row1 + i), _mm_unpacklo_epi32(v01, v11));
+            _mm_storeu_si128((__m128i*)(row1 + i + 4), _mm_unpackhi_epi32(v01, v11));
+        }
+    }
+
+    return x;
+}
+
+#endif // SIMD_DISPATCH
+
+static void zoomArea(Layer *l, int * __restrict out, size_t outStride,
+        int areaX, int areaZ, int areaWidth, int areaHeight)
 {
     int pX = areaX >> 1;
     int pZ = areaZ >> 1;
-    int pWidth  = ((areaX + areaWidth ) >> 1) - pX + 1;
-    int pHeight = ((areaZ + areaHeight) >> 1) - pZ + 1;
+    int pWidth  = ((areaX + areaWidth  - 1) >> 1) - pX + 2;
+    int pHeight = ((areaZ + areaHeight - 1) >> 1) - pZ + 2;
     int x, z;
+    LayerView pv;
 
-    //printf("[%d %d] [%d %d]\n", pX, pZ, pWidth, pHeight);
-    l->p->getMap(l->p, out, pX, pZ, pWidth, pHeight);
+    requestArea(l->p, &pv, pX, pZ, pWidth, pHeight);
+    const int *in = pv.data;
+    const int stride = pv.stride;
 
-    int newWidth  = (pWidth) << 1;
-    int newHeight = (pHeight) << 1;
-    int idx, a, b;
-    int *buf = (int *)malloc((newWidth+1)*(newHeight+1)*sizeof(*buf));
+    if (isUniformArea(&pv, pWidth, pHeight))
+    {
+        // each entry is picked from four equal ones
+        fillArea(out, outStride, in[0], areaWidth, areaHeight);
+        releaseArea(l->p, &pv);
+        return;
+    }
 
     const int ws = (int)l->worldSeed;
-    const int ss = ws * (ws * 1284865837 + 4150755663);
+    // the 32-bit seeds are the lower halves of the 64-bit ones
+    const int64_t ss = l->worldSeed * (l->worldSeed * 6364136223846793005LL + 1442695040888963407LL);
+    const int isIsland = l->p->getMap == mapIsland;
+    ChunkSeedRow seeds;
 
-    for (z = 0; z < pHeight; z++)
+    for (z = 0; z < pHeight - 1; z++)
     {
-        idx = (z << 1) * newWidth;
-        a = out[(z+0)*pWidth];
-        b = out[(z+1)*pWidth];
-
-        for (x = 0; x < pWidth; x++)
+        // each parent entry becomes a 2x2 block, which is clipped to the area
+        const int oz = (z << 1) - (areaZ & 1);
+        int *row0 = oz >= 0 ? out + oz*outStride : NULL;
+        int *row1 = oz+1 < areaHeight ? out + (oz+1)*outStride : NULL;
+        const int *in0 = in + (size_t)z*stride;
+        const int *in1 = in0 + stride;
+        int xv = 0, xe = 0;
+
+#ifdef SIMD_DISPATCH
+        // the vectorised loop covers the parent columns [xv, xe), whose blocks
+        // lie entirely within the area, and the scalar loop does the rest
+        xv = xe = areaX & 1;
+        if (simdLevel >= SIMD_SSE4_2)
         {
-            int a1 = out[x+1 + (z+0)*pWidth];
-            int b1 = out[x+1 + (z+1)*pWidth];
-
-            const int chunkX = (x + pX) << 1;
             const int chunkZ = (z + pZ) << 1;
+            int xmax = (areaWidth + (areaX & 1)) >> 1;
+            if (xmax > pWidth - 1)
+                xmax = pWidth - 1;
+            // the wider kernels leave the remainder to the narrower ones
+            if (simdLevel >= SIMD_AVX512)
+                xe = zoomRowAVX512(row0, row1, (xe << 1) - (areaX & 1), in0, in1,
+                        xe, xmax, (xe + pX) << 1, chunkZ, ws, isIsland);
+            if (simdLevel >= SIMD_AVX2)
+                xe = zoomRowAVX2(row0, row1, (xe << 1) - (areaX & 1), in0, in1,
+                        xe, xmax, (xe + pX) << 1, chunkZ, ws, isIsland);
+            xe = zoomRowSSE42(row0, row1, (xe << 1) - (areaX & 1), in0, in1,
+                    xe, xmax, (xe + pX) << 1, chunkZ, ws, isIsland);
+        }
+#endif
 
-            register int cs = ss;
-            cs += chunkX;
-            cs *= cs * 1284865837 + 4150755663;
-            cs += chunkZ;
-            cs *= cs * 1284865837 + 4150755663;
-            cs += chunkX;
-            cs *= cs * 1284865837 + 4150755663;
-            cs += chunkZ;
-
-            buf[idx] = a;
-            buf[idx + newWidth] = (cs >> 24) & 1 ? b : a;
-            idx++;
-
-            cs *= cs * 1284865837 + 4150755663;
-            cs += ws;
-            buf[idx] = (cs >> 24) & 1 ? a1 : a;
+        initChunkSeedRow(&seeds, ss, pX << 1, (z + pZ) << 1, 2,
+                xv < xe ? xv : pWidth - 1);
+        for (x = 0; x < pWidth - 1; x++, nextChunkSeedRow(&seeds))
+        {
+            if (x == xv)
+            {
+                x = xe;
+                if (x >= pWidth - 1)
+                    break;
+                if (x != xv)
+                    initChunkSeedRow(&seeds, ss, (x + pX) << 1, (z + pZ) << 1, 2,
+                            pWidth - 1 - x);
+            }
 
+            int a = in0[x], a1 = in0[x+1];
+            int b = in1[x], b1 = in1[x+1];
+            int v01, v10, v11;
 
-            if (l->p->getMap == mapIsland)
+            if (a == a1 && a == b && a == b1)
             {
-                //selectRandom4
-                cs *= cs * 1284865837 + 4150755663;
-                cs += ws;
-                const int i = (cs >> 24) & 3;
-                buf[idx + newWidth] = i==0 ? a : i==1 ? a1 : i==2 ? b : b1;
+                // a uniform block needs no random values
+                v01 = v10 = v11 = a;
             }
             else
             {
-                //selectModeOrRandom
-                if      (a1 == b  && b  == b1) buf[idx + newWidth] = a1;
-                else if (a  == a1 && a  == b ) buf[idx + newWidth] = a;
-                else if (a  == a1 && a  == b1) buf[idx + newWidth] = a;
-                else if (a  == b  && a  == b1) buf[idx + newWidth] = a;
-                else if (a  == a1 && b  != b1) buf[idx + newWidth] = a;
-                else if (a  == b  && a1 != b1) buf[idx + newWidth] = a;
-                else if (a  == b1 && a1 != b ) buf[idx + newWidth] = a;
-                else if (a1 == b  && a  != b1) buf[idx + newWidth] = a1;
-                else if (a1 == b1 && a  != b ) buf[idx + newWidth] = a1;
-                else if (b  == b1 && a  != a1) buf[idx + newWidth] = b;
-                else
+                register int cs = (int)getRowChunkSeed(&seeds);
+
+                v01 = (cs >> 24) & 1 ? b : a;
+
+                cs *= cs * 1284865837 + 4150755663;
+                cs += ws;
+                v10 = (cs >> 24) & 1 ? a1 : a;
+
+                if (isIsland)
                 {
+                    //selectRandom4
                     cs *= cs * 1284865837 + 4150755663;
                     cs += ws;
                     const int i = (cs >> 24) & 3;
-                    buf[idx + newWidth] = i==0 ? a : i==1 ? a1 : i==2 ? b : b1;
+                    v11 = i==0 ? a : i==1 ? a1 : i==2 ? b : b1;
+                }
+                else
+                {
+                    //selectModeOrRandom
+                    if      (a1 == b  && b  == b1) v11 = a1;
+                    else if (a  == a1 && a  == b ) v11 = a;
+                    else if (a  == a1 && a  == b1) v11 = a;
+                    else if (a  == b  && a  == b1) v11 = a;
+                    else if (a  == a1 && b  != b1) v11 = a;
+                    else if (a  == b  && a1 != b1) v11 = a;
+                    else if (a  == b1 && a1 != b ) v11 = a;
+                    else if (a1 == b  && a  != b1) v11 = a1;
+                    else if (a1 == b1 && a  != b ) v11 = a1;
+                    else if (b  == b1 && a  != a1) v11 = b;
+                    else
+                    {
+                        cs *= cs * 1284865837 + 4150755663;
+                        cs += ws;
+                        const int i = (cs >> 24) & 3;
+                        v11 = i==0 ? a : i==1 ? a1 : i==2 ? b : b1;
+                    }
                 }
             }
 
-            idx++;
-            a = a1;
-            b = b1;
-        }
-    }
+            const int ox = (x << 1) - (areaX & 1);
+            if (row0)
+            {
+                if (ox >= 0) row0[ox] = a;
+                if (ox+1 < areaWidth) row0[ox+1] = v10;
+            }
+            if (row1)
+            {
+                if (ox >= 0) row1[ox] = v01;
+                if (ox+1 < areaWidth) row1[ox+1] = v11;
+            }
+        }
+    }
 
-    for (z = 0; z < areaHeight; z++)
+    releaseArea(l->p, &pv);
+}
+
+void mapZoom(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+{
+    zoomArea(l, out, areaWidth, areaX, areaZ, areaWidth, areaHeight);
+}
+
+/* Turns an ocean entry with land on some of its diagonals into land, taking
+ * the type of a random one of those neighbours.
+ */
+static inline int addIslandShore(int64_t cs, const int64_t ws, int v00, int v20, int v02, int v22)
+{
+    int v = 1;
+    int inc = 0;
+
+    if (v00 != 0)
     {
-        memcpy(&out[z*areaWidth], &buf[(z + (areaZ & 1))*newWidth + (areaX & 1)], areaWidth*sizeof(int));
+        ++inc; v = v00;
+        cs *= cs * 6364136223846793005LL + 1442695040888963407LL;
+        cs += ws;
+    }
+    if (v20 != 0)
+    {
+        if (++inc == 1 || (cs & (1LL << 24)) == 0) v = v20;
+        cs *= cs * 6364136223846793005LL + 1442695040888963407LL;
+        cs += ws;
+    }
+    if (v02 != 0)
+    {
+        switch(++inc)
+        {
+        case 1: v = v02; break;
+        case 2: if ((cs & (1LL << 24)) == 0) v = v02; break;
+        default: if (((cs >> 24) % 3) == 0) v = v02;
+        }
+        cs *= cs * 6364136223846793005LL + 1442695040888963407LL;
+        cs += ws;
+    }
+    if (v22 != 0)
+    {
+        switch(++inc)
+        {
+        case 1: v = v22; break;
+        case 2: if ((cs & (1LL << 24)) == 0) v = v22; break;
+        case 3: if (((cs >> 24) % 3) == 0) v = v22; break;
+        default: if ((cs & (3LL << 24)) == 0) v = v22;
+        }
+        cs *= cs * 6364136223846793005LL + 1442695040888963407LL;
+        cs += ws;
     }
 
-    free(buf);
+    if ((cs >> 24) % 3 == 0)
+        return v;
+    else if (v == 4)
+        return 4;
+    else
+        return 0;
 }
-#endif
+
+#ifdef SIMD_DISPATCH
+
+/* The stencil layers below take the parent rows z-1, z and z+1 from column
+ * x-1 as 'in0', 'in1' and 'in2'. Like the per-entry RNG layers, the ones that
+ * draw random values use 8 lanes of full 64-bit chunk seeds, and they only
+ * evaluate the seeds when a lane in the group needs them.
+ */
+SIMD_AVX512_FUNC
+static int addIslandRowAVX512(int *row, const int *in0, const int *in1, const int *in2,
+        int x, int z, int w, int64_t ss, int64_t ws)
+{
+    const __m512i vss = _mm512_set1_epi64(ss);
+    const __m512i zs = _mm512_set1_epi64(z);
+    const __m512i zero = _mm512_setzero_si512();
+    __m512i xs = _mm512_add_epi64(_mm512_set1_epi64(x),
+            _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7));
+    __m512i v00, v20, v02, v22, v11, r;
+    __mmask8 mshore, mland;
+    int i, k;
+
+    for (i = 0; i + 8 <= w; i += 8)
+    {
+        v00 = load8Ints64(in0 + i);
+        v20 = load8Ints64(in0 + i+2);
+        v02 = load8Ints64(in2 + i);
+        v22 = load8Ints64(in2 + i+2);
+        v11 = load8Ints64(in1 + i+1);
+
+        r = _mm512_or_si512(_mm512_or_si512(v00, v20), _mm512_or_si512(v02, v22));
+        mshore = _mm512_testn_epi64_mask(v11, v11) & _mm512_test_epi64_mask(r, r);
+        mland = _mm512_testn_epi64_mask(v00, v00) | _mm512_testn_epi64_mask(v20, v20) |
+                _mm512_testn_epi64_mask(v02, v02) | _mm512_testn_epi64_mask(v22, v22);
+        mland &= _mm512_cmpgt_epi64_mask(v11, zero);
+        if (mland)
+        {
+            r = mod8Int64(_mm512_srai_epi64(set8ChunkSeeds64(vss, xs, zs), 24), 5);
+            mland = _mm512_mask_testn_epi64_mask(mland, r, r);
+            mland &= _mm512_cmpneq_epi64_mask(v11, _mm512_set1_epi64(4));
+            v11 = _mm512_mask_mov_epi64(v11, mland, zero);
+        }
+        _mm256_storeu_si256((__m256i*)(row + i), _mm512_cvtepi64_epi32(v11));
+
+        // the shores draw a varying number of values and are done individually
+        for (k = 0; mshore; k++, mshore >>= 1)
+        {
+            if (mshore & 1)
+                row[i+k] = addIslandShore(getChunkSeed(ss, x+i+k, z), ws,
+                        in0[i+k], in0[i+k+2], in2[i+k], in2[i+k+2]);
+        }
+        xs = _mm512_add_epi64(xs, _mm512_set1_epi64(8));
+    }
+
+    return i;
+}
+
+#endif // SIMD_DISPATCH
 
 void mapAddIsland(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
 {
@@ -420,79 +1091,42 @@ void mapAddIsland(Layer *l, int * __restrict out, int areaX, int areaZ, int area
     int pHeight = areaHeight + 2;
     int x, z;
 
-    l->p->getMap(l->p, out, pX, pZ, pWidth, pHeight);
+    LayerView pv;
+    requestArea(l->p, &pv, pX, pZ, pWidth, pHeight);
+    const int *in = pv.data;
+    const int stride = pv.stride;
+
+    if (isUniformArea(&pv, pWidth, pHeight))
+    {
+        // neither shores nor coasts
+        fillArea(out, areaWidth, in[0], areaWidth, areaHeight);
+        releaseArea(l->p, &pv);
+        return;
+    }
 
     const int64_t ws = l->worldSeed;
     const int64_t ss = ws * (ws * 6364136223846793005LL + 1442695040888963407LL);
 
     for (z = 0; z < areaHeight; z++)
     {
-        for (x = 0; x < areaWidth; x++)
+        x = 0;
+#ifdef SIMD_DISPATCH
+        if (simdLevel >= SIMD_AVX512)
+            x = addIslandRowAVX512(out + z*areaWidth, in + z*stride, in + (z+1)*stride,
+                    in + (z+2)*stride, areaX, areaZ + z, areaWidth, ss, ws);
+#endif
+        for (; x < areaWidth; x++)
         {
-            int v00 = out[x+0 + (z+0)*pWidth];
-            int v20 = out[x+2 + (z+0)*pWidth];
-            int v02 = out[x+0 + (z+2)*pWidth];
-            int v22 = out[x+2 + (z+2)*pWidth];
-            int v11 = out[x+1 + (z+1)*pWidth];
+            int v00 = in[x+0 + (z+0)*stride];
+            int v20 = in[x+2 + (z+0)*stride];
+            int v02 = in[x+0 + (z+2)*stride];
+            int v22 = in[x+2 + (z+2)*stride];
+            int v11 = in[x+1 + (z+1)*stride];
 
             if (v11 == 0 && (v00 != 0 || v20 != 0 || v02 != 0 || v22 != 0))
             {
-                const int64_t chunkX = (int64_t)(x + areaX);
-                const int64_t chunkZ = (int64_t)(z + areaZ);
-                register int64_t cs = ss;
-                cs += chunkX;
-                cs *= cs * 6364136223846793005LL + 1442695040888963407LL;
-                cs += chunkZ;
-                cs *= cs * 6364136223846793005LL + 1442695040888963407LL;
-                cs += chunkX;
-                cs *= cs * 6364136223846793005LL + 1442695040888963407LL;
-                cs += chunkZ;
-
-                int v = 1;
-                int inc = 0;
-
-                if (v00 != 0)
-                {
-                    ++inc; v = v00;
-                    cs *= cs * 6364136223846793005LL + 1442695040888963407LL;
-                    cs += ws;
-                }
-                if (v20 != 0)
-                {
-                    if (++inc == 1 || (cs & (1LL << 24)) == 0) v = v20;
-                    cs *= cs * 6364136223846793005LL + 1442695040888963407LL;
-                    cs += ws;
-                }
-                if (v02 != 0)
-                {
-                    switch(++inc)
-                    {
-                    case 1: v = v02; break;
-                    case 2: if ((cs & (1LL << 24)) == 0) v = v02; break;
-                    default: if (((cs >> 24) % 3) == 0) v = v02;
-                    }
-                    cs *= cs * 6364136223846793005LL + 1442695040888963407LL;
-                    cs += ws;
-                }
-                if (v22 != 0)
-                {
-                    switch(++inc)
-                    {
-                    case 1: v = v22; break;
-                    case 2: if ((cs & (1LL << 24)) == 0) v = v22; break;
-                    case 3: if (((cs >> 24) % 3) == 0) v = v22; break;
-                    default: if ((cs & (3LL << 24)) == 0) v = v22;
-                    }
-                    cs *= cs * 6364136223846793005LL + 1442695040888963407LL;
-                    cs += ws;
-                }
-
-                if ((cs >> 24) % 3 == 0)
-                    out[x + z*areaWidth] = v;
-                else if (v == 4)
-                    out[x + z*areaWidth] = 4;
-                else
-                    out[x + z*areaWidth] = 0;
+                const int64_t cs = getChunkSeed(ss, x + areaX, z + areaZ);
+                out[x + z*areaWidth] = addIslandShore(cs, ws, v00, v20, v02, v22);
             }
             else if (v11 > 0 && (v00 == 0 || v20 == 0 || v02 == 0 || v22 == 0))
             {
@@ -522,8 +1156,46 @@ void mapAddIsland(Layer *l, int * __restrict out, int areaX, int areaZ, int area
             }
         }
     }
+
+    releaseArea(l->p, &pv);
+}
+
+
+#ifdef SIMD_DISPATCH
+
+SIMD_AVX512_FUNC
+static int removeOceanRowAVX512(int *row, const int *in0, const int *in1, const int *in2,
+        int x, int z, int w, int64_t ss)
+{
+    const __m512i vss = _mm512_set1_epi64(ss);
+    const __m512i zs = _mm512_set1_epi64(z);
+    __m512i xs = _mm512_add_epi64(_mm512_set1_epi64(x),
+            _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7));
+    __m512i v11, n, r;
+    __mmask8 m;
+    int i;
+
+    for (i = 0; i + 8 <= w; i += 8)
+    {
+        v11 = load8Ints64(in1 + i+1);
+        n = _mm512_or_si512(_mm512_or_si512(load8Ints64(in0 + i+1), load8Ints64(in1 + i+2)),
+                _mm512_or_si512(load8Ints64(in1 + i), load8Ints64(in2 + i+1)));
+        n = _mm512_or_si512(n, v11);
+        m = _mm512_testn_epi64_mask(n, n);
+        if (m)
+        {
+            r = mod8Int64(_mm512_srai_epi64(set8ChunkSeeds64(vss, xs, zs), 24), 2);
+            m = _mm512_mask_testn_epi64_mask(m, r, r);
+            v11 = _mm512_mask_mov_epi64(v11, m, _mm512_set1_epi64(1));
+        }
+        _mm256_storeu_si256((__m256i*)(row + i), _mm512_cvtepi64_epi32(v11));
+        xs = _mm512_add_epi64(xs, _mm512_set1_epi64(8));
+    }
+
+    return i;
 }
 
+#endif // SIMD_DISPATCH
 
 void mapRemoveTooMuchOcean(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
 {
@@ -533,19 +1205,33 @@ void mapRemoveTooMuchOcean(Layer *l, int * __restrict out, int areaX, int areaZ,
     int pHeight = areaHeight + 2;
     int x, z;
 
-    l->p->getMap(l->p, out, pX, pZ, pWidth, pHeight);
+    LayerView pv;
+    requestArea(l->p, &pv, pX, pZ, pWidth, pHeight);
+    const int *in = pv.data;
+    const int stride = pv.stride;
+
+#ifdef SIMD_DISPATCH
+    const int64_t ws = l->worldSeed;
+    const int64_t ss = ws * (ws * 6364136223846793005LL + 1442695040888963407LL);
+#endif
 
     for (z = 0; z < areaHeight; z++)
     {
-        for (x = 0; x < areaWidth; x++)
+        x = 0;
+#ifdef SIMD_DISPATCH
+        if (simdLevel >= SIMD_AVX512)
+            x = removeOceanRowAVX512(out + z*areaWidth, in + z*stride, in + (z+1)*stride,
+                    in + (z+2)*stride, areaX, areaZ + z, areaWidth, ss);
+#endif
+        for (; x < areaWidth; x++)
         {
-            int v11 = out[x+1 + (z+1)*pWidth];
+            int v11 = in[x+1 + (z+1)*stride];
             out[x + z*areaWidth] = v11;
 
-            if (out[x+1 + (z+0)*pWidth] != 0) continue;
-            if (out[x+2 + (z+1)*pWidth] != 0) continue;
-            if (out[x+0 + (z+1)*pWidth] != 0) continue;
-            if (out[x+1 + (z+2)*pWidth] != 0) continue;
+            if (in[x+1 + (z+0)*stride] != 0) continue;
+            if (in[x+2 + (z+1)*stride] != 0) continue;
+            if (in[x+0 + (z+1)*stride] != 0) continue;
+            if (in[x+1 + (z+2)*stride] != 0) continue;
 
             if (v11 == 0)
             {
@@ -558,388 +1244,531 @@ void mapRemoveTooMuchOcean(Layer *l, int * __restrict out, int areaX, int areaZ,
             }
         }
     }
-}
 
+    releaseArea(l->p, &pv);
+}
 
-void mapAddSnow(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
-{
-    int pX = areaX - 1;
-    int pZ = areaZ - 1;
-    int pWidth = areaWidth + 2;
-    int pHeight = areaHeight + 2;
-    int x, z;
 
-    l->p->getMap(l->p, out, pX, pZ, pWidth, pHeight);
-    
-    for (z = 0; z < areaHeight; z++)
-    {
-        for (x = 0; x < areaWidth; x++)
-        {
-            int v11 = out[x+1 + (z+1)*pWidth];
+/* Land bits: up to mapRemoveTooMuchOcean() the layers only hold land (1) and
+ * ocean (0), which are generated as rows of bits, such that the neighbour
+ * rules become word-wide boolean operations and only the entries that have
+ * to draw a random value are visited individually. mapAddSnow() unpacks the
+ * bits, since its values are wider.
+ * A row of bits for 'w' entries takes getBitStride(w) words, including a
+ * trailing word that lets getBits64() read past the end of the row.
+ */
 
-            if (isShallowOcean(v11))
-            {
-                out[x + z*areaWidth] = v11;
-            }
-            else
-            {
-                setChunkSeed(l, (int64_t)(x + areaX), (int64_t)(z + areaZ));
-                int r = mcNextInt(l, 6);
-                int v;
+enum { MAX_LAND_CHAIN = 32 };
 
-                if (r == 0)      v = 4;
-                else if (r <= 1) v = 3;
-                else            v = 1;
+static inline int getBitStride(int w)
+{
+    return ((w + 63) >> 6) + 1;
+}
 
-                out[x + z*areaWidth] = v;
-            }
-        }
-    }
+/* The 64 bits of a row from bit 'pos' on. */
+static inline uint64_t getBits64(const uint64_t *row, int pos)
+{
+    const uint64_t *p = row + (pos >> 6);
+    const int s = pos & 63;
+    return s ? (p[0] >> s) | (p[1] << (64 - s)) : p[0];
 }
 
+/* The index of the lowest set bit of 'm', which must not be zero. */
+static inline int lowestBit(uint64_t m)
+{
+#if defined __GNUC__
+    return __builtin_ctzll(m);
+#else
+    int i = 0;
+    for (; !(m & 1); m >>= 1)
+        i++;
+    return i;
+#endif
+}
 
+/* Spreads the lower 32 bits to the even bits. */
+static inline uint64_t spreadBits(uint64_t v)
+{
+    v &= 0xffffffffULL;
+    v = (v | (v << 16)) & 0x0000ffff0000ffffULL;
+    v = (v | (v << 8))  & 0x00ff00ff00ff00ffULL;
+    v = (v | (v << 4))  & 0x0f0f0f0f0f0f0f0fULL;
+    v = (v | (v << 2))  & 0x3333333333333333ULL;
+    v = (v | (v << 1))  & 0x5555555555555555ULL;
+    return v;
+}
 
+int hasLandBits(const Layer *l)
+{
+    for (; l != NULL; l = l->p)
+    {
+        if (l->tiles != NULL || l->p2 != NULL)
+            return 0;
+        if (l->getMap == mapIsland)
+            return l->p == NULL;
+        if (l->getMap != mapZoom && l->getMap != mapAddIsland &&
+            l->getMap != mapRemoveTooMuchOcean)
+            return 0;
+    }
+    return 0;
+}
 
-void mapCoolWarm(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+static void islandBits(Layer *l, uint64_t *out, int *tmp, int x, int z, int w, int h)
 {
-    int pX = areaX - 1;
-    int pZ = areaZ - 1;
-    int pWidth = areaWidth + 2;
-    int pHeight = areaHeight + 2;
-    int x, z;
+    const int64_t ws = l->worldSeed;
+    const int64_t ss = ws * (ws * 6364136223846793005LL + 1442695040888963407LL);
+    const int stride = getBitStride(w);
+    uint64_t *row;
+    int i, j;
 
-    l->p->getMap(l->p, out, pX, pZ, pWidth, pHeight);
+    memset(out, 0, (size_t)stride * h * sizeof(*out));
 
-    for (z = 0; z < areaHeight; z++)
+    for (j = 0; j < h; j++)
     {
-        for (x = 0; x < areaWidth; x++)
-        {
-            int v11 = out[x+1 + (z+1)*pWidth];
+        row = out + (size_t)j * stride;
+        genChunkInts(ss, tmp, x, z + j, w, 1, 10);
+        for (i = 0; i < w; i++)
+            row[i >> 6] |= (uint64_t)(tmp[i] == 0) << (i & 63);
+    }
 
-            if (v11 == 1)
-            {
-                int v10 = out[x+1 + (z+0)*pWidth];
-                int v21 = out[x+2 + (z+1)*pWidth];
-                int v01 = out[x+0 + (z+1)*pWidth];
-                int v12 = out[x+1 + (z+2)*pWidth];
+    if (x > -w && x <= 0 && z > -h && z <= 0)
+        out[(size_t)-z * stride + (-x >> 6)] |= 1ULL << (-x & 63);
+}
 
-                if (v10 == 3 || v10 == 4 || v21 == 3 || v21 == 4 || v01 == 3 || v01 == 4 || v12 == 3 || v12 == 4)
-                {
-                    v11 = 2;
-                }
-            }
+#ifdef SIMD_DISPATCH
 
-            out[x + z*areaWidth] = v11;
-        }
+/* Draws the random bits of mapZoom() for the blocks [0, n) of a row in groups
+ * of 16 and returns the number done.
+ */
+SIMD_AVX512_FUNC
+static int zoomBitsRowAVX512(uint64_t *r1, uint64_t *r2, uint64_t *r3lo, uint64_t *r3hi,
+        int n, int chunkX, int chunkZ, int ws)
+{
+    const __m512i zs = _mm512_set1_epi32(chunkZ);
+    const __m512i bit = _mm512_set1_epi32(1 << 24);
+    __m512i xs = _mm512_add_epi32(_mm512_set1_epi32(chunkX),
+            _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30));
+    __m512i cs;
+    int i;
+
+    for (i = 0; i + 16 <= n; i += 16)
+    {
+        cs = set16ChunkSeeds(ws, xs, zs);
+        r1[i >> 6] |= (uint64_t)_mm512_test_epi32_mask(cs, bit) << (i & 63);
+        mc16NextInt(&cs, ws, 0);
+        r2[i >> 6] |= (uint64_t)_mm512_test_epi32_mask(cs, bit) << (i & 63);
+        mc16NextInt(&cs, ws, 0);
+        r3lo[i >> 6] |= (uint64_t)_mm512_test_epi32_mask(cs, bit) << (i & 63);
+        r3hi[i >> 6] |= (uint64_t)_mm512_test_epi32_mask(cs, _mm512_slli_epi32(bit, 1)) << (i & 63);
+        xs = _mm512_add_epi32(xs, _mm512_set1_epi32(32));
     }
+
+    return i;
 }
 
+#endif // SIMD_DISPATCH
 
-void mapHeatIce(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+/* mapZoom() on bits. The parent entries (i,j) become blocks of 2x2 bits,
+ * which are assembled for 32 blocks at a time and then shifted onto the
+ * grid of the area.
+ */
+static void zoomBits(Layer *l, uint64_t *out, const uint64_t *in, uint64_t *tmp,
+        int x, int z, int w, int h)
 {
-    int pX = areaX - 1;
-    int pZ = areaZ - 1;
-    int pWidth = areaWidth + 2;
-    int pHeight = areaHeight + 2;
-    int x, z;
+    const int pX = x >> 1;
+    const int pZ = z >> 1;
+    const int pw = ((x + w - 1) >> 1) - pX + 2;
+    const int ph = ((z + h - 1) >> 1) - pZ + 2;
+    const int pstride = getBitStride(pw);
+    const int bstride = getBitStride(2*pw);
+    const int stride = getBitStride(w);
+    const int ws = (int)l->worldSeed;
+    const int64_t ss = l->worldSeed * (l->worldSeed * 6364136223846793005LL + 1442695040888963407LL);
+    const int isIsland = l->p->getMap == mapIsland;
+    ChunkSeedRow seeds;
 
-    l->p->getMap(l->p, out, pX, pZ, pWidth, pHeight);
+    uint64_t *r1 = tmp, *r2 = r1 + pstride, *r3lo = r2 + pstride, *r3hi = r3lo + pstride;
+    uint64_t *even = r3hi + pstride, *odd = even + bstride;
+    uint64_t a, a1, b, b1, s1, s2, s3lo, s3hi, v01, v10, v11, rnd, p, q, c, d, ge3, tie;
+    int i, j, k, oz;
 
-    for (z = 0; z < areaHeight; z++)
+    for (j = 0; j < ph - 1; j++)
     {
-        for (x = 0; x < areaWidth; x++)
+        const uint64_t *in0 = in + (size_t)j * pstride;
+        const uint64_t *in1 = in0 + pstride;
+        const int chunkZ = (j + pZ) << 1;
+
+        oz = (j << 1) - (z & 1);
+
+        // the random bits of each block
+        memset(r1, 0, 4 * pstride * sizeof(*r1));
+        i = 0;
+#ifdef SIMD_DISPATCH
+        if (simdLevel >= SIMD_AVX512)
+            i = zoomBitsRowAVX512(r1, r2, r3lo, r3hi, pw - 1, pX << 1, chunkZ, ws);
+#endif
+        initChunkSeedRow(&seeds, ss, (i + pX) << 1, chunkZ, 2, pw - 1 - i);
+        for (; i < pw - 1; i++, nextChunkSeedRow(&seeds))
         {
-            int v11 = out[x+1 + (z+1)*pWidth];
+            register int cs = (int)getRowChunkSeed(&seeds);
+            r1[i >> 6] |= (uint64_t)((cs >> 24) & 1) << (i & 63);
+            cs *= cs * 1284865837 + 4150755663;
+            cs += ws;
+            r2[i >> 6] |= (uint64_t)((cs >> 24) & 1) << (i & 63);
+            cs *= cs * 1284865837 + 4150755663;
+            cs += ws;
+            r3lo[i >> 6] |= (uint64_t)((cs >> 24) & 1) << (i & 63);
+            r3hi[i >> 6] |= (uint64_t)((cs >> 25) & 1) << (i & 63);
+        }
 
-            if (v11 == 4)
+        for (i = 0; i < pw - 1; i += 32)
+        {
+            a = getBits64(in0, i);
+            a1 = getBits64(in0, i+1);
+            b = getBits64(in1, i);
+            b1 = getBits64(in1, i+1);
+            s1 = getBits64(r1, i);
+            s2 = getBits64(r2, i);
+            s3lo = getBits64(r3lo, i);
+            s3hi = getBits64(r3hi, i);
+
+            v01 = (a & ~s1) | (b & s1);
+            v10 = (a & ~s2) | (a1 & s2);
+            // selectRandom4()
+            rnd = (((a & ~s3lo) | (a1 & s3lo)) & ~s3hi) | (((b & ~s3lo) | (b1 & s3lo)) & s3hi);
+
+            if (isIsland)
             {
-                int v10 = out[x+1 + (z+0)*pWidth];
-                int v21 = out[x+2 + (z+1)*pWidth];
-                int v01 = out[x+0 + (z+1)*pWidth];
-                int v12 = out[x+1 + (z+2)*pWidth];
-
-                if (v10 == 1 || v10 == 2 || v21 == 1 || v21 == 2 || v01 == 1 || v01 == 2 || v12 == 1 || v12 == 2)
-                {
-                    v11 = 3;
-                }
+                v11 = rnd;
+            }
+            else
+            {
+                // selectModeOrRandom() of bits: the majority, or a random
+                // entry when there is a tie
+                c = a & a1; d = a ^ a1;
+                p = b & b1; q = b ^ b1;
+                ge3 = (c & (p | q)) | (p & (c | d));
+                tie = (c & ~p & ~q) | (p & ~c & ~d) | (d & q);
+                v11 = ge3 | (tie & rnd);
             }
 
-            out[x + z*areaWidth] = v11;
+            even[i >> 5] = spreadBits(a) | (spreadBits(v10) << 1);
+            odd[i >> 5] = spreadBits(v01) | (spreadBits(v11) << 1);
+        }
+
+        for (k = 0; k < stride - 1; k++)
+        {
+            if (oz >= 0)
+                out[(size_t)oz * stride + k] = getBits64(even, (k << 6) + (x & 1));
+            if (oz + 1 < h)
+                out[(size_t)(oz+1) * stride + k] = getBits64(odd, (k << 6) + (x & 1));
         }
     }
 }
 
-
-void mapSpecial(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+/* mapAddIsland() on bits, where an ocean entry by the land of 'n' diagonals
+ * becomes land if the n-th next value is divisible by 3, see addIslandShore().
+ */
+static void addIslandBits(Layer *l, uint64_t *out, const uint64_t *in,
+        int x, int z, int w, int h)
 {
-    l->p->getMap(l->p, out, areaX, areaZ, areaWidth, areaHeight);
+    const int64_t ws = l->worldSeed;
+    const int64_t ss = ws * (ws * 6364136223846793005LL + 1442695040888963407LL);
+    const int pstride = getBitStride(w + 2);
+    const int stride = getBitStride(w);
+    uint64_t d00, d20, d02, d22, v, shore, land, m;
+    int64_t cs;
+    int i, j, k, n;
 
-    int x, z;
-    for (z = 0; z < areaHeight; z++)
+    for (j = 0; j < h; j++)
     {
-        for (x = 0; x < areaWidth; x++)
-        {
-            int v = out[x + z*areaWidth];
-            if (v == 0) continue;
+        const uint64_t *in0 = in + (size_t)j * pstride;
+        const uint64_t *in1 = in0 + pstride;
+        const uint64_t *in2 = in1 + pstride;
 
-            setChunkSeed(l, (int64_t)(x + areaX), (int64_t)(z + areaZ));
-
-            if (mcNextInt(l, 13) == 0)
+        for (k = 0; k < stride - 1; k++)
+        {
+            d00 = getBits64(in0, k << 6);
+            d20 = getBits64(in0, (k << 6) + 2);
+            d02 = getBits64(in2, k << 6);
+            d22 = getBits64(in2, (k << 6) + 2);
+            v = getBits64(in1, (k << 6) + 1);
+
+            shore = ~v & (d00 | d20 | d02 | d22);
+            land = v & ~(d00 & d20 & d02 & d22);
+            m = shore | land;
+            if (w - (k << 6) < 64)
+                m &= (1ULL << (w - (k << 6))) - 1;
+
+            for (; m; m &= m - 1)
             {
-                v |= (1 + mcNextInt(l, 15)) << 8 & 0xf00;
-                // 1 to 1 mapping so 'out' can be overwritten immediately
-                out[x + z*areaWidth] = v;
+                i = lowestBit(m);
+                cs = getChunkSeed(ss, x + (k << 6) + i, z + j);
+                if ((land >> i) & 1)
+                {
+                    if ((cs >> 24) % 5 == 0)
+                        v &= ~(1ULL << i);
+                }
+                else
+                {
+                    n = (int)(((d00 >> i) & 1) + ((d20 >> i) & 1) + ((d02 >> i) & 1) + ((d22 >> i) & 1));
+                    while (n--)
+                    {
+                        cs *= cs * 6364136223846793005LL + 1442695040888963407LL;
+                        cs += ws;
+                    }
+                    if ((cs >> 24) % 3 == 0)
+                        v |= 1ULL << i;
+                }
             }
+            out[(size_t)j * stride + k] = v;
         }
     }
 }
 
-
-void mapAddMushroomIsland(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+static void removeOceanBits(Layer *l, uint64_t *out, const uint64_t *in,
+        int x, int z, int w, int h)
 {
-    int pX = areaX - 1;
-    int pZ = areaZ - 1;
-    int pWidth = areaWidth + 2;
-    int pHeight = areaHeight + 2;
-    int x, z;
-
-    l->p->getMap(l->p, out, pX, pZ, pWidth, pHeight);
+    const int64_t ws = l->worldSeed;
+    const int64_t ss = ws * (ws * 6364136223846793005LL + 1442695040888963407LL);
+    const int pstride = getBitStride(w + 2);
+    const int stride = getBitStride(w);
+    uint64_t v, m;
+    int i, j, k;
 
-    for (z = 0; z < areaHeight; z++)
+    for (j = 0; j < h; j++)
     {
-        for (x = 0; x < areaWidth; x++)
+        const uint64_t *in0 = in + (size_t)j * pstride;
+        const uint64_t *in1 = in0 + pstride;
+        const uint64_t *in2 = in1 + pstride;
+
+        for (k = 0; k < stride - 1; k++)
         {
-            int v11 = out[x+1 + (z+1)*pWidth];
+            v = getBits64(in1, (k << 6) + 1);
+            m = ~(v | getBits64(in0, (k << 6) + 1) | getBits64(in1, (k << 6) + 2) |
+                    getBits64(in1, k << 6) | getBits64(in2, (k << 6) + 1));
+            if (w - (k << 6) < 64)
+                m &= (1ULL << (w - (k << 6))) - 1;
 
-            // surrounded by ocean?
-            if (v11 == 0 && !out[x+0 + (z+0)*pWidth] && !out[x+2 + (z+0)*pWidth] && !out[x+0 + (z+2)*pWidth] && !out[x+2 + (z+2)*pWidth])
+            for (; m; m &= m - 1)
             {
-                setChunkSeed(l, (int64_t)(x + areaX), (int64_t)(z + areaZ));
-                if (mcNextInt(l, 100) == 0) {
-                    out[x + z*areaWidth] = mushroom_fields;
-                    continue;
-                }
+                i = lowestBit(m);
+                if ((getChunkSeed(ss, x + (k << 6) + i, z + j) & (1LL << 24)) == 0)
+                    v |= 1ULL << i;
             }
-
-            out[x + z*areaWidth] = v11;
+            out[(size_t)j * stride + k] = v;
         }
     }
 }
 
-
-void mapDeepOcean(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+/* Generates the area of a layer for which hasLandBits() holds, as bits from
+ * the island layer on, and unpacks it into 'out'.
+ */
+static void genLandArea(Layer *l, int *out, int x, int z, int w, int h)
 {
-    int pX = areaX - 1;
-    int pZ = areaZ - 1;
-    int pWidth = areaWidth + 2;
-    int pHeight = areaHeight + 2;
-    int x, z;
-
-    l->p->getMap(l->p, out, pX, pZ, pWidth, pHeight);
-
-    for (z = 0; z < areaHeight; z++)
+    Layer *chain[MAX_LAND_CHAIN];
+    int area[MAX_LAND_CHAIN][4];
+    size_t size = 0, tmpSize = 0, n;
+    uint64_t *buf[2], *tmp, *src, *dst;
+    int *mem;
+    int cnt, i, j, k;
+
+    for (cnt = 0; l != NULL && cnt < MAX_LAND_CHAIN; l = l->p)
+        chain[cnt++] = l;
+
+    area[0][0] = x; area[0][1] = z;
+    area[0][2] = w; area[0][3] = h;
+    for (i = 0; i < cnt; i++)
     {
-        for (x = 0; x < areaWidth; x++)
+        if (i > 0)
         {
-            int v11 = out[(x+1) + (z+1)*pWidth];
+            memcpy(area[i], area[i-1], sizeof(area[i]));
+            getParentArea(chain[i-1], chain[i-1]->edge,
+                    &area[i][0], &area[i][1], &area[i][2], &area[i][3]);
+        }
+        n = (size_t)getBitStride(area[i][2]) * area[i][3];
+        if (n > size) size = n;
+        // the rows of random bits and of blocks of mapZoom(), or an int row
+        n = 6 * (size_t)getBitStride(2 * area[i][2]);
+        if (n < (size_t)area[i][2])
+            n = area[i][2];
+        if (n > tmpSize) tmpSize = n;
+    }
 
-            if (isShallowOcean(v11))
-            {
-                // count adjacent oceans
-                int oceans = 0;
-                if (isShallowOcean(out[(x+1) + (z+0)*pWidth])) oceans++;
-                if (isShallowOcean(out[(x+2) + (z+1)*pWidth])) oceans++;
-                if (isShallowOcean(out[(x+0) + (z+1)*pWidth])) oceans++;
-                if (isShallowOcean(out[(x+1) + (z+2)*pWidth])) oceans++;
-
-                if (oceans > 3)
-                {
-                    switch (v11)
-                    {
-                    case warm_ocean:
-                        v11 = deep_warm_ocean;
-                        break;
-                    case lukewarm_ocean:
-                        v11 = deep_lukewarm_ocean;
-                        break;
-                    case ocean:
-                        v11 = deep_ocean;
-                        break;
-                    case cold_ocean:
-                        v11 = deep_cold_ocean;
-                        break;
-                    case frozen_ocean:
-                        v11 = deep_frozen_ocean;
-                        break;
-                    default:
-                        v11 = deep_ocean;
-                    }
-                }
-            }
+    // the buffers of bits are aligned to whole words
+    mem = allocScratch(chain[0], 2 * (2 * size + tmpSize) + 2);
+    buf[0] = (uint64_t *)(((uintptr_t)mem + 7) & ~(uintptr_t)7);
+    buf[1] = buf[0] + size;
+    tmp = buf[1] + size;
 
-            out[x + z*areaWidth] = v11;
-        }
+    for (i = cnt-1; i >= 0; i--)
+    {
+        l = chain[i];
+        src = buf[(i+1) & 1];
+        dst = buf[i & 1];
+        x = area[i][0]; z = area[i][1];
+        w = area[i][2]; h = area[i][3];
+
+        if (l->getMap == mapIsland)
+            islandBits(l, dst, (int *) tmp, x, z, w, h);
+        else if (l->getMap == mapZoom)
+            zoomBits(l, dst, src, tmp, x, z, w, h);
+        else if (l->getMap == mapAddIsland)
+            addIslandBits(l, dst, src, x, z, w, h);
+        else
+            removeOceanBits(l, dst, src, x, z, w, h);
     }
-}
 
+    for (j = 0; j < h; j++)
+    {
+        const uint64_t *row = buf[0] + (size_t)j * getBitStride(w);
+        for (k = 0; k < w; k++)
+            out[k + (size_t)j*w] = (row[k >> 6] >> (k & 63)) & 1;
+    }
 
-const int warmBiomes[] = {desert, desert, desert, savanna, savanna, plains};
-const int lushBiomes[] = {forest, dark_forest, mountains, plains, birch_forest, swamp};
-const int coldBiomes[] = {forest, mountains, taiga, plains};
-const int snowBiomes[] = {snowy_tundra, snowy_tundra, snowy_tundra, snowy_taiga};
+    freeScratch(chain[0], mem);
+}
 
-void mapBiome(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+/* Like requestArea(), but a land/ocean parent that has not been generated as
+ * a whole is generated as bits (see genLandArea()).
+ */
+static void requestLandArea(Layer *l, LayerView *v, int x, int z, int w, int h)
 {
-    l->p->getMap(l->p, out, areaX, areaZ, areaWidth, areaHeight);
-
-    int x, z;
-    for (z = 0; z < areaHeight; z++)
+    if ((l->valid &&
+        x >= l->areaX && x + w <= l->areaX + l->areaW &&
+        z >= l->areaZ && z + h <= l->areaZ + l->areaH) || !hasLandBits(l))
     {
-        for (x = 0; x < areaWidth; x++)
-        {
-            int idx = x + z*areaWidth;
-            int id = out[idx];
-            int hasHighBit = (id & 0xf00) >> 8;
-            id &= -0xf01;
-
-            if (getBiomeType(id) == Ocean || id == mushroom_fields)
-            {
-                out[idx] = id;
-                continue;
-            }
-
-            setChunkSeed(l, (int64_t)(x + areaX), (int64_t)(z + areaZ));
-
-            switch(id){
-            case Warm:
-                if (hasHighBit) out[idx] = (mcNextInt(l, 3) == 0) ? badlands_plateau : wooded_badlands_plateau;
-                else out[idx] = warmBiomes[mcNextInt(l, 6)];
-                break;
-            case Lush:
-                if (hasHighBit) out[idx] = jungle;
-                else out[idx] = lushBiomes[mcNextInt(l, 6)];
-                break;
-            case Cold:
-                if (hasHighBit) out[idx] = giant_tree_taiga;
-                else out[idx] = coldBiomes[mcNextInt(l, 4)];
-                break;
-            case Freezing:
-                out[idx] = snowBiomes[mcNextInt(l, 4)];
-                break;
-            default:
-                out[idx] = mushroom_fields;
-            }
-        }
+        requestArea(l, v, x, z, w, h);
+        return;
     }
-}
 
+    v->buf = allocScratch(l, (size_t)w * h);
+    genLandArea(l, v->buf, x, z, w, h);
+    v->data = v->buf;
+    v->stride = w;
+}
 
-const int lushBiomesBE[] = {forest, dark_forest, mountains, plains, plains, plains, birch_forest, swamp};
+#ifdef SIMD_DISPATCH
 
-void mapBiomeBE(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+SIMD_AVX512_FUNC
+static int addSnowRowAVX512(int *row, const int *in, int x, int z, int w, int64_t ss)
 {
-    l->p->getMap(l->p, out, areaX, areaZ, areaWidth, areaHeight);
+    const __m512i vss = _mm512_set1_epi64(ss);
+    const __m512i zs = _mm512_set1_epi64(z);
+    __m512i xs = _mm512_add_epi64(_mm512_set1_epi64(x),
+            _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7));
+    __m512i v, r, t;
+    __mmask8 m;
+    int i;
 
-    int x, z;
-    for (z = 0; z < areaHeight; z++)
+    for (i = 0; i + 8 <= w; i += 8)
     {
-        for (x = 0; x < areaWidth; x++)
+        v = load8Ints64(in + i);
+        m = _mm512_testn_epi64_mask(biomeCats8(v), _mm512_set1_epi64(BC_SHALLOW));
+        if (m)
         {
-            int idx = x + z*areaWidth;
-            int id = out[idx];
-            int hasHighBit = (id & 0xf00) >> 8;
-            id &= -0xf01;
-
-            if (getBiomeType(id) == Ocean || id == mushroom_fields)
-            {
-                out[idx] = id;
-                continue;
-            }
-
-            setChunkSeed(l, (int64_t)(x + areaX), (int64_t)(z + areaZ));
-
-            switch(id){
-                case Warm:
-                    if (hasHighBit) out[idx] = (mcNextInt(l, 3) == 0) ? badlands_plateau : wooded_badlands_plateau;
-                    else out[idx] = warmBiomes[mcNextInt(l, 6)];
-                    break;
-                case Lush:
-                    if (hasHighBit) out[idx] = jungle;
-                    else out[idx] = lushBiomesBE[mcNextInt(l, 6)];
-                    break;
-                case Cold:
-                    if (hasHighBit) out[idx] = giant_tree_taiga;
-                    else out[idx] = coldBiomes[mcNextInt(l, 4)];
-                    break;
-                case Freezing:
-                    out[idx] = snowBiomes[mcNextInt(l, 4)];
-                    break;
-                default:
-                    out[idx] = mushroom_fields;
-            }
+            r = mod8Int64(_mm512_srai_epi64(set8ChunkSeeds64(vss, xs, zs), 24), 6);
+            t = _mm512_set1_epi64(1);
+            t = _mm512_mask_mov_epi64(t, _mm512_cmpeq_epi64_mask(r, _mm512_set1_epi64(1)),
+                    _mm512_set1_epi64(3));
+            t = _mm512_mask_mov_epi64(t, _mm512_testn_epi64_mask(r, r), _mm512_set1_epi64(4));
+            v = _mm512_mask_mov_epi64(v, m, t);
         }
+        _mm256_storeu_si256((__m256i*)(row + i), _mm512_cvtepi64_epi32(v));
+        xs = _mm512_add_epi64(xs, _mm512_set1_epi64(8));
     }
+
+    return i;
 }
 
+#endif // SIMD_DISPATCH
 
-void mapRiverInit(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+void mapAddSnow(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
 {
-    l->p->getMap(l->p, out, areaX, areaZ, areaWidth, areaHeight);
-
     int x, z;
+
+    LayerView pv;
+    requestLandArea(l->p, &pv, areaX, areaZ, areaWidth, areaHeight);
+    const int *in = pv.data;
+    const int stride = pv.stride;
+
+    const int64_t ws = l->worldSeed;
+    const int64_t ss = ws * (ws * 6364136223846793005LL + 1442695040888963407LL);
+    ChunkSeedRow seeds;
+
     for (z = 0; z < areaHeight; z++)
     {
-        for (x = 0; x < areaWidth; x++)
+        x = 0;
+#ifdef SIMD_DISPATCH
+        if (simdLevel >= SIMD_AVX512)
+            x = addSnowRowAVX512(out + z*areaWidth, in + z*stride, areaX, areaZ + z, areaWidth, ss);
+#endif
+        initChunkSeedRow(&seeds, ss, x + areaX, z + areaZ, 1, areaWidth - x);
+        for (; x < areaWidth; x++, nextChunkSeedRow(&seeds))
         {
-            if (out[x + z*areaWidth] > 0)
+            int v11 = in[x + z*stride];
+
+            if (isShallowOcean(v11))
             {
-                setChunkSeed(l, (int64_t)(x + areaX), (int64_t)(z + areaZ));
-                out[x + z*areaWidth] = mcNextInt(l, 299999)+2;
+                out[x + z*areaWidth] = v11;
             }
             else
             {
-                out[x + z*areaWidth] = 0;
+                l->chunkSeed = getRowChunkSeed(&seeds);
+                int r = mcNextInt(l, 6);
+                int v;
+
+                if (r == 0)      v = 4;
+                else if (r <= 1) v = 3;
+                else            v = 1;
+
+                out[x + z*areaWidth] = v;
             }
         }
     }
+
+    releaseArea(l->p, &pv);
 }
 
 
-void mapAddBamboo(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+
+
+#ifdef SIMD_DISPATCH
+
+/* The rule of mapCoolWarm() and mapHeatIce() for 16 entries at a time: an
+ * entry 'from' becomes 'to' when a direct neighbour is 'n' or 'n'+1.
+ */
+SIMD_AVX512_FUNC
+static int climateEdgeRowAVX512(int *row, const int *in0, const int *in1, const int *in2,
+        int w, int from, int to, int n)
 {
-    l->p->getMap(l->p, out, areaX, areaZ, areaWidth, areaHeight);
+    const __m512i vn = _mm512_set1_epi32(n);
+    const __m512i one = _mm512_set1_epi32(1);
+    __m512i v11;
+    __mmask16 m, mn;
+    int i;
 
-    int x, z;
-    for (z = 0; z < areaHeight; z++)
+    for (i = 0; i + 16 <= w; i += 16)
     {
-        for (x = 0; x < areaWidth; x++)
+        v11 = _mm512_loadu_si512(in1 + i+1);
+        m = _mm512_cmpeq_epi32_mask(v11, _mm512_set1_epi32(from));
+        if (m)
         {
-            int idx = x + z*areaWidth;
-            if (out[idx] != jungle) continue;
-
-            setChunkSeed(l, (int64_t)(x + areaX), (int64_t)(z + areaZ));
-            if (mcNextInt(l, 10) == 0)
-            {
-                out[idx] = bamboo_jungle;
-            }
+            mn = _mm512_cmple_epu32_mask(_mm512_sub_epi32(_mm512_loadu_si512(in0 + i+1), vn), one);
+            mn |= _mm512_cmple_epu32_mask(_mm512_sub_epi32(_mm512_loadu_si512(in1 + i+2), vn), one);
+            mn |= _mm512_cmple_epu32_mask(_mm512_sub_epi32(_mm512_loadu_si512(in1 + i), vn), one);
+            mn |= _mm512_cmple_epu32_mask(_mm512_sub_epi32(_mm512_loadu_si512(in2 + i+1), vn), one);
+            v11 = _mm512_mask_mov_epi32(v11, m & mn, _mm512_set1_epi32(to));
         }
+        _mm512_storeu_si512(row + i, v11);
     }
-}
-
-
-static inline int replaceEdge(int *out, int idx, int v10, int v21, int v01, int v12, int id, int baseID, int edgeID)
-{
-    if (id != baseID) return 0;
-
-    if (equalOrPlateau(v10, baseID) && equalOrPlateau(v21, baseID) && equalOrPlateau(v01, baseID) && equalOrPlateau(v12, baseID))
-        out[idx] = id;
-    else
-        out[idx] = edgeID;
 
-    return 1;
+    return i;
 }
 
-void mapBiomeEdge(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+#endif // SIMD_DISPATCH
+
+void mapCoolWarm(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
 {
     int pX = areaX - 1;
     int pZ = areaZ - 1;
@@ -947,310 +1776,215 @@ void mapBiomeEdge(Layer *l, int * __restrict out, int areaX, int areaZ, int area
     int pHeight = areaHeight + 2;
     int x, z;
 
-    l->p->getMap(l->p, out, pX, pZ, pWidth, pHeight);
+    LayerView pv;
+    requestArea(l->p, &pv, pX, pZ, pWidth, pHeight);
+    const int *in = pv.data;
+    const int stride = pv.stride;
 
     for (z = 0; z < areaHeight; z++)
     {
-        for (x = 0; x < areaWidth; x++)
+        x = 0;
+#ifdef SIMD_DISPATCH
+        if (simdLevel >= SIMD_AVX512)
+            x = climateEdgeRowAVX512(out + z*areaWidth, in + z*stride, in + (z+1)*stride,
+                    in + (z+2)*stride, areaWidth, 1, 2, 3);
+#endif
+        for (; x < areaWidth; x++)
         {
-            int v11 = out[x+1 + (z+1)*pWidth];
+            int v11 = in[x+1 + (z+1)*stride];
 
-            int v10 = out[x+1 + (z+0)*pWidth];
-            int v21 = out[x+2 + (z+1)*pWidth];
-            int v01 = out[x+0 + (z+1)*pWidth];
-            int v12 = out[x+1 + (z+2)*pWidth];
-
-            if (/*!replaceEdgeIfNecessary(out, x + z*areaWidth, v10, v21, v01, v12, v11, mountains, mountain_edge) &&*/
-               !replaceEdge(out, x + z*areaWidth, v10, v21, v01, v12, v11, wooded_badlands_plateau, badlands) &&
-               !replaceEdge(out, x + z*areaWidth, v10, v21, v01, v12, v11, badlands_plateau, badlands) &&
-               !replaceEdge(out, x + z*areaWidth, v10, v21, v01, v12, v11, giant_tree_taiga, taiga))
+            if (v11 == 1)
             {
-                if (v11 == desert)
-                {
-                    if (v10 != snowy_tundra && v21 != snowy_tundra && v01 != snowy_tundra && v12 != snowy_tundra)
-                    {
-                        out[x + z*areaWidth] = v11;
-                    }
-                    else
-                    {
-                        out[x + z*areaWidth] = wooded_mountains;
-                    }
-                }
-                else if (v11 == swamp)
-                {
-                    if (v10 != desert && v21 != desert && v01 != desert && v12 != desert &&
-                        v10 != snowy_taiga && v21 != snowy_taiga && v01 != snowy_taiga && v12 != snowy_taiga &&
-                        v10 != snowy_tundra && v21 != snowy_tundra && v01 != snowy_tundra && v12 != snowy_tundra)
-                    {
-                        if (v10 != jungle && v12 != jungle && v21 != jungle && v01 != jungle &&
-                            v10 != bamboo_jungle && v12 != bamboo_jungle &&
-                            v21 != bamboo_jungle && v01 != bamboo_jungle)
-                            out[x + z*areaWidth] = v11;
-                        else
-                            out[x + z*areaWidth] = jungleEdge;
-                    }
-                    else
-                    {
-                        out[x + z*areaWidth] = plains;
-                    }
-                }
-                else
+                int v10 = in[x+1 + (z+0)*stride];
+                int v21 = in[x+2 + (z+1)*stride];
+                int v01 = in[x+0 + (z+1)*stride];
+                int v12 = in[x+1 + (z+2)*stride];
+
+                if (v10 == 3 || v10 == 4 || v21 == 3 || v21 == 4 || v01 == 3 || v01 == 4 || v12 == 3 || v12 == 4)
                 {
-                    out[x + z*areaWidth] = v11;
+                    v11 = 2;
                 }
             }
+
+            out[x + z*areaWidth] = v11;
         }
     }
+
+    releaseArea(l->p, &pv);
 }
 
 
-void mapHills(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+void mapHeatIce(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
 {
     int pX = areaX - 1;
     int pZ = areaZ - 1;
     int pWidth = areaWidth + 2;
     int pHeight = areaHeight + 2;
     int x, z;
-    int *buf = NULL;
-
-    if (l->p2 == NULL)
-    {
-        printf("mapHills() requires two parents! Use setupMultiLayer()\n");
-        exit(1);
-    }
-
-    buf = (int *) malloc(pWidth*pHeight*sizeof(int));
 
-    l->p->getMap(l->p, out, pX, pZ, pWidth, pHeight);
-    memcpy(buf, out, pWidth*pHeight*sizeof(int));
-
-    l->p2->getMap(l->p2, out, pX, pZ, pWidth, pHeight);
+    LayerView pv;
+    requestArea(l->p, &pv, pX, pZ, pWidth, pHeight);
+    const int *in = pv.data;
+    const int stride = pv.stride;
 
     for (z = 0; z < areaHeight; z++)
     {
-        for (x = 0; x < areaWidth; x++)
+        x = 0;
+#ifdef SIMD_DISPATCH
+        if (simdLevel >= SIMD_AVX512)
+            x = climateEdgeRowAVX512(out + z*areaWidth, in + z*stride, in + (z+1)*stride,
+                    in + (z+2)*stride, areaWidth, 4, 3, 1);
+#endif
+        for (; x < areaWidth; x++)
         {
-            setChunkSeed(l, (int64_t)(x + areaX), (int64_t)(z + areaZ));
-            int a11 = buf[x+1 + (z+1)*pWidth]; // biome branch
-            int b11 = out[x+1 + (z+1)*pWidth]; // river branch
-            int idx = x + z*areaWidth;
-
-            int var12 = (b11 - 2) % 29 == 0;
+            int v11 = in[x+1 + (z+1)*stride];
 
-            if (a11 != 0 && b11 >= 2 && (b11 - 2) % 29 == 1 && a11 < 128)
-            {
-                out[idx] = (biomeExists(a11 + 128)) ? a11 + 128 : a11;
-            }
-            else if (mcNextInt(l, 3) != 0 && !var12)
-            {
-                out[idx] = a11;
-            }
-            else
+            if (v11 == 4)
             {
-                int hillID = a11;
-
-                switch(a11)
-                {
-                case desert:
-                    hillID = desert_hills; break;
-                case forest:
-                    hillID = wooded_hills; break;
-                case birch_forest:
-                    hillID = birch_forest_hills; break;
-                case dark_forest:
-                    hillID = plains; break;
-                case taiga:
-                    hillID = taiga_hills; break;
-                case giant_tree_taiga:
-                    hillID = giant_tree_taiga_hills; break;
-                case snowy_taiga:
-                    hillID = snowy_taiga_hills; break;
-                case plains:
-                    hillID = (mcNextInt(l, 3) == 0) ? wooded_hills : forest; break;
-                case snowy_tundra:
-                    hillID = snowy_mountains; break;
-                case jungle:
-                    hillID = jungle_hills; break;
-                case ocean:
-                    hillID = deep_ocean; break;
-                case mountains:
-                    hillID = wooded_mountains; break;
-                case savanna:
-                    hillID = savanna_plateau; break;
-                default:
-                    if (equalOrPlateau(a11, wooded_badlands_plateau))
-                        hillID = badlands;
-                    else if (a11 == deep_ocean && mcNextInt(l, 3) == 0)
-                        hillID = (mcNextInt(l, 2) == 0) ? plains : forest;
-                    break;
-                }
-
-                if (var12 && hillID != a11)
-                {
-                    if (biomeExists(hillID + 128))
-                        hillID += 128;
-                    else
-                        hillID = a11;
-                }
+                int v10 = in[x+1 + (z+0)*stride];
+                int v21 = in[x+2 + (z+1)*stride];
+                int v01 = in[x+0 + (z+1)*stride];
+                int v12 = in[x+1 + (z+2)*stride];
 
-                if (hillID == a11)
-                {
-                    out[idx] = a11;
-                }
-                else
+                if (v10 == 1 || v10 == 2 || v21 == 1 || v21 == 2 || v01 == 1 || v01 == 2 || v12 == 1 || v12 == 2)
                 {
-                    int a10 = buf[x+1 + (z+0)*pWidth];
-                    int a21 = buf[x+2 + (z+1)*pWidth];
-                    int a01 = buf[x+0 + (z+1)*pWidth];
-                    int a12 = buf[x+1 + (z+2)*pWidth];
-                    int equals = 0;
-
-                    if (equalOrPlateau(a10, a11)) equals++;
-                    if (equalOrPlateau(a21, a11)) equals++;
-                    if (equalOrPlateau(a01, a11)) equals++;
-                    if (equalOrPlateau(a12, a11)) equals++;
-
-                    if (equals >= 3)
-                        out[idx] = hillID;
-                    else
-                        out[idx] = a11;
+                    v11 = 3;
                 }
             }
+
+            out[x + z*areaWidth] = v11;
         }
     }
 
-    free(buf);
+    releaseArea(l->p, &pv);
 }
 
 
-void mapHills113(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+#ifdef SIMD_DISPATCH
+
+/* The per-entry RNG layers below evaluate a row in groups of 8 with the full
+ * 64-bit chunk seeds, see islandRowAVX512(). Each returns the number of
+ * entries done, and the caller finishes the row with the scalar code.
+ */
+SIMD_AVX512_FUNC
+static int specialRowAVX512(int *row, const int *in, int x, int z, int w,
+        int64_t ss, int64_t ws)
 {
-    int pX = areaX - 1;
-    int pZ = areaZ - 1;
-    int pWidth = areaWidth + 2;
-    int pHeight = areaHeight + 2;
-    int x, z;
-    int *buf = NULL;
+    const __m512i vss = _mm512_set1_epi64(ss);
+    const __m512i vws = _mm512_set1_epi64(ws);
+    const __m512i zs = _mm512_set1_epi64(z);
+    const __m512i zero = _mm512_setzero_si512();
+    __m512i xs = _mm512_add_epi64(_mm512_set1_epi64(x),
+            _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7));
+    __m512i v, cs, r;
+    __mmask8 m;
+    int i;
 
-    if (l->p2 == NULL)
+    for (i = 0; i + 8 <= w; i += 8)
     {
-        printf("mapHills() requires two parents! Use setupMultiLayer()\n");
-        exit(1);
+        v = _mm512_cvtepi32_epi64(_mm256_loadu_si256((const __m256i*)(in + i)));
+        cs = set8ChunkSeeds64(vss, xs, zs);
+        m = _mm512_test_epi64_mask(v, v);
+        m = _mm512_mask_cmpeq_epi64_mask(m, mc8NextInt64(&cs, vws, 13), zero);
+        if (m)
+        {
+            r = _mm512_add_epi64(mc8NextInt64(&cs, vws, 15), _mm512_set1_epi64(1));
+            r = _mm512_and_si512(_mm512_slli_epi64(r, 8), _mm512_set1_epi64(0xf00));
+            v = _mm512_mask_or_epi64(v, m, v, r);
+        }
+        _mm256_storeu_si256((__m256i*)(row + i), _mm512_cvtepi64_epi32(v));
+        xs = _mm512_add_epi64(xs, _mm512_set1_epi64(8));
     }
 
-    buf = (int *) malloc(pWidth*pHeight*sizeof(int));
+    return i;
+}
+
+#endif // SIMD_DISPATCH
 
-    l->p->getMap(l->p, out, pX, pZ, pWidth, pHeight);
-    memcpy(buf, out, pWidth*pHeight*sizeof(int));
+void mapSpecial(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+{
+    LayerView pv;
+    requestArea(l->p, &pv, areaX, areaZ, areaWidth, areaHeight);
+    const int *in = pv.data;
+    const int stride = pv.stride;
 
-    l->p2->getMap(l->p2, out, pX, pZ, pWidth, pHeight);
+    const int64_t ws = l->worldSeed;
+    const int64_t ss = ws * (ws * 6364136223846793005LL + 1442695040888963407LL);
+    ChunkSeedRow seeds;
 
+    int x, z;
     for (z = 0; z < areaHeight; z++)
     {
-        for (x = 0; x < areaWidth; x++)
+        x = 0;
+#ifdef SIMD_DISPATCH
+        if (simdLevel >= SIMD_AVX512)
+            x = specialRowAVX512(out + z*areaWidth, in + z*stride, areaX, areaZ + z, areaWidth, ss, ws);
+#endif
+        initChunkSeedRow(&seeds, ss, x + areaX, z + areaZ, 1, areaWidth - x);
+        for (; x < areaWidth; x++, nextChunkSeedRow(&seeds))
         {
-            setChunkSeed(l, (int64_t)(x + areaX), (int64_t)(z + areaZ));
-            int a11 = buf[x+1 + (z+1)*pWidth]; // biome branch
-            int b11 = out[x+1 + (z+1)*pWidth]; // river branch
-            int idx = x + z*areaWidth;
-
-            int bn = (b11 - 2) % 29;
-
-            if (!(isOceanic(a11) || b11 < 2 || bn != 1 || a11 >= 128))
-            {
-                out[idx] = (biomeExists(a11 + 128)) ? a11 + 128 : a11;
-            }
-            else if (mcNextInt(l, 3) == 0 || bn == 0)
-            {
-                int hillID = a11;
-
-                switch(a11)
-                {
-                case desert:
-                    hillID = desert_hills; break;
-                case forest:
-                    hillID = wooded_hills; break;
-                case birch_forest:
-                    hillID = birch_forest_hills; break;
-                case dark_forest:
-                    hillID = plains; break;
-                case taiga:
-                    hillID = taiga_hills; break;
-                case giant_tree_taiga:
-                    hillID = giant_tree_taiga_hills; break;
-                case snowy_taiga:
-                    hillID = snowy_taiga_hills; break;
-                case plains:
-                    hillID = (mcNextInt(l, 3) == 0) ? wooded_hills : forest; break;
-                case snowy_tundra:
-                    hillID = snowy_mountains; break;
-                case jungle:
-                    hillID = jungle_hills; break;
-                case bamboo_jungle:
-                    hillID = bamboo_jungle_hills; break;
-                case ocean:
-                    hillID = deep_ocean; break;
-                case mountains:
-                    hillID = wooded_mountains; break;
-                case savanna:
-                    hillID = savanna_plateau; break;
-                default:
-                    if (equalOrPlateau(a11, wooded_badlands_plateau))
-                        hillID = badlands;
-                    else if (isDeepOcean(a11) && mcNextInt(l, 3) == 0)
-                        hillID = (mcNextInt(l, 2) == 0) ? plains : forest;
-                    break;
-                }
+            int v = in[x + z*stride];
+            out[x + z*areaWidth] = v;
+            if (v == 0) continue;
 
-                if (bn == 0 && hillID != a11)
-                {
-                    if (biomeExists(hillID + 128))
-                        hillID += 128;
-                    else
-                        hillID = a11;
-                }
+            l->chunkSeed = getRowChunkSeed(&seeds);
 
-                if (hillID != a11)
-                {
-                    int a10 = buf[x+1 + (z+0)*pWidth];
-                    int a21 = buf[x+2 + (z+1)*pWidth];
-                    int a01 = buf[x+0 + (z+1)*pWidth];
-                    int a12 = buf[x+1 + (z+2)*pWidth];
-                    int equals = 0;
-
-                    if (equalOrPlateau(a10, a11)) equals++;
-                    if (equalOrPlateau(a21, a11)) equals++;
-                    if (equalOrPlateau(a01, a11)) equals++;
-                    if (equalOrPlateau(a12, a11)) equals++;
-
-                    if (equals >= 3)
-                        out[idx] = hillID;
-                    else
-                        out[idx] = a11;
-                }
-                else
-                {
-                    out[idx] = a11;
-                }
-            }
-            else
+            if (mcNextInt(l, 13) == 0)
             {
-                out[idx] = a11;
+                v |= (1 + mcNextInt(l, 15)) << 8 & 0xf00;
+                out[x + z*areaWidth] = v;
             }
         }
     }
 
-    free(buf);
+    releaseArea(l->p, &pv);
 }
 
 
+#ifdef SIMD_DISPATCH
 
-static inline int reduceID(int id)
+/* 'in0', 'in1' and 'in2' are the parent rows z-1, z and z+1 from column x-1. */
+SIMD_AVX512_FUNC
+static int mushroomRowAVX512(int *row, const int *in0, const int *in1, const int *in2,
+        int x, int z, int w, int64_t ss)
 {
-    return id >= 2 ? 2 + (id & 1) : id;
+    const __m512i vss = _mm512_set1_epi64(ss);
+    const __m512i zs = _mm512_set1_epi64(z);
+    const __m512i mushroom = _mm512_set1_epi64(mushroom_fields);
+    __m512i xs = _mm512_add_epi64(_mm512_set1_epi64(x),
+            _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7));
+    __m512i v, n, cs;
+    __mmask8 m;
+    int i;
+
+    for (i = 0; i + 8 <= w; i += 8)
+    {
+        v = _mm512_cvtepi32_epi64(_mm256_loadu_si256((const __m256i*)(in1 + i+1)));
+        n = _mm512_cvtepi32_epi64(_mm256_or_si256(
+                _mm256_or_si256(_mm256_loadu_si256((const __m256i*)(in0 + i)),
+                                _mm256_loadu_si256((const __m256i*)(in0 + i+2))),
+                _mm256_or_si256(_mm256_loadu_si256((const __m256i*)(in2 + i)),
+                                _mm256_loadu_si256((const __m256i*)(in2 + i+2)))));
+        // surrounded by ocean?
+        n = _mm512_or_si512(v, n);
+        m = _mm512_testn_epi64_mask(n, n);
+        if (m)
+        {
+            cs = set8ChunkSeeds64(vss, xs, zs);
+            n = mod8Int64(_mm512_srai_epi64(cs, 24), 100);
+            m = _mm512_mask_testn_epi64_mask(m, n, n);
+            v = _mm512_mask_mov_epi64(v, m, mushroom);
+        }
+        _mm256_storeu_si256((__m256i*)(row + i), _mm512_cvtepi64_epi32(v));
+        xs = _mm512_add_epi64(xs, _mm512_set1_epi64(8));
+    }
+
+    return i;
 }
 
-void mapRiver(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+#endif // SIMD_DISPATCH
+
+void mapAddMushroomIsland(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
 {
     int pX = areaX - 1;
     int pZ = areaZ - 1;
@@ -1258,73 +1992,108 @@ void mapRiver(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidt
     int pHeight = areaHeight + 2;
     int x, z;
 
-    l->p->getMap(l->p, out, pX, pZ, pWidth, pHeight);
+    LayerView pv;
+    requestArea(l->p, &pv, pX, pZ, pWidth, pHeight);
+    const int *in = pv.data;
+    const int stride = pv.stride;
+
+#ifdef SIMD_DISPATCH
+    const int64_t ws = l->worldSeed;
+    const int64_t ss = ws * (ws * 6364136223846793005LL + 1442695040888963407LL);
+#endif
 
     for (z = 0; z < areaHeight; z++)
     {
-        for (x = 0; x < areaWidth; x++)
+        x = 0;
+#ifdef SIMD_DISPATCH
+        if (simdLevel >= SIMD_AVX512)
+            x = mushroomRowAVX512(out + z*areaWidth, in + z*stride, in + (z+1)*stride,
+                    in + (z+2)*stride, areaX, areaZ + z, areaWidth, ss);
+#endif
+        for (; x < areaWidth; x++)
         {
-            int v01 = reduceID(out[x+0 + (z+1)*pWidth]);
-            int v21 = reduceID(out[x+2 + (z+1)*pWidth]);
-            int v10 = reduceID(out[x+1 + (z+0)*pWidth]);
-            int v12 = reduceID(out[x+1 + (z+2)*pWidth]);
-            int v11 = reduceID(out[x+1 + (z+1)*pWidth]);
+            int v11 = in[x+1 + (z+1)*stride];
 
-            if (v11 == v01 && v11 == v10 && v11 == v21 && v11 == v12)
-            {
-                out[x + z * areaWidth] = -1;
-            }
-            else
+            // surrounded by ocean?
+            if (v11 == 0 && !in[x+0 + (z+0)*stride] && !in[x+2 + (z+0)*stride] && !in[x+0 + (z+2)*stride] && !in[x+2 + (z+2)*stride])
             {
-                out[x + z * areaWidth] = river;
+                setChunkSeed(l, (int64_t)(x + areaX), (int64_t)(z + areaZ));
+                if (mcNextInt(l, 100) == 0) {
+                    out[x + z*areaWidth] = mushroom_fields;
+                    continue;
+                }
             }
+
+            out[x + z*areaWidth] = v11;
         }
     }
+
+    releaseArea(l->p, &pv);
 }
 
 
-void mapSmooth(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+static inline int getDeepOcean(int id)
 {
-    int pX = areaX - 1;
-    int pZ = areaZ - 1;
-    int pWidth = areaWidth + 2;
-    int pHeight = areaHeight + 2;
-    int x, z;
-
-    l->p->getMap(l->p, out, pX, pZ, pWidth, pHeight);
-
-    for (z = 0; z < areaHeight; z++)
+    switch (id)
     {
-        for (x = 0; x < areaWidth; x++)
-        {
-            int v11 = out[x+1 + (z+1)*pWidth];
-            int v10 = out[x+1 + (z+0)*pWidth];
-            int v21 = out[x+2 + (z+1)*pWidth];
-            int v01 = out[x+0 + (z+1)*pWidth];
-            int v12 = out[x+1 + (z+2)*pWidth];
+    case warm_ocean:
+        return deep_warm_ocean;
+    case lukewarm_ocean:
+        return deep_lukewarm_ocean;
+    case ocean:
+        return deep_ocean;
+    case cold_ocean:
+        return deep_cold_ocean;
+    case frozen_ocean:
+        return deep_frozen_ocean;
+    default:
+        return deep_ocean;
+    }
+}
 
-            if (v01 == v21 && v10 == v12)
-            {
-                setChunkSeed(l, (int64_t)(x + areaX), (int64_t)(z + areaZ));
+#ifdef SIMD_DISPATCH
 
-                if (mcNextInt(l, 2) == 0)
-                    v11 = v01;
-                else
-                    v11 = v10;
-            }
-            else
-            {
-                if (v01 == v21) v11 = v01;
-                if (v10 == v12) v11 = v10;
-            }
+SIMD_AVX512_FUNC
+static int deepOceanRowAVX512(int *row, const int *in0, const int *in1, const int *in2, int w)
+{
+    const __m512i shallow = _mm512_set1_epi32(BC_SHALLOW);
+    __m512i v11, c;
+    __mmask16 m;
+    int i;
 
-            out[x + z * areaWidth] = v11;
+    for (i = 0; i + 16 <= w; i += 16)
+    {
+        v11 = _mm512_loadu_si512(in1 + i+1);
+        m = _mm512_test_epi32_mask(biomeCats16(v11), shallow);
+        if (m)
+        {
+            c = _mm512_and_si512(
+                    _mm512_and_si512(biomeCats16(_mm512_loadu_si512(in0 + i+1)),
+                                     biomeCats16(_mm512_loadu_si512(in1 + i+2))),
+                    _mm512_and_si512(biomeCats16(_mm512_loadu_si512(in1 + i)),
+                                     biomeCats16(_mm512_loadu_si512(in2 + i+1))));
+            m = _mm512_mask_test_epi32_mask(m, c, shallow);
+            // getDeepOcean()
+            v11 = _mm512_mask_mov_epi32(v11, m & _mm512_cmpeq_epi32_mask(v11, _mm512_set1_epi32(warm_ocean)),
+                    _mm512_set1_epi32(deep_warm_ocean));
+            v11 = _mm512_mask_mov_epi32(v11, m & _mm512_cmpeq_epi32_mask(v11, _mm512_set1_epi32(lukewarm_ocean)),
+                    _mm512_set1_epi32(deep_lukewarm_ocean));
+            v11 = _mm512_mask_mov_epi32(v11, m & _mm512_cmpeq_epi32_mask(v11, _mm512_set1_epi32(cold_ocean)),
+                    _mm512_set1_epi32(deep_cold_ocean));
+            v11 = _mm512_mask_mov_epi32(v11, m & _mm512_cmpeq_epi32_mask(v11, _mm512_set1_epi32(frozen_ocean)),
+                    _mm512_set1_epi32(deep_frozen_ocean));
+            v11 = _mm512_mask_mov_epi32(v11, m & _mm512_cmpeq_epi32_mask(v11, _mm512_set1_epi32(ocean)),
+                    _mm512_set1_epi32(deep_ocean));
         }
+        _mm512_storeu_si512(row + i, v11);
     }
+
+    return i;
 }
 
+#endif // SIMD_DISPATCH
 
-void mapRareBiome(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+void mapDeepOcean(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
 {
     int pX = areaX - 1;
     int pZ = areaZ - 1;
@@ -1332,468 +2101,3072 @@ void mapRareBiome(Layer *l, int * __restrict out, int areaX, int areaZ, int area
     int pHeight = areaHeight + 2;
     int x, z;
 
-    l->p->getMap(l->p, out, pX, pZ, pWidth, pHeight);
+    LayerView pv;
+    requestArea(l->p, &pv, pX, pZ, pWidth, pHeight);
+    const int *in = pv.data;
+    const int stride = pv.stride;
+
+    if (isUniformArea(&pv, pWidth, pHeight))
+    {
+        fillArea(out, areaWidth, isShallowOcean(in[0]) ? getDeepOcean(in[0]) : in[0],
+                areaWidth, areaHeight);
+        releaseArea(l->p, &pv);
+        return;
+    }
 
     for (z = 0; z < areaHeight; z++)
     {
-        for (x = 0; x < areaWidth; x++)
+        x = 0;
+#ifdef SIMD_DISPATCH
+        if (simdLevel >= SIMD_AVX512)
+            x = deepOceanRowAVX512(out + z*areaWidth, in + z*stride, in + (z+1)*stride,
+                    in + (z+2)*stride, areaWidth);
+#endif
+        for (; x < areaWidth; x++)
         {
-            setChunkSeed(l, (int64_t)(x + areaX), (int64_t)(z + areaZ));
-            int v11 = out[x+1 + (z+1)*pWidth];
+            int v11 = in[(x+1) + (z+1)*stride];
 
-            if (mcNextInt(l, 57) == 0 && v11 == plains)
-            {
-                // Sunflower Plains
-                out[x + z*areaWidth] = plains + 128;
-            }
-            else
+            if (isShallowOcean(v11))
             {
-                out[x + z*areaWidth] = v11;
+                // count adjacent oceans
+                int oceans = 0;
+                if (isShallowOcean(in[(x+1) + (z+0)*stride])) oceans++;
+                if (isShallowOcean(in[(x+2) + (z+1)*stride])) oceans++;
+                if (isShallowOcean(in[(x+0) + (z+1)*stride])) oceans++;
+                if (isShallowOcean(in[(x+1) + (z+2)*stride])) oceans++;
+
+                if (oceans > 3)
+                    v11 = getDeepOcean(v11);
             }
+
+            out[x + z*areaWidth] = v11;
         }
     }
-}
 
+    releaseArea(l->p, &pv);
+}
 
-inline static int replaceOcean(int *out, int idx, int v10, int v21, int v01, int v12, int id, int replaceID)
-{
-    if (isOceanic(id)) return 0;
 
-    if (!isOceanic(v10) && !isOceanic(v21) && !isOceanic(v01) && !isOceanic(v12))
-        out[idx] = id;
-    else
-        out[idx] = replaceID;
+const int warmBiomes[] = {desert, desert, desert, savanna, savanna, plains};
+const int lushBiomes[] = {forest, dark_forest, mountains, plains, birch_forest, swamp};
+const int coldBiomes[] = {forest, mountains, taiga, plains};
+const int snowBiomes[] = {snowy_tundra, snowy_tundra, snowy_tundra, snowy_taiga};
 
-    return 1;
+/* Chooses the biome for an entry of the climate layers. */
+static inline int getClimateBiome(Layer *l, int id, int x, int z, const int *lush)
+{
+    int hasHighBit = (id & 0xf00) >> 8;
+    id &= -0xf01;
+
+    if (getBiomeType(id) == Ocean || id == mushroom_fields)
+        return id;
+
+    setChunkSeed(l, (int64_t)x, (int64_t)z);
+
+    switch(id){
+    case Warm:
+        if (hasHighBit) return (mcNextInt(l, 3) == 0) ? badlands_plateau : wooded_badlands_plateau;
+        else return warmBiomes[mcNextInt(l, 6)];
+    case Lush:
+        if (hasHighBit) return jungle;
+        else return lush[mcNextInt(l, 6)];
+    case Cold:
+        if (hasHighBit) return giant_tree_taiga;
+        else return coldBiomes[mcNextInt(l, 4)];
+    case Freezing:
+        return snowBiomes[mcNextInt(l, 4)];
+    default:
+        return mushroom_fields;
+    }
 }
 
-inline static int isBiomeJFTO(int id)
+#ifdef SIMD_DISPATCH
+
+/* getClimateBiome() for the rows of mapBiome() and mapBiomeBE(). Only the
+ * climates Warm, Lush, Cold and Freezing are vectorised, the remaining entries
+ * (mostly oceans) are finished individually.
+ */
+SIMD_AVX512_FUNC
+static int climateRowAVX512(Layer *l, int *row, const int *in, int x, int z, int w,
+        int64_t ss, const int *lush)
 {
-    return biomeExists(id) && (getBiomeType(id) == Jungle || id == forest || id == taiga || isOceanic(id));
+    const __m512i vss = _mm512_set1_epi64(ss);
+    const __m512i zs = _mm512_set1_epi64(z);
+    const __m512i warmT = _mm512_setr_epi64(warmBiomes[0], warmBiomes[1],
+            warmBiomes[2], warmBiomes[3], warmBiomes[4], warmBiomes[5], 0, 0);
+    const __m512i lushT = _mm512_setr_epi64(lush[0], lush[1], lush[2],
+            lush[3], lush[4], lush[5], 0, 0);
+    const __m512i coldT = _mm512_setr_epi64(coldBiomes[0], coldBiomes[1],
+            coldBiomes[2], coldBiomes[3], 0, 0, 0, 0);
+    const __m512i snowT = _mm512_setr_epi64(snowBiomes[0], snowBiomes[1],
+            snowBiomes[2], snowBiomes[3], 0, 0, 0, 0);
+    const __m512i high = _mm512_set1_epi64(0xf00);
+    __m512i xs = _mm512_add_epi64(_mm512_set1_epi64(x),
+            _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7));
+    __m512i v, id, cs, r, r3, r4, r6;
+    __mmask8 mh, mw, ml, mc, mf, rest;
+    int i, k;
+
+    for (i = 0; i + 8 <= w; i += 8)
+    {
+        v = _mm512_cvtepi32_epi64(_mm256_loadu_si256((const __m256i*)(in + i)));
+        id = _mm512_andnot_si512(high, v);
+        mh = _mm512_test_epi64_mask(v, high);
+        mw = _mm512_cmpeq_epi64_mask(id, _mm512_set1_epi64(Warm));
+        ml = _mm512_cmpeq_epi64_mask(id, _mm512_set1_epi64(Lush));
+        mc = _mm512_cmpeq_epi64_mask(id, _mm512_set1_epi64(Cold));
+        mf = _mm512_cmpeq_epi64_mask(id, _mm512_set1_epi64(Freezing));
+
+        cs = _mm512_srai_epi64(set8ChunkSeeds64(vss, xs, zs), 24);
+        r3 = mod8Int64(cs, 3);
+        r4 = mod8Int64(cs, 4);
+        r6 = mod8Int64(cs, 6);
+
+        r = _mm512_permutexvar_epi64(r4, snowT);
+        r = _mm512_mask_permutexvar_epi64(r, mc, r4, coldT);
+        r = _mm512_mask_permutexvar_epi64(r, ml, r6, lushT);
+        r = _mm512_mask_permutexvar_epi64(r, mw, r6, warmT);
+        r = _mm512_mask_mov_epi64(r, mh & mc, _mm512_set1_epi64(giant_tree_taiga));
+        r = _mm512_mask_mov_epi64(r, mh & ml, _mm512_set1_epi64(jungle));
+        r = _mm512_mask_mov_epi64(r, mh & mw, _mm512_set1_epi64(wooded_badlands_plateau));
+        r = _mm512_mask_mov_epi64(r, _mm512_mask_testn_epi64_mask(mh & mw, r3, r3),
+                _mm512_set1_epi64(badlands_plateau));
+        _mm256_storeu_si256((__m256i*)(row + i), _mm512_cvtepi64_epi32(r));
+
+        rest = ~(mw | ml | mc | mf);
+        for (k = 0; rest; k++, rest >>= 1)
+        {
+            if (rest & 1)
+                row[i+k] = getClimateBiome(l, in[i+k], x+i+k, z, lush);
+        }
+        xs = _mm512_add_epi64(xs, _mm512_set1_epi64(8));
+    }
+
+    return i;
 }
 
-void mapShore(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+#endif // SIMD_DISPATCH
+
+void mapBiome(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
 {
-    int pX = areaX - 1;
-    int pZ = areaZ - 1;
-    int pWidth = areaWidth + 2;
-    int pHeight = areaHeight + 2;
-    int x, z;
+    LayerView pv;
+    requestArea(l->p, &pv, areaX, areaZ, areaWidth, areaHeight);
+    const int *in = pv.data;
+    const int stride = pv.stride;
 
-    l->p->getMap(l->p, out, pX, pZ, pWidth, pHeight);
+#ifdef SIMD_DISPATCH
+    const int64_t ws = l->worldSeed;
+    const int64_t ss = ws * (ws * 6364136223846793005LL + 1442695040888963407LL);
+#endif
 
+    int x, z;
     for (z = 0; z < areaHeight; z++)
     {
-        for (x = 0; x < areaWidth; x++)
+        x = 0;
+#ifdef SIMD_DISPATCH
+        if (simdLevel >= SIMD_AVX512)
+            x = climateRowAVX512(l, out + z*areaWidth, in + z*stride, areaX, areaZ + z,
+                    areaWidth, ss, lushBiomes);
+#endif
+        for (; x < areaWidth; x++)
         {
-            int v11 = out[x+1 + (z+1)*pWidth];
-            int v10 = out[x+1 + (z+0)*pWidth];
-            int v21 = out[x+2 + (z+1)*pWidth];
-            int v01 = out[x+0 + (z+1)*pWidth];
-            int v12 = out[x+1 + (z+2)*pWidth];
-
-            int biome = biomeExists(v11) ? v11 : 0;
-
-            if (v11 == mushroom_fields)
-            {
-                if (v10 != ocean && v21 != ocean && v01 != ocean && v12 != ocean)
-                    out[x + z*areaWidth] = v11;
-                else
-                    out[x + z*areaWidth] = mushroom_field_shore;
-            }
-            else if (/*biome < 128 &&*/ getBiomeType(biome) == Jungle)
-            {
-                if (isBiomeJFTO(v10) && isBiomeJFTO(v21) && isBiomeJFTO(v01) && isBiomeJFTO(v12))
-                {
-                    if (!isOceanic(v10) && !isOceanic(v21) && !isOceanic(v01) && !isOceanic(v12))
-                        out[x + z*areaWidth] = v11;
-                    else
-                        out[x + z*areaWidth] = beach;
-                }
-                else
-                {
-                    out[x + z*areaWidth] = jungleEdge;
-                }
-            }
-            else if (v11 != mountains && v11 != wooded_mountains && v11 != mountain_edge)
-            {
-                if (isBiomeSnowy(biome))
-                {
-                    replaceOcean(out, x + z*areaWidth, v10, v21, v01, v12, v11, snowy_beach);
-                }
-                else if (v11 != badlands && v11 != wooded_badlands_plateau)
-                {
-                    if (v11 != ocean && v11 != deep_ocean && v11 != river && v11 != swamp)
-                    {
-                        if (!isOceanic(v10) && !isOceanic(v21) && !isOceanic(v01) && !isOceanic(v12))
-                            out[x + z*areaWidth] = v11;
-                        else
-                            out[x + z*areaWidth] = beach;
-                    }
-                    else
-                    {
-                        out[x + z*areaWidth] = v11;
-                    }
-                }
-                else
-                {
-                    if (!isOceanic(v10) && !isOceanic(v21) && !isOceanic(v01) && !isOceanic(v12))
-                    {
-                        if (getBiomeType(v10) == Mesa && getBiomeType(v21) == Mesa && getBiomeType(v01) == Mesa && getBiomeType(v12) == Mesa)
-                            out[x + z*areaWidth] = v11;
-                        else
-                            out[x + z*areaWidth] = desert;
-                    }
-                    else
-                    {
-                        out[x + z*areaWidth] = v11;
-                    }
-                }
-            }
-            else
-            {
-                replaceOcean(out, x + z*areaWidth, v10, v21, v01, v12, v11, stone_shore);
-            }
+            out[x + z*areaWidth] = getClimateBiome(l, in[x + z*stride],
+                    x + areaX, z + areaZ, lushBiomes);
         }
     }
+
+    releaseArea(l->p, &pv);
 }
 
 
-void mapRiverMix(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+const int lushBiomesBE[] = {forest, dark_forest, mountains, plains, plains, plains, birch_forest, swamp};
+
+void mapBiomeBE(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
 {
-    int idx;
-    int len;
-    int *buf;
+    LayerView pv;
+    requestArea(l->p, &pv, areaX, areaZ, areaWidth, areaHeight);
+    const int *in = pv.data;
+    const int stride = pv.stride;
 
-    if (l->p2 == NULL)
+#ifdef SIMD_DISPATCH
+    const int64_t ws = l->worldSeed;
+    const int64_t ss = ws * (ws * 6364136223846793005LL + 1442695040888963407LL);
+#endif
+
+    int x, z;
+    for (z = 0; z < areaHeight; z++)
     {
-        printf("mapRiverMix() requires two parents! Use setupMultiLayer()\n");
-        exit(1);
+        x = 0;
+#ifdef SIMD_DISPATCH
+        if (simdLevel >= SIMD_AVX512)
+            x = climateRowAVX512(l, out + z*areaWidth, in + z*stride, areaX, areaZ + z,
+                    areaWidth, ss, lushBiomesBE);
+#endif
+        for (; x < areaWidth; x++)
+        {
+            out[x + z*areaWidth] = getClimateBiome(l, in[x + z*stride],
+                    x + areaX, z + areaZ, lushBiomesBE);
+        }
     }
 
-    len = areaWidth*areaHeight;
-    buf = (int *) malloc(len*sizeof(int));
+    releaseArea(l->p, &pv);
+}
+
 
-    l->p->getMap(l->p, out, areaX, areaZ, areaWidth, areaHeight); // biome chain
-    memcpy(buf, out, len*sizeof(int));
+#ifdef SIMD_DISPATCH
 
-    l->p2->getMap(l->p2, out, areaX, areaZ, areaWidth, areaHeight); // rivers
+SIMD_AVX512_FUNC
+static int riverInitRowAVX512(int *row, const int *in, int x, int z, int w, int64_t ss)
+{
+    const __m512i vss = _mm512_set1_epi64(ss);
+    const __m512i zs = _mm512_set1_epi64(z);
+    const __m512i zero = _mm512_setzero_si512();
+    __m512i xs = _mm512_add_epi64(_mm512_set1_epi64(x),
+            _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7));
+    __m512i v, cs;
+    __mmask8 m;
+    int i;
 
-    for (idx = 0; idx < len; idx++)
+    for (i = 0; i + 8 <= w; i += 8)
     {
-        if (isOceanic(buf[idx]))
+        v = _mm512_cvtepi32_epi64(_mm256_loadu_si256((const __m256i*)(in + i)));
+        m = _mm512_cmpgt_epi64_mask(v, zero);
+        if (m)
         {
-            out[idx] = buf[idx];
+            cs = set8ChunkSeeds64(vss, xs, zs);
+            v = mod8Int64(_mm512_srai_epi64(cs, 24), 299999);
+            v = _mm512_maskz_add_epi64(m, v, _mm512_set1_epi64(2));
         }
         else
         {
-            if (out[idx] == river)
+            v = zero;
+        }
+        _mm256_storeu_si256((__m256i*)(row + i), _mm512_cvtepi64_epi32(v));
+        xs = _mm512_add_epi64(xs, _mm512_set1_epi64(8));
+    }
+
+    return i;
+}
+
+SIMD_AVX512_FUNC
+static int bambooRowAVX512(int *row, const int *in, int x, int z, int w, int64_t ss)
+{
+    const __m512i vss = _mm512_set1_epi64(ss);
+    const __m512i zs = _mm512_set1_epi64(z);
+    __m512i xs = _mm512_add_epi64(_mm512_set1_epi64(x),
+            _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7));
+    __m512i v, cs;
+    __mmask8 m;
+    int i;
+
+    for (i = 0; i + 8 <= w; i += 8)
+    {
+        v = _mm512_cvtepi32_epi64(_mm256_loadu_si256((const __m256i*)(in + i)));
+        m = _mm512_cmpeq_epi64_mask(v, _mm512_set1_epi64(jungle));
+        if (m)
+        {
+            cs = set8ChunkSeeds64(vss, xs, zs);
+            cs = mod8Int64(_mm512_srai_epi64(cs, 24), 10);
+            m = _mm512_mask_testn_epi64_mask(m, cs, cs);
+            v = _mm512_mask_mov_epi64(v, m, _mm512_set1_epi64(bamboo_jungle));
+        }
+        _mm256_storeu_si256((__m256i*)(row + i), _mm512_cvtepi64_epi32(v));
+        xs = _mm512_add_epi64(xs, _mm512_set1_epi64(8));
+    }
+
+    return i;
+}
+
+#endif // SIMD_DISPATCH
+
+void mapRiverInit(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+{
+    LayerView pv;
+    requestArea(l->p, &pv, areaX, areaZ, areaWidth, areaHeight);
+    const int *in = pv.data;
+    const int stride = pv.stride;
+
+    const int64_t ws = l->worldSeed;
+    const int64_t ss = ws * (ws * 6364136223846793005LL + 1442695040888963407LL);
+    ChunkSeedRow seeds;
+
+    int x, z;
+    for (z = 0; z < areaHeight; z++)
+    {
+        x = 0;
+#ifdef SIMD_DISPATCH
+        if (simdLevel >= SIMD_AVX512)
+            x = riverInitRowAVX512(out + z*areaWidth, in + z*stride, areaX, areaZ + z, areaWidth, ss);
+#endif
+        initChunkSeedRow(&seeds, ss, x + areaX, z + areaZ, 1, areaWidth - x);
+        for (; x < areaWidth; x++, nextChunkSeedRow(&seeds))
+        {
+            if (in[x + z*stride] > 0)
             {
-                if (buf[idx] == snowy_tundra)
-                    out[idx] = frozen_river;
-                else if (buf[idx] == mushroom_fields || buf[idx] == mushroom_field_shore)
-                    out[idx] = mushroom_field_shore;
-                else
-                    out[idx] = out[idx] & 255;
+                l->chunkSeed = getRowChunkSeed(&seeds);
+                out[x + z*areaWidth] = mcNextInt(l, 299999)+2;
             }
             else
             {
-                out[idx] = buf[idx];
+                out[x + z*areaWidth] = 0;
             }
         }
     }
 
-    free(buf);
+    releaseArea(l->p, &pv);
 }
 
 
-
-/* Initialises data for the ocean temperature types using the world seed.
- * This function is called when the world seed is applied in setWorldSeed().
- */
-static void oceanRndInit(OceanRnd *rnd, int64_t seed)
+void mapAddBamboo(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
 {
-    int i = 0;
-    memset(rnd, 0, sizeof(*rnd));
-    setSeed(&seed);
-    rnd->a = nextDouble(&seed) * 256.0;
-    rnd->b = nextDouble(&seed) * 256.0;
-    rnd->c = nextDouble(&seed) * 256.0;
+    LayerView pv;
+    requestArea(l->p, &pv, areaX, areaZ, areaWidth, areaHeight);
+    const int *in = pv.data;
+    const int stride = pv.stride;
 
-    for (i = 0; i < 256; i++)
-    {
-        rnd->d[i] = i;
-    }
-    for (i = 0; i < 256; i++)
+#ifdef SIMD_DISPATCH
+    const int64_t ws = l->worldSeed;
+    const int64_t ss = ws * (ws * 6364136223846793005LL + 1442695040888963407LL);
+#endif
+
+    int x, z;
+    for (z = 0; z < areaHeight; z++)
     {
-        int n3 = nextInt(&seed, 256 - i) + i;
-        int n4 = rnd->d[i];
-        rnd->d[i] = rnd->d[n3];
-        rnd->d[n3] = n4;
-        rnd->d[i + 256] = rnd->d[i];
+        x = 0;
+#ifdef SIMD_DISPATCH
+        if (simdLevel >= SIMD_AVX512)
+            x = bambooRowAVX512(out + z*areaWidth, in + z*stride, areaX, areaZ + z, areaWidth, ss);
+#endif
+        for (; x < areaWidth; x++)
+        {
+            int idx = x + z*areaWidth;
+            out[idx] = in[x + z*stride];
+            if (out[idx] != jungle) continue;
+
+            setChunkSeed(l, (int64_t)(x + areaX), (int64_t)(z + areaZ));
+            if (mcNextInt(l, 10) == 0)
+            {
+                out[idx] = bamboo_jungle;
+            }
+        }
     }
+
+    releaseArea(l->p, &pv);
 }
 
-static double lerp(const double part, const double from, const double to)
+
+#ifdef SIMD_DISPATCH
+
+/* Seed lanes: the layers down to the 1:256 biomes evaluated for SEED_LANES
+ * world seeds at once, one seed per 64-bit lane. The maps are interleaved,
+ * such that the lanes of each entry lie next to one another, and all the
+ * lanes of an entry share its chunk position. Rather than the chunk seeds of
+ * a row, the vectors therefore hold the chunk seeds of the different world
+ * seeds. 'in' is the parent area that getParentArea() gives for (x,z,w,h).
+ */
+
+SIMD_AVX512_FUNC static inline __m512i loadLanes(const int *buf, size_t idx)
 {
-    return from + part * (to - from);
+    return load8Ints64(buf + idx * SEED_LANES);
 }
 
-/* Table of vectors to cube edge centres (12 + 4 extra), used for ocean PRNG */
-const double cEdgeX[] = {1.0,-1.0, 1.0,-1.0, 1.0,-1.0, 1.0,-1.0, 0.0, 0.0, 0.0, 0.0,  1.0, 0.0,-1.0, 0.0};
-const double cEdgeY[] = {1.0, 1.0,-1.0,-1.0, 0.0, 0.0, 0.0, 0.0, 1.0,-1.0, 1.0,-1.0,  1.0,-1.0, 1.0,-1.0};
-const double cEdgeZ[] = {0.0, 0.0, 0.0, 0.0, 1.0, 1.0,-1.0,-1.0, 1.0, 1.0,-1.0,-1.0,  0.0, 1.0, 0.0,-1.0};
+SIMD_AVX512_FUNC static inline void storeLanes(int *buf, size_t idx, __m512i v)
+{
+    _mm256_storeu_si256((__m256i*)(buf + idx * SEED_LANES), _mm512_cvtepi64_epi32(v));
+}
 
-static double indexedLerp(int idx, const double d1, const double d2, const double d3)
+/* Advances the RNG of the chunk seeds 'cs' and adds 'v'. */
+SIMD_AVX512_FUNC static inline __m512i nextLaneSeeds(__m512i cs, __m512i v)
 {
-    idx &= 0xf;
-    return cEdgeX[idx] * d1 + cEdgeY[idx] * d2 + cEdgeZ[idx] * d3;
+    const __m512i mul = _mm512_set1_epi64(6364136223846793005LL);
+    const __m512i add = _mm512_set1_epi64(1442695040888963407LL);
+    return _mm512_add_epi64(v, _mm512_mullo_epi64(cs, _mm512_add_epi64(add, _mm512_mullo_epi64(cs, mul))));
 }
 
+SIMD_AVX512_FUNC static inline __m512i getLaneChunkSeeds(__m512i vss, int x, int z)
+{
+    return set8ChunkSeeds64(vss, _mm512_set1_epi64(x), _mm512_set1_epi64(z));
+}
 
-static double getOceanTemp(const OceanRnd *rnd, double d1, double d2, double d3)
+SIMD_AVX512_FUNC
+static void islandLanes(__m512i vss, int *out, int x, int z, int w, int h)
 {
-    d1 += rnd->a;
-    d2 += rnd->b;
-    d3 += rnd->c;
-    int i1 = (int)d1 - (int)(d1 < 0);
-    int i2 = (int)d2 - (int)(d2 < 0);
-    int i3 = (int)d3 - (int)(d3 < 0);
-    d1 -= i1;
-    d2 -= i2;
-    d3 -= i3;
-    double t1 = d1*d1*d1 * (d1 * (d1*6.0-15.0) + 10.0);
-    double t2 = d2*d2*d2 * (d2 * (d2*6.0-15.0) + 10.0);
-    double t3 = d3*d3*d3 * (d3 * (d3*6.0-15.0) + 10.0);
+    const __m512i one = _mm512_set1_epi64(1);
+    __m512i r;
+    int i, j;
 
-    i1 &= 0xff;
-    i2 &= 0xff;
-    i3 &= 0xff;
+    for (j = 0; j < h; j++)
+    {
+        for (i = 0; i < w; i++)
+        {
+            r = mod8Int64(_mm512_srai_epi64(getLaneChunkSeeds(vss, x+i, z+j), 24), 10);
+            r = _mm512_maskz_mov_epi64(_mm512_testn_epi64_mask(r, r), one);
+            if (x+i == 0 && z+j == 0)
+                r = one;
+            storeLanes(out, i + (size_t)j*w, r);
+        }
+    }
+}
 
-    int a1 = rnd->d[i1]   + i2;
-    int a2 = rnd->d[a1]   + i3;
-    int a3 = rnd->d[a1+1] + i3;
-    int b1 = rnd->d[i1+1] + i2;
-    int b2 = rnd->d[b1]   + i3;
-    int b3 = rnd->d[b1+1] + i3;
+/* The RNG of mapZoom() only keeps the lower 32 bits, which the 64-bit lanes
+ * get right with the 64-bit versions of its constants.
+ */
+SIMD_AVX512_FUNC static inline __m512i nextZoomSeeds(__m512i cs, __m512i v)
+{
+    const __m512i mul = _mm512_set1_epi64(1284865837);
+    const __m512i add = _mm512_set1_epi64(4150755663LL);
+    return _mm512_add_epi64(v, _mm512_mullo_epi64(cs, _mm512_add_epi64(add, _mm512_mullo_epi64(cs, mul))));
+}
 
-    double l1 = indexedLerp(rnd->d[a2],   d1,   d2,   d3);
-    double l2 = indexedLerp(rnd->d[b2],   d1-1, d2,   d3);
-    double l3 = indexedLerp(rnd->d[a3],   d1,   d2-1, d3);
-    double l4 = indexedLerp(rnd->d[b3],   d1-1, d2-1, d3);
-    double l5 = indexedLerp(rnd->d[a2+1], d1,   d2,   d3-1);
-    double l6 = indexedLerp(rnd->d[b2+1], d1-1, d2,   d3-1);
-    double l7 = indexedLerp(rnd->d[a3+1], d1,   d2-1, d3-1);
-    double l8 = indexedLerp(rnd->d[b3+1], d1-1, d2-1, d3-1);
+/* selectRandom4() with the draw in bits 24 and 25 of 'cs'. */
+SIMD_AVX512_FUNC static inline __m512i selectLanes4(__m512i cs, __m512i a, __m512i a1,
+        __m512i b, __m512i b1)
+{
+    const __m512i r = _mm512_and_si512(_mm512_srli_epi64(cs, 24), _mm512_set1_epi64(3));
+    a = _mm512_mask_mov_epi64(a, _mm512_cmpeq_epi64_mask(r, _mm512_set1_epi64(1)), a1);
+    a = _mm512_mask_mov_epi64(a, _mm512_cmpeq_epi64_mask(r, _mm512_set1_epi64(2)), b);
+    return _mm512_mask_mov_epi64(a, _mm512_cmpeq_epi64_mask(r, _mm512_set1_epi64(3)), b1);
+}
 
-    l1 = lerp(t1, l1, l2);
-    l3 = lerp(t1, l3, l4);
-    l5 = lerp(t1, l5, l6);
-    l7 = lerp(t1, l7, l8);
+SIMD_AVX512_FUNC
+static void zoomLanes(__m512i vws, int isIsland, int *out, const int *in,
+        int x, int z, int w, int h)
+{
+    const __m512i vss = nextZoomSeeds(vws, _mm512_setzero_si512());
+    const __m512i bit = _mm512_set1_epi64(1 << 24);
+    const int pX = x >> 1, pZ = z >> 1;
+    const int pw = ((x + w - 1) >> 1) - pX + 2;
+    const int ph = ((z + h - 1) >> 1) - pZ + 2;
+    __m512i a, a1, b, b1, cs, xs, zs, v01, v10, v11;
+    __mmask8 aa1, ab, ab1, a1b, a1b1, bb1;
+    int i, j, ox, oz;
+
+    for (j = 0; j < ph - 1; j++)
+    {
+        oz = (j << 1) - (z & 1);
+        zs = _mm512_set1_epi64((j + pZ) << 1);
 
-    l1 = lerp(t2, l1, l3);
-    l5 = lerp(t2, l5, l7);
+        for (i = 0; i < pw - 1; i++)
+        {
+            ox = (i << 1) - (x & 1);
+            xs = _mm512_set1_epi64((i + pX) << 1);
+
+            a  = loadLanes(in, i + (size_t)j*pw);
+            a1 = loadLanes(in, i+1 + (size_t)j*pw);
+            b  = loadLanes(in, i + (size_t)(j+1)*pw);
+            b1 = loadLanes(in, i+1 + (size_t)(j+1)*pw);
+
+            cs = nextZoomSeeds(_mm512_add_epi64(vss, xs), zs);
+            cs = nextZoomSeeds(cs, xs);
+            cs = nextZoomSeeds(cs, zs);
+            v01 = _mm512_mask_mov_epi64(a, _mm512_test_epi64_mask(cs, bit), b);
+            cs = nextZoomSeeds(cs, vws);
+            v10 = _mm512_mask_mov_epi64(a, _mm512_test_epi64_mask(cs, bit), a1);
+            cs = nextZoomSeeds(cs, vws);
+            v11 = selectLanes4(cs, a, a1, b, b1);
+
+            if (!isIsland)
+            {
+                // selectModeOrRandom(), with the earlier cases taking priority
+                aa1 = _mm512_cmpeq_epi64_mask(a, a1);
+                ab = _mm512_cmpeq_epi64_mask(a, b);
+                ab1 = _mm512_cmpeq_epi64_mask(a, b1);
+                a1b = _mm512_cmpeq_epi64_mask(a1, b);
+                a1b1 = _mm512_cmpeq_epi64_mask(a1, b1);
+                bb1 = _mm512_cmpeq_epi64_mask(b, b1);
+                v11 = _mm512_mask_mov_epi64(v11, bb1 & ~aa1, b);
+                v11 = _mm512_mask_mov_epi64(v11, (a1b1 & ~ab) | (a1b & ~ab1), a1);
+                v11 = _mm512_mask_mov_epi64(v11, (ab1 & ~a1b) | (ab & ~a1b1) | (aa1 & ~bb1) |
+                        (ab & ab1) | (aa1 & ab1) | (aa1 & ab), a);
+                v11 = _mm512_mask_mov_epi64(v11, a1b & bb1, a1);
+            }
 
-    return lerp(t3, l1, l5);
+            if (oz >= 0)
+            {
+                if (ox >= 0) storeLanes(out, ox + (size_t)oz*w, a);
+                if (ox+1 < w) storeLanes(out, ox+1 + (size_t)oz*w, v10);
+            }
+            if (oz+1 < h)
+            {
+                if (ox >= 0) storeLanes(out, ox + (size_t)(oz+1)*w, v01);
+                if (ox+1 < w) storeLanes(out, ox+1 + (size_t)(oz+1)*w, v11);
+            }
+        }
+    }
 }
 
-void mapOceanTemp(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+/* addIslandShore(), where the lanes draw as many values as they have land on
+ * their diagonals.
+ */
+SIMD_AVX512_FUNC static inline __m512i addIslandShoreLanes(__m512i cs, __m512i vws,
+        __m512i v00, __m512i v20, __m512i v02, __m512i v22)
 {
-    int x, z;
-    OceanRnd *rnd = l->oceanRnd;
-
-    for (z = 0; z < areaHeight; z++)
+    const __m512i one = _mm512_set1_epi64(1);
+    const __m512i four = _mm512_set1_epi64(4);
+    const __m512i bit = _mm512_set1_epi64(1LL << 24);
+    const __m512i bits = _mm512_set1_epi64(3LL << 24);
+    __m512i d[4] = { v00, v20, v02, v22 };
+    __m512i v = one, inc = _mm512_setzero_si512(), r;
+    __mmask8 m, m3, pick;
+    int k;
+
+    for (k = 0; k < 4; k++)
     {
-        for (x = 0; x < areaWidth; x++)
+        m = _mm512_test_epi64_mask(d[k], d[k]);
+        if (!m)
+            continue;
+        inc = _mm512_mask_add_epi64(inc, m, inc, one);
+        pick = _mm512_cmpeq_epi64_mask(inc, one);
+        pick |= _mm512_cmpeq_epi64_mask(inc, _mm512_set1_epi64(2)) & _mm512_testn_epi64_mask(cs, bit);
+        pick |= _mm512_cmpeq_epi64_mask(inc, four) & _mm512_testn_epi64_mask(cs, bits);
+        m3 = m & _mm512_cmpeq_epi64_mask(inc, _mm512_set1_epi64(3));
+        if (m3)
         {
-            double tmp = getOceanTemp(rnd, (x + areaX) / 8.0, (z + areaZ) / 8.0, 0);
-
-            if (tmp > 0.4)
-                out[x + z*areaWidth] = warm_ocean;
-            else if (tmp > 0.2)
-                out[x + z*areaWidth] = lukewarm_ocean;
-            else if (tmp < -0.4)
-                out[x + z*areaWidth] = frozen_ocean;
-            else if (tmp < -0.2)
-                out[x + z*areaWidth] = cold_ocean;
-            else
-                out[x + z*areaWidth] = ocean;
+            r = mod8Int64(_mm512_srai_epi64(cs, 24), 3);
+            pick |= _mm512_mask_testn_epi64_mask(m3, r, r);
         }
+        v = _mm512_mask_mov_epi64(v, m & pick, d[k]);
+        cs = _mm512_mask_mov_epi64(cs, m, nextLaneSeeds(cs, vws));
     }
+
+    r = mod8Int64(_mm512_srai_epi64(cs, 24), 3);
+    m = _mm512_testn_epi64_mask(r, r);
+    return _mm512_mask_mov_epi64(
+            _mm512_maskz_mov_epi64(_mm512_cmpeq_epi64_mask(v, four), four), m, v);
 }
 
-/* Warning: this function is horribly slow compared to other layers! */
-void mapOceanMix(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+SIMD_AVX512_FUNC
+static void addIslandLanes(__m512i vss, __m512i vws, int *out, const int *in,
+        int x, int z, int w, int h)
 {
-    int landX = areaX-8, landZ = areaZ-8;
-    int landWidth = areaWidth+17, landHeight = areaHeight+17;
-    int *map1, *map2;
+    const int pw = w + 2;
+    const __m512i zero = _mm512_setzero_si512();
+    __m512i v00, v20, v02, v22, v11, cs, r;
+    __mmask8 mshore, mland;
+    int i, j;
 
-    if (l->p2 == NULL)
+    for (j = 0; j < h; j++)
     {
-        printf("mapOceanMix() requires two parents! Use setupMultiLayer()\n");
-        exit(1);
+        for (i = 0; i < w; i++)
+        {
+            v00 = loadLanes(in, i + (size_t)j*pw);
+            v20 = loadLanes(in, i+2 + (size_t)j*pw);
+            v02 = loadLanes(in, i + (size_t)(j+2)*pw);
+            v22 = loadLanes(in, i+2 + (size_t)(j+2)*pw);
+            v11 = loadLanes(in, i+1 + (size_t)(j+1)*pw);
+
+            r = _mm512_or_si512(_mm512_or_si512(v00, v20), _mm512_or_si512(v02, v22));
+            mshore = _mm512_testn_epi64_mask(v11, v11) & _mm512_test_epi64_mask(r, r);
+            mland = _mm512_testn_epi64_mask(v00, v00) | _mm512_testn_epi64_mask(v20, v20) |
+                    _mm512_testn_epi64_mask(v02, v02) | _mm512_testn_epi64_mask(v22, v22);
+            mland &= _mm512_cmpgt_epi64_mask(v11, zero);
+
+            if (mshore | mland)
+            {
+                cs = getLaneChunkSeeds(vss, x+i, z+j);
+                r = mod8Int64(_mm512_srai_epi64(cs, 24), 5);
+                mland = _mm512_mask_testn_epi64_mask(mland, r, r);
+                mland &= _mm512_cmpneq_epi64_mask(v11, _mm512_set1_epi64(4));
+                v11 = _mm512_mask_mov_epi64(v11, mland, zero);
+                if (mshore)
+                    v11 = _mm512_mask_mov_epi64(v11, mshore,
+                            addIslandShoreLanes(cs, vws, v00, v20, v02, v22));
+            }
+            storeLanes(out, i + (size_t)j*w, v11);
+        }
     }
+}
 
-    l->p->getMap(l->p, out, landX, landZ, landWidth, landHeight);
-    map1 = (int *) malloc(landWidth*landHeight*sizeof(int));
-    memcpy(map1, out, landWidth*landHeight*sizeof(int));
-
-    l->p2->getMap(l->p2, out, areaX, areaZ, areaWidth, areaHeight);
-    map2 = (int *) malloc(areaWidth*areaHeight*sizeof(int));
-    memcpy(map2, out, areaWidth*areaHeight*sizeof(int));
+SIMD_AVX512_FUNC
+static void removeOceanLanes(__m512i vss, int *out, const int *in,
+        int x, int z, int w, int h)
+{
+    const int pw = w + 2;
+    __m512i v11, n, r;
+    __mmask8 m;
+    int i, j;
 
+    for (j = 0; j < h; j++)
+    {
+        for (i = 0; i < w; i++)
+        {
+            v11 = loadLanes(in, i+1 + (size_t)(j+1)*pw);
+            n = _mm512_or_si512(
+                    _mm512_or_si512(loadLanes(in, i+1 + (size_t)j*pw), loadLanes(in, i+2 + (size_t)(j+1)*pw)),
+                    _mm512_or_si512(loadLanes(in, i + (size_t)(j+1)*pw), loadLanes(in, i+1 + (size_t)(j+2)*pw)));
+            n = _mm512_or_si512(n, v11);
+            m = _mm512_testn_epi64_mask(n, n);
+            if (m)
+            {
+                r = mod8Int64(_mm512_srai_epi64(getLaneChunkSeeds(vss, x+i, z+j), 24), 2);
+                m = _mm512_mask_testn_epi64_mask(m, r, r);
+                v11 = _mm512_mask_mov_epi64(v11, m, _mm512_set1_epi64(1));
+            }
+            storeLanes(out, i + (size_t)j*w, v11);
+        }
+    }
+}
 
-    int x, z, i, j;
+SIMD_AVX512_FUNC
+static void addSnowLanes(__m512i vss, int *out, const int *in,
+        int x, int z, int w, int h)
+{
+    __m512i v, r, t;
+    __mmask8 m;
+    int i, j;
 
-    for (z = 0; z < areaHeight; z++)
+    for (j = 0; j < h; j++)
     {
-        for (x = 0; x < areaWidth; x++)
+        for (i = 0; i < w; i++)
         {
-            int landID = map1[(x+8) + (z+8)*landWidth];
-            int oceanID = map2[x + z*areaWidth];
+            v = loadLanes(in, i + (size_t)j*w);
+            m = _mm512_testn_epi64_mask(biomeCats8(v), _mm512_set1_epi64(BC_SHALLOW));
+            if (m)
+            {
+                r = mod8Int64(_mm512_srai_epi64(getLaneChunkSeeds(vss, x+i, z+j), 24), 6);
+                t = _mm512_set1_epi64(1);
+                t = _mm512_mask_mov_epi64(t, _mm512_cmpeq_epi64_mask(r, _mm512_set1_epi64(1)),
+                        _mm512_set1_epi64(3));
+                t = _mm512_mask_mov_epi64(t, _mm512_testn_epi64_mask(r, r), _mm512_set1_epi64(4));
+                v = _mm512_mask_mov_epi64(v, m, t);
+            }
+            storeLanes(out, i + (size_t)j*w, v);
+        }
+    }
+}
 
-            if (!isOceanic(landID))
+/* The rule of mapCoolWarm() and mapHeatIce(), see climateEdgeRowAVX512(). */
+SIMD_AVX512_FUNC
+static void climateEdgeLanes(int *out, const int *in, int w, int h,
+        int from, int to, int n)
+{
+    const int pw = w + 2;
+    const __m512i vn = _mm512_set1_epi64(n);
+    const __m512i one = _mm512_set1_epi64(1);
+    __m512i v11;
+    __mmask8 m, mn;
+    int i, j;
+
+    for (j = 0; j < h; j++)
+    {
+        for (i = 0; i < w; i++)
+        {
+            v11 = loadLanes(in, i+1 + (size_t)(j+1)*pw);
+            m = _mm512_cmpeq_epi64_mask(v11, _mm512_set1_epi64(from));
+            if (m)
             {
-                out[x + z*areaWidth] = landID;
-                continue;
+                mn = _mm512_cmple_epu64_mask(_mm512_sub_epi64(loadLanes(in, i+1 + (size_t)j*pw), vn), one);
+                mn |= _mm512_cmple_epu64_mask(_mm512_sub_epi64(loadLanes(in, i+2 + (size_t)(j+1)*pw), vn), one);
+                mn |= _mm512_cmple_epu64_mask(_mm512_sub_epi64(loadLanes(in, i + (size_t)(j+1)*pw), vn), one);
+                mn |= _mm512_cmple_epu64_mask(_mm512_sub_epi64(loadLanes(in, i+1 + (size_t)(j+2)*pw), vn), one);
+                v11 = _mm512_mask_mov_epi64(v11, m & mn, _mm512_set1_epi64(to));
             }
+            storeLanes(out, i + (size_t)j*w, v11);
+        }
+    }
+}
+
+SIMD_AVX512_FUNC
+static void specialLanes(__m512i vss, __m512i vws, int *out, const int *in,
+        int x, int z, int w, int h)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    __m512i v, cs, r;
+    __mmask8 m;
+    int i, j;
 
-            for (i = -8; i <= 8; i += 4)
+    for (j = 0; j < h; j++)
+    {
+        for (i = 0; i < w; i++)
+        {
+            v = loadLanes(in, i + (size_t)j*w);
+            m = _mm512_test_epi64_mask(v, v);
+            if (m)
             {
-                for (j = -8; j <= 8; j += 4)
-                {
-                    int nearbyID = map1[(x+i+8) + (z+j+8)*landWidth];
+                cs = getLaneChunkSeeds(vss, x+i, z+j);
+                m = _mm512_mask_cmpeq_epi64_mask(m, mc8NextInt64(&cs, vws, 13), zero);
+                r = _mm512_add_epi64(mc8NextInt64(&cs, vws, 15), _mm512_set1_epi64(1));
+                r = _mm512_and_si512(_mm512_slli_epi64(r, 8), _mm512_set1_epi64(0xf00));
+                v = _mm512_mask_or_epi64(v, m, v, r);
+            }
+            storeLanes(out, i + (size_t)j*w, v);
+        }
+    }
+}
 
-                    if (isOceanic(nearbyID)) continue;
+SIMD_AVX512_FUNC
+static void mushroomLanes(__m512i vss, int *out, const int *in,
+        int x, int z, int w, int h)
+{
+    const int pw = w + 2;
+    __m512i v, n;
+    __mmask8 m;
+    int i, j;
 
-                    if (oceanID == warm_ocean)
-                    {
-                        out[x + z*areaWidth] = lukewarm_ocean;
-                        goto loop_x;
-                    }
+    for (j = 0; j < h; j++)
+    {
+        for (i = 0; i < w; i++)
+        {
+            v = loadLanes(in, i+1 + (size_t)(j+1)*pw);
+            n = _mm512_or_si512(
+                    _mm512_or_si512(loadLanes(in, i + (size_t)j*pw), loadLanes(in, i+2 + (size_t)j*pw)),
+                    _mm512_or_si512(loadLanes(in, i + (size_t)(j+2)*pw), loadLanes(in, i+2 + (size_t)(j+2)*pw)));
+            // surrounded by ocean?
+            n = _mm512_or_si512(v, n);
+            m = _mm512_testn_epi64_mask(n, n);
+            if (m)
+            {
+                n = mod8Int64(_mm512_srai_epi64(getLaneChunkSeeds(vss, x+i, z+j), 24), 100);
+                m = _mm512_mask_testn_epi64_mask(m, n, n);
+                v = _mm512_mask_mov_epi64(v, m, _mm512_set1_epi64(mushroom_fields));
+            }
+            storeLanes(out, i + (size_t)j*w, v);
+        }
+    }
+}
 
-                    if (oceanID == frozen_ocean)
-                    {
-                        out[x + z*areaWidth] = cold_ocean;
-                        goto loop_x;
-                    }
-                }
+SIMD_AVX512_FUNC
+static void deepOceanLanes(int *out, const int *in, int w, int h)
+{
+    const int pw = w + 2;
+    const __m512i shallow = _mm512_set1_epi64(BC_SHALLOW);
+    __m512i v11, c, d;
+    __mmask8 m;
+    int i, j;
+
+    for (j = 0; j < h; j++)
+    {
+        for (i = 0; i < w; i++)
+        {
+            v11 = loadLanes(in, i+1 + (size_t)(j+1)*pw);
+            m = _mm512_test_epi64_mask(biomeCats8(v11), shallow);
+            if (m)
+            {
+                c = _mm512_and_si512(
+                        _mm512_and_si512(biomeCats8(loadLanes(in, i+1 + (size_t)j*pw)),
+                                         biomeCats8(loadLanes(in, i+2 + (size_t)(j+1)*pw))),
+                        _mm512_and_si512(biomeCats8(loadLanes(in, i + (size_t)(j+1)*pw)),
+                                         biomeCats8(loadLanes(in, i+1 + (size_t)(j+2)*pw))));
+                m = _mm512_mask_test_epi64_mask(m, c, shallow);
+                // getDeepOcean()
+                d = _mm512_set1_epi64(deep_ocean);
+                d = _mm512_mask_mov_epi64(d, _mm512_cmpeq_epi64_mask(v11, _mm512_set1_epi64(warm_ocean)),
+                        _mm512_set1_epi64(deep_warm_ocean));
+                d = _mm512_mask_mov_epi64(d, _mm512_cmpeq_epi64_mask(v11, _mm512_set1_epi64(lukewarm_ocean)),
+                        _mm512_set1_epi64(deep_lukewarm_ocean));
+                d = _mm512_mask_mov_epi64(d, _mm512_cmpeq_epi64_mask(v11, _mm512_set1_epi64(cold_ocean)),
+                        _mm512_set1_epi64(deep_cold_ocean));
+                d = _mm512_mask_mov_epi64(d, _mm512_cmpeq_epi64_mask(v11, _mm512_set1_epi64(frozen_ocean)),
+                        _mm512_set1_epi64(deep_frozen_ocean));
+                v11 = _mm512_mask_mov_epi64(v11, m, d);
             }
+            storeLanes(out, i + (size_t)j*w, v11);
+        }
+    }
+}
 
-            if (landID == deep_ocean)
+/* getClimateBiome(), see climateRowAVX512(). The remaining entries do not
+ * draw any values and are finished individually.
+ */
+SIMD_AVX512_FUNC
+static void climateLanes(__m512i vss, int *out, const int *in,
+        int x, int z, int w, int h, const int *lush)
+{
+    const __m512i warmT = _mm512_setr_epi64(warmBiomes[0], warmBiomes[1],
+            warmBiomes[2], warmBiomes[3], warmBiomes[4], warmBiomes[5], 0, 0);
+    const __m512i lushT = _mm512_setr_epi64(lush[0], lush[1], lush[2],
+            lush[3], lush[4], lush[5], 0, 0);
+    const __m512i coldT = _mm512_setr_epi64(coldBiomes[0], coldBiomes[1],
+            coldBiomes[2], coldBiomes[3], 0, 0, 0, 0);
+    const __m512i snowT = _mm512_setr_epi64(snowBiomes[0], snowBiomes[1],
+            snowBiomes[2], snowBiomes[3], 0, 0, 0, 0);
+    const __m512i high = _mm512_set1_epi64(0xf00);
+    __m512i v, id, cs, r, r3, r4, r6;
+    __mmask8 mh, mw, ml, mc, mf, rest;
+    int *e;
+    int i, j, k;
+
+    for (j = 0; j < h; j++)
+    {
+        for (i = 0; i < w; i++)
+        {
+            v = loadLanes(in, i + (size_t)j*w);
+            id = _mm512_andnot_si512(high, v);
+            mh = _mm512_test_epi64_mask(v, high);
+            mw = _mm512_cmpeq_epi64_mask(id, _mm512_set1_epi64(Warm));
+            ml = _mm512_cmpeq_epi64_mask(id, _mm512_set1_epi64(Lush));
+            mc = _mm512_cmpeq_epi64_mask(id, _mm512_set1_epi64(Cold));
+            mf = _mm512_cmpeq_epi64_mask(id, _mm512_set1_epi64(Freezing));
+
+            cs = _mm512_srai_epi64(getLaneChunkSeeds(vss, x+i, z+j), 24);
+            r3 = mod8Int64(cs, 3);
+            r4 = mod8Int64(cs, 4);
+            r6 = mod8Int64(cs, 6);
+
+            r = _mm512_permutexvar_epi64(r4, snowT);
+            r = _mm512_mask_permutexvar_epi64(r, mc, r4, coldT);
+            r = _mm512_mask_permutexvar_epi64(r, ml, r6, lushT);
+            r = _mm512_mask_permutexvar_epi64(r, mw, r6, warmT);
+            r = _mm512_mask_mov_epi64(r, mh & mc, _mm512_set1_epi64(giant_tree_taiga));
+            r = _mm512_mask_mov_epi64(r, mh & ml, _mm512_set1_epi64(jungle));
+            r = _mm512_mask_mov_epi64(r, mh & mw, _mm512_set1_epi64(wooded_badlands_plateau));
+            r = _mm512_mask_mov_epi64(r, _mm512_mask_testn_epi64_mask(mh & mw, r3, r3),
+                    _mm512_set1_epi64(badlands_plateau));
+            storeLanes(out, i + (size_t)j*w, r);
+
+            e = out + (i + (size_t)j*w) * SEED_LANES;
+            rest = ~(mw | ml | mc | mf);
+            for (k = 0; rest; k++, rest >>= 1)
             {
-                switch (oceanID)
+                if (rest & 1)
                 {
-                case lukewarm_ocean:
-                    oceanID = deep_lukewarm_ocean;
-                    break;
-                case ocean:
-                    oceanID = deep_ocean;
-                    break;
-                case cold_ocean:
-                    oceanID = deep_cold_ocean;
-                    break;
-                case frozen_ocean:
-                    oceanID = deep_frozen_ocean;
-                    break;
+                    int b = in[(i + (size_t)j*w) * SEED_LANES + k] & -0xf01;
+                    e[k] = getBiomeType(b) == Ocean || b == mushroom_fields ? b : mushroom_fields;
                 }
             }
+        }
+    }
+}
 
-            out[x + z*areaWidth] = oceanID;
+SIMD_AVX512_FUNC
+static void bambooLanes(__m512i vss, int *out, const int *in,
+        int x, int z, int w, int h)
+{
+    __m512i v, r;
+    __mmask8 m;
+    int i, j;
 
-            loop_x:;
+    for (j = 0; j < h; j++)
+    {
+        for (i = 0; i < w; i++)
+        {
+            v = loadLanes(in, i + (size_t)j*w);
+            m = _mm512_cmpeq_epi64_mask(v, _mm512_set1_epi64(jungle));
+            if (m)
+            {
+                r = mod8Int64(_mm512_srai_epi64(getLaneChunkSeeds(vss, x+i, z+j), 24), 10);
+                m = _mm512_mask_testn_epi64_mask(m, r, r);
+                v = _mm512_mask_mov_epi64(v, m, _mm512_set1_epi64(bamboo_jungle));
+            }
+            storeLanes(out, i + (size_t)j*w, v);
         }
     }
+}
+
+SIMD_AVX512_FUNC
+static void riverInitLanes(__m512i vss, int *out, const int *in,
+        int x, int z, int w, int h)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    __m512i v, r;
+    __mmask8 m;
+    int i, j;
 
-    free(map1);
-    free(map2);
+    for (j = 0; j < h; j++)
+    {
+        for (i = 0; i < w; i++)
+        {
+            v = loadLanes(in, i + (size_t)j*w);
+            m = _mm512_cmpgt_epi64_mask(v, zero);
+            if (m)
+            {
+                r = mod8Int64(_mm512_srai_epi64(getLaneChunkSeeds(vss, x+i, z+j), 24), 299999);
+                v = _mm512_maskz_add_epi64(m, r, _mm512_set1_epi64(2));
+            }
+            else
+            {
+                v = zero;
+            }
+            storeLanes(out, i + (size_t)j*w, v);
+        }
+    }
 }
 
+SIMD_AVX512_FUNC
+static void mapLanesAVX512(Layer *l, const int64_t *ws, int *out, const int *in,
+        int x, int z, int w, int h)
+{
+    const __m512i vws = _mm512_loadu_si512(ws);
+    const __m512i vss = nextLaneSeeds(vws, _mm512_setzero_si512());
+
+    if (l->getMap == mapIsland)
+        islandLanes(vss, out, x, z, w, h);
+    else if (l->getMap == mapZoom)
+        zoomLanes(vws, l->p->getMap == mapIsland, out, in, x, z, w, h);
+    else if (l->getMap == mapAddIsland)
+        addIslandLanes(vss, vws, out, in, x, z, w, h);
+    else if (l->getMap == mapRemoveTooMuchOcean)
+        removeOceanLanes(vss, out, in, x, z, w, h);
+    else if (l->getMap == mapAddSnow)
+        addSnowLanes(vss, out, in, x, z, w, h);
+    else if (l->getMap == mapCoolWarm)
+        climateEdgeLanes(out, in, w, h, 1, 2, 3);
+    else if (l->getMap == mapHeatIce)
+        climateEdgeLanes(out, in, w, h, 4, 3, 1);
+    else if (l->getMap == mapSpecial)
+        specialLanes(vss, vws, out, in, x, z, w, h);
+    else if (l->getMap == mapAddMushroomIsland)
+        mushroomLanes(vss, out, in, x, z, w, h);
+    else if (l->getMap == mapDeepOcean)
+        deepOceanLanes(out, in, w, h);
+    else if (l->getMap == mapBiome)
+        climateLanes(vss, out, in, x, z, w, h, lushBiomes);
+    else if (l->getMap == mapBiomeBE)
+        climateLanes(vss, out, in, x, z, w, h, lushBiomesBE);
+    else if (l->getMap == mapAddBamboo)
+        bambooLanes(vss, out, in, x, z, w, h);
+    else if (l->getMap == mapRiverInit)
+        riverInitLanes(vss, out, in, x, z, w, h);
+}
 
+#endif // SIMD_DISPATCH
 
-void mapVoronoiZoom(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+int hasLayerLanes(const Layer *l)
 {
-    areaX -= 2;
-    areaZ -= 2;
-    int pX = areaX >> 2;
-    int pZ = areaZ >> 2;
-    int pWidth = (areaWidth >> 2) + 2;
-    int pHeight = (areaHeight >> 2) + 2;
-    int newWidth = (pWidth-1) << 2;
-    int newHeight = (pHeight-1) << 2;
-    int x, z, i, j;
-    int *buf = (int *)malloc((newWidth+1)*(newHeight+1)*sizeof(*buf));
+#ifdef SIMD_DISPATCH
+    if (simdLevel < SIMD_AVX512)
+        return 0;
+
+    return  l->getMap == mapIsland ||
+            l->getMap == mapZoom ||
+            l->getMap == mapAddIsland ||
+            l->getMap == mapRemoveTooMuchOcean ||
+            l->getMap == mapAddSnow ||
+            l->getMap == mapCoolWarm ||
+            l->getMap == mapHeatIce ||
+            l->getMap == mapSpecial ||
+            l->getMap == mapAddMushroomIsland ||
+            l->getMap == mapDeepOcean ||
+            l->getMap == mapBiome ||
+            l->getMap == mapBiomeBE ||
+            l->getMap == mapAddBamboo ||
+            l->getMap == mapRiverInit;
+#else
+    return 0;
+#endif
+}
 
-    l->p->getMap(l->p, out, pX, pZ, pWidth, pHeight);
+int mapLayerLanes(Layer *l, const int64_t *seeds, int * __restrict out, const int *in,
+        int x, int z, int w, int h)
+{
+    if (!hasLayerLanes(l))
+        return 0;
 
-    for (z = 0; z < pHeight - 1; z++)
+#ifdef SIMD_DISPATCH
+    int64_t ws[SEED_LANES];
+    int k;
+
+    // the world seeds of the layer, as seedLayer() gives them
+    for (k = 0; k < SEED_LANES; k++)
     {
-        int v00 = out[(z+0)*pWidth];
-        int v01 = out[(z+1)*pWidth];
+        ws[k] = seeds[k];
+        ws[k] *= ws[k] * 6364136223846793005LL + 1442695040888963407LL;
+        ws[k] += l->baseSeed;
+        ws[k] *= ws[k] * 6364136223846793005LL + 1442695040888963407LL;
+        ws[k] += l->baseSeed;
+        ws[k] *= ws[k] * 6364136223846793005LL + 1442695040888963407LL;
+        ws[k] += l->baseSeed;
+    }
+
+    mapLanesAVX512(l, ws, out, in, x, z, w, h);
+#endif
+    return 1;
+}
 
-        for (x = 0; x < pWidth - 1; x++)
-        {
-            setChunkSeed(l, (x+pX) << 2, (z+pZ) << 2);
-            double da1 = (mcNextInt(l, 1024) / 1024.0 - 0.5) * 3.6;
-            double da2 = (mcNextInt(l, 1024) / 1024.0 - 0.5) * 3.6;
 
-            setChunkSeed(l, (x+pX+1) << 2, (z+pZ) << 2);
-            double db1 = (mcNextInt(l, 1024) / 1024.0 - 0.5) * 3.6 + 4.0;
-            double db2 = (mcNextInt(l, 1024) / 1024.0 - 0.5) * 3.6;
+static inline int replaceEdge(int *out, int v10, int v21, int v01, int v12, int id, int baseID, int edgeID)
+{
+    if (id != baseID) return 0;
 
-            setChunkSeed(l, (x+pX) << 2, (z+pZ+1) << 2);
-            double dc1 = (mcNextInt(l, 1024) / 1024.0 - 0.5) * 3.6;
-            double dc2 = (mcNextInt(l, 1024) / 1024.0 - 0.5) * 3.6 + 4.0;
+    if (equalOrPlateau(v10, baseID) && equalOrPlateau(v21, baseID) && equalOrPlateau(v01, baseID) && equalOrPlateau(v12, baseID))
+        *out = id;
+    else
+        *out = edgeID;
 
-            setChunkSeed(l, (x+pX+1) << 2, (z+pZ+1) << 2);
-            double dd1 = (mcNextInt(l, 1024) / 1024.0 - 0.5) * 3.6 + 4.0;
-            double dd2 = (mcNextInt(l, 1024) / 1024.0 - 0.5) * 3.6 + 4.0;
+    return 1;
+}
 
-            int v10 = out[x+1 + (z+0)*pWidth] & 255;
-            int v11 = out[x+1 + (z+1)*pWidth] & 255;
+/* Biome edge of the entry 'v11' with the direct neighbours v10, v21, v01, v12.
+ * Only the biomes that are checked here depend on their neighbours at all.
+ */
+static inline int getBiomeEdge(int v11, int v10, int v21, int v01, int v12)
+{
+    int out;
 
-            for (j = 0; j < 4; j++)
+    if (/*!replaceEdge(&out, v10, v21, v01, v12, v11, mountains, mountain_edge) &&*/
+       !replaceEdge(&out, v10, v21, v01, v12, v11, wooded_badlands_plateau, badlands) &&
+       !replaceEdge(&out, v10, v21, v01, v12, v11, badlands_plateau, badlands) &&
+       !replaceEdge(&out, v10, v21, v01, v12, v11, giant_tree_taiga, taiga))
+    {
+        if (v11 == desert)
+        {
+            if (v10 != snowy_tundra && v21 != snowy_tundra && v01 != snowy_tundra && v12 != snowy_tundra)
+            {
+                out = v11;
+            }
+            else
+            {
+                out = wooded_mountains;
+            }
+        }
+        else if (v11 == swamp)
+        {
+            if (v10 != desert && v21 != desert && v01 != desert && v12 != desert &&
+                v10 != snowy_taiga && v21 != snowy_taiga && v01 != snowy_taiga && v12 != snowy_taiga &&
+                v10 != snowy_tundra && v21 != snowy_tundra && v01 != snowy_tundra && v12 != snowy_tundra)
+            {
+                if (v10 != jungle && v12 != jungle && v21 != jungle && v01 != jungle &&
+                    v10 != bamboo_jungle && v12 != bamboo_jungle &&
+                    v21 != bamboo_jungle && v01 != bamboo_jungle)
+                    out = v11;
+                else
+                    out = jungleEdge;
+            }
+            else
             {
-                int idx = ((z << 2) + j) * newWidth + (x << 2);
+                out = plains;
+            }
+        }
+        else
+        {
+            out = v11;
+        }
+    }
 
-                for (i = 0; i < 4; i++)
-                {
-                    double da = (j-da2)*(j-da2) + (i-da1)*(i-da1);
-                    double db = (j-db2)*(j-db2) + (i-db1)*(i-db1);
-                    double dc = (j-dc2)*(j-dc2) + (i-dc1)*(i-dc1);
-                    double dd = (j-dd2)*(j-dd2) + (i-dd1)*(i-dd1);
+    return out;
+}
 
-                    if (da < db && da < dc && da < dd)
-                    {
-                        buf[idx++] = v00;
-                    }
-                    else if (db < da && db < dc && db < dd)
-                    {
-                        buf[idx++] = v10;
-                    }
-                    else if (dc < da && dc < db && dc < dd)
-                    {
-                        buf[idx++] = v01;
-                    }
-                    else
-                    {
-                        buf[idx++] = v11;
-                    }
-                }
-            }
+#ifdef SIMD_DISPATCH
 
-            v00 = v10;
-            v01 = v11;
+/* The mask of lanes where any of the direct neighbours is 'id'. */
+SIMD_AVX512_FUNC static inline __mmask16 anyNeighbour16(__m512i v10, __m512i v21,
+        __m512i v01, __m512i v12, int id)
+{
+    const __m512i vid = _mm512_set1_epi32(id);
+    return _mm512_cmpeq_epi32_mask(v10, vid) | _mm512_cmpeq_epi32_mask(v21, vid) |
+           _mm512_cmpeq_epi32_mask(v01, vid) | _mm512_cmpeq_epi32_mask(v12, vid);
+}
+
+/* getBiomeEdge() for 16 entries at a time. */
+SIMD_AVX512_FUNC
+static int biomeEdgeRowAVX512(int *row, const int *in0, const int *in1, const int *in2, int w)
+{
+    __m512i v11, v10, v21, v01, v12, c;
+    __mmask16 mwbp, mbp, mgtt, mdes, mswa, mcold, mjun;
+    int i;
+
+    for (i = 0; i + 16 <= w; i += 16)
+    {
+        v11 = _mm512_loadu_si512(in1 + i+1);
+        mwbp = _mm512_cmpeq_epi32_mask(v11, _mm512_set1_epi32(wooded_badlands_plateau));
+        mbp  = _mm512_cmpeq_epi32_mask(v11, _mm512_set1_epi32(badlands_plateau));
+        mgtt = _mm512_cmpeq_epi32_mask(v11, _mm512_set1_epi32(giant_tree_taiga));
+        mdes = _mm512_cmpeq_epi32_mask(v11, _mm512_set1_epi32(desert));
+        mswa = _mm512_cmpeq_epi32_mask(v11, _mm512_set1_epi32(swamp));
+
+        if (mwbp | mbp | mgtt | mdes | mswa)
+        {
+            v10 = _mm512_loadu_si512(in0 + i+1);
+            v21 = _mm512_loadu_si512(in1 + i+2);
+            v01 = _mm512_loadu_si512(in1 + i);
+            v12 = _mm512_loadu_si512(in2 + i+1);
+
+            if (mwbp | mbp | mgtt)
+            {
+                // categories that all of the neighbours share
+                c = _mm512_and_si512(
+                        _mm512_and_si512(biomeCats16(v10), biomeCats16(v21)),
+                        _mm512_and_si512(biomeCats16(v01), biomeCats16(v12)));
+                mwbp &= _mm512_testn_epi32_mask(c, _mm512_set1_epi32(BC_EQ_WBP));
+                mbp  &= _mm512_testn_epi32_mask(c, _mm512_set1_epi32(BC_EQ_BP));
+                mgtt &= _mm512_testn_epi32_mask(c, _mm512_set1_epi32(BC_EQ_GTT));
+                v11 = _mm512_mask_mov_epi32(v11, mwbp | mbp, _mm512_set1_epi32(badlands));
+                v11 = _mm512_mask_mov_epi32(v11, mgtt, _mm512_set1_epi32(taiga));
+            }
+            mdes &= anyNeighbour16(v10, v21, v01, v12, snowy_tundra);
+            v11 = _mm512_mask_mov_epi32(v11, mdes, _mm512_set1_epi32(wooded_mountains));
+            if (mswa)
+            {
+                mcold = anyNeighbour16(v10, v21, v01, v12, desert) |
+                        anyNeighbour16(v10, v21, v01, v12, snowy_taiga) |
+                        anyNeighbour16(v10, v21, v01, v12, snowy_tundra);
+                mjun = anyNeighbour16(v10, v21, v01, v12, jungle) |
+                       anyNeighbour16(v10, v21, v01, v12, bamboo_jungle);
+                v11 = _mm512_mask_mov_epi32(v11, mswa & ~mcold & mjun, _mm512_set1_epi32(jungle_edge));
+                v11 = _mm512_mask_mov_epi32(v11, mswa & mcold, _mm512_set1_epi32(plains));
+            }
         }
+        _mm512_storeu_si512(row + i, v11);
     }
 
+    return i;
+}
+
+#endif // SIMD_DISPATCH
+
+void mapBiomeEdge(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+{
+    int pX = areaX - 1;
+    int pZ = areaZ - 1;
+    int pWidth = areaWidth + 2;
+    int pHeight = areaHeight + 2;
+    int x, z;
+
+    LayerView pv;
+    requestArea(l->p, &pv, pX, pZ, pWidth, pHeight);
+    const int *in = pv.data;
+    const int stride = pv.stride;
+
     for (z = 0; z < areaHeight; z++)
     {
-        memcpy(&out[z * areaWidth], &buf[(z + (areaZ & 3))*newWidth + (areaX & 3)], areaWidth*sizeof(int));
+        x = 0;
+#ifdef SIMD_DISPATCH
+        if (simdLevel >= SIMD_AVX512)
+            x = biomeEdgeRowAVX512(out + z*areaWidth, in + z*stride, in + (z+1)*stride,
+                    in + (z+2)*stride, areaWidth);
+#endif
+        for (; x < areaWidth; x++)
+        {
+            int v11 = in[x+1 + (z+1)*stride];
+
+            int v10 = in[x+1 + (z+0)*stride];
+            int v21 = in[x+2 + (z+1)*stride];
+            int v01 = in[x+0 + (z+1)*stride];
+            int v12 = in[x+1 + (z+2)*stride];
+
+            out[x + z*areaWidth] = getBiomeEdge(v11, v10, v21, v01, v12);
+        }
+    }
+
+    releaseArea(l->p, &pv);
+}
+
+
+/* Applies the hills layer to the biome 'a11' with the river noise 'b11', with
+ * the chunk seed already set. If '*check' is set, the returned hills variant
+ * only replaces the biome when at least 3 direct neighbours are equal to it.
+ */
+static inline int getHills(Layer *l, int a11, int b11, int *check)
+{
+    int var12 = (b11 - 2) % 29 == 0;
+
+    *check = 0;
+
+    if (a11 != 0 && b11 >= 2 && (b11 - 2) % 29 == 1 && a11 < 128)
+    {
+        return (biomeExists(a11 + 128)) ? a11 + 128 : a11;
     }
+    else if (mcNextInt(l, 3) != 0 && !var12)
+    {
+        return a11;
+    }
+    else
+    {
+        int hillID = a11;
 
-    free(buf);
+        switch(a11)
+        {
+        case desert:
+            hillID = desert_hills; break;
+        case forest:
+            hillID = wooded_hills; break;
+        case birch_forest:
+            hillID = birch_forest_hills; break;
+        case dark_forest:
+            hillID = plains; break;
+        case taiga:
+            hillID = taiga_hills; break;
+        case giant_tree_taiga:
+            hillID = giant_tree_taiga_hills; break;
+        case snowy_taiga:
+            hillID = snowy_taiga_hills; break;
+        case plains:
+            hillID = (mcNextInt(l, 3) == 0) ? wooded_hills : forest; break;
+        case snowy_tundra:
+            hillID = snowy_mountains; break;
+        case jungle:
+            hillID = jungle_hills; break;
+        case ocean:
+            hillID = deep_ocean; break;
+        case mountains:
+            hillID = wooded_mountains; break;
+        case savanna:
+            hillID = savanna_plateau; break;
+        default:
+            if (equalOrPlateau(a11, wooded_badlands_plateau))
+                hillID = badlands;
+            else if (a11 == deep_ocean && mcNextInt(l, 3) == 0)
+                hillID = (mcNextInt(l, 2) == 0) ? plains : forest;
+            break;
+        }
+
+        if (var12 && hillID != a11)
+        {
+            if (biomeExists(hillID + 128))
+                hillID += 128;
+            else
+                hillID = a11;
+        }
+
+        *check = hillID != a11;
+        return hillID;
+    }
+}
+
+void mapHills(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+{
+    int pX = areaX - 1;
+    int pZ = areaZ - 1;
+    int pWidth = areaWidth + 2;
+    int pHeight = areaHeight + 2;
+    int x, z;
+    LayerView pv, pv2;
+
+    if (l->p2 == NULL)
+    {
+        printf("mapHills() requires two parents! Use setupMultiLayer()\n");
+        exit(1);
+    }
+
+    requestArea(l->p, &pv, pX, pZ, pWidth, pHeight);
+    requestArea(l->p2, &pv2, pX, pZ, pWidth, pHeight);
+    const int *in = pv.data, *in2 = pv2.data;
+    const int stride = pv.stride, stride2 = pv2.stride;
+
+    const int64_t ws = l->worldSeed;
+    const int64_t ss = ws * (ws * 6364136223846793005LL + 1442695040888963407LL);
+    ChunkSeedRow seeds;
+
+    for (z = 0; z < areaHeight; z++)
+    {
+        initChunkSeedRow(&seeds, ss, areaX, z + areaZ, 1, areaWidth);
+        for (x = 0; x < areaWidth; x++, nextChunkSeedRow(&seeds))
+        {
+            l->chunkSeed = getRowChunkSeed(&seeds);
+            int a11 = in[x+1 + (z+1)*stride]; // biome branch
+            int b11 = in2[x+1 + (z+1)*stride2]; // river branch
+            int check;
+            int v = getHills(l, a11, b11, &check);
+
+            if (check)
+            {
+                int a10 = in[x+1 + (z+0)*stride];
+                int a21 = in[x+2 + (z+1)*stride];
+                int a01 = in[x+0 + (z+1)*stride];
+                int a12 = in[x+1 + (z+2)*stride];
+                int equals = 0;
+
+                if (equalOrPlateau(a10, a11)) equals++;
+                if (equalOrPlateau(a21, a11)) equals++;
+                if (equalOrPlateau(a01, a11)) equals++;
+                if (equalOrPlateau(a12, a11)) equals++;
+
+                if (equals < 3)
+                    v = a11;
+            }
+
+            out[x + z*areaWidth] = v;
+        }
+    }
+
+    releaseArea(l->p2, &pv2);
+    releaseArea(l->p, &pv);
+}
+
+
+static inline int getHills113(Layer *l, int a11, int b11, int *check)
+{
+    int bn = (b11 - 2) % 29;
+
+    *check = 0;
+
+    if (!(isOceanic(a11) || b11 < 2 || bn != 1 || a11 >= 128))
+    {
+        return (biomeExists(a11 + 128)) ? a11 + 128 : a11;
+    }
+    else if (mcNextInt(l, 3) == 0 || bn == 0)
+    {
+        int hillID = a11;
+
+        switch(a11)
+        {
+        case desert:
+            hillID = desert_hills; break;
+        case forest:
+            hillID = wooded_hills; break;
+        case birch_forest:
+            hillID = birch_forest_hills; break;
+        case dark_forest:
+            hillID = plains; break;
+        case taiga:
+            hillID = taiga_hills; break;
+        case giant_tree_taiga:
+            hillID = giant_tree_taiga_hills; break;
+        case snowy_taiga:
+            hillID = snowy_taiga_hills; break;
+        case plains:
+            hillID = (mcNextInt(l, 3) == 0) ? wooded_hills : forest; break;
+        case snowy_tundra:
+            hillID = snowy_mountains; break;
+        case jungle:
+            hillID = jungle_hills; break;
+        case bamboo_jungle:
+            hillID = bamboo_jungle_hills; break;
+        case ocean:
+            hillID = deep_ocean; break;
+        case mountains:
+            hillID = wooded_mountains; break;
+        case savanna:
+            hillID = savanna_plateau; break;
+        default:
+            if (equalOrPlateau(a11, wooded_badlands_plateau))
+                hillID = badlands;
+            else if (isDeepOcean(a11) && mcNextInt(l, 3) == 0)
+                hillID = (mcNextInt(l, 2) == 0) ? plains : forest;
+            break;
+        }
+
+        if (bn == 0 && hillID != a11)
+        {
+            if (biomeExists(hillID + 128))
+                hillID += 128;
+            else
+                hillID = a11;
+        }
+
+        *check = hillID != a11;
+        return hillID;
+    }
+    else
+    {
+        return a11;
+    }
+}
+
+void mapHills113(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+{
+    int pX = areaX - 1;
+    int pZ = areaZ - 1;
+    int pWidth = areaWidth + 2;
+    int pHeight = areaHeight + 2;
+    int x, z;
+    LayerView pv, pv2;
+
+    if (l->p2 == NULL)
+    {
+        printf("mapHills() requires two parents! Use setupMultiLayer()\n");
+        exit(1);
+    }
+
+    requestArea(l->p, &pv, pX, pZ, pWidth, pHeight);
+    requestArea(l->p2, &pv2, pX, pZ, pWidth, pHeight);
+    const int *in = pv.data, *in2 = pv2.data;
+    const int stride = pv.stride, stride2 = pv2.stride;
+
+    const int64_t ws = l->worldSeed;
+    const int64_t ss = ws * (ws * 6364136223846793005LL + 1442695040888963407LL);
+    ChunkSeedRow seeds;
+
+    for (z = 0; z < areaHeight; z++)
+    {
+        initChunkSeedRow(&seeds, ss, areaX, z + areaZ, 1, areaWidth);
+        for (x = 0; x < areaWidth; x++, nextChunkSeedRow(&seeds))
+        {
+            l->chunkSeed = getRowChunkSeed(&seeds);
+            int a11 = in[x+1 + (z+1)*stride]; // biome branch
+            int b11 = in2[x+1 + (z+1)*stride2]; // river branch
+            int check;
+            int v = getHills113(l, a11, b11, &check);
+
+            if (check)
+            {
+                int a10 = in[x+1 + (z+0)*stride];
+                int a21 = in[x+2 + (z+1)*stride];
+                int a01 = in[x+0 + (z+1)*stride];
+                int a12 = in[x+1 + (z+2)*stride];
+                int equals = 0;
+
+                if (equalOrPlateau(a10, a11)) equals++;
+                if (equalOrPlateau(a21, a11)) equals++;
+                if (equalOrPlateau(a01, a11)) equals++;
+                if (equalOrPlateau(a12, a11)) equals++;
+
+                if (equals < 3)
+                    v = a11;
+            }
+
+            out[x + z*areaWidth] = v;
+        }
+    }
+
+    releaseArea(l->p2, &pv2);
+    releaseArea(l->p, &pv);
+}
+
+
+
+static inline int reduceID(int id)
+{
+    return id >= 2 ? 2 + (id & 1) : id;
+}
+
+#ifdef SIMD_DISPATCH
+
+/* reduceID() of 16 entries. */
+SIMD_AVX512_FUNC static inline __m512i reduce16IDs(__m512i v)
+{
+    const __m512i one = _mm512_set1_epi32(1);
+    return _mm512_mask_add_epi32(v, _mm512_cmpgt_epi32_mask(v, one),
+            _mm512_and_si512(v, one), _mm512_set1_epi32(2));
+}
+
+SIMD_AVX512_FUNC
+static int riverRowAVX512(int *row, const int *in0, const int *in1, const int *in2, int w)
+{
+    __m512i v11;
+    __mmask16 m;
+    int i;
+
+    for (i = 0; i + 16 <= w; i += 16)
+    {
+        v11 = reduce16IDs(_mm512_loadu_si512(in1 + i+1));
+        m = _mm512_cmpeq_epi32_mask(v11, reduce16IDs(_mm512_loadu_si512(in1 + i)));
+        m &= _mm512_cmpeq_epi32_mask(v11, reduce16IDs(_mm512_loadu_si512(in0 + i+1)));
+        m &= _mm512_cmpeq_epi32_mask(v11, reduce16IDs(_mm512_loadu_si512(in1 + i+2)));
+        m &= _mm512_cmpeq_epi32_mask(v11, reduce16IDs(_mm512_loadu_si512(in2 + i+1)));
+        _mm512_storeu_si512(row + i, _mm512_mask_blend_epi32(m,
+                _mm512_set1_epi32(river), _mm512_set1_epi32(-1)));
+    }
+
+    return i;
+}
+
+#endif // SIMD_DISPATCH
+
+void mapRiver(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+{
+    int pX = areaX - 1;
+    int pZ = areaZ - 1;
+    int pWidth = areaWidth + 2;
+    int pHeight = areaHeight + 2;
+    int x, z;
+
+    LayerView pv;
+    requestArea(l->p, &pv, pX, pZ, pWidth, pHeight);
+    const int *in = pv.data;
+    const int stride = pv.stride;
+
+    if (isUniformArea(&pv, pWidth, pHeight))
+    {
+        fillArea(out, areaWidth, -1, areaWidth, areaHeight);
+        releaseArea(l->p, &pv);
+        return;
+    }
+
+    for (z = 0; z < areaHeight; z++)
+    {
+        x = 0;
+#ifdef SIMD_DISPATCH
+        if (simdLevel >= SIMD_AVX512)
+            x = riverRowAVX512(out + z*areaWidth, in + z*stride, in + (z+1)*stride,
+                    in + (z+2)*stride, areaWidth);
+#endif
+        for (; x < areaWidth; x++)
+        {
+            int v01 = reduceID(in[x+0 + (z+1)*stride]);
+            int v21 = reduceID(in[x+2 + (z+1)*stride]);
+            int v10 = reduceID(in[x+1 + (z+0)*stride]);
+            int v12 = reduceID(in[x+1 + (z+2)*stride]);
+            int v11 = reduceID(in[x+1 + (z+1)*stride]);
+
+            if (v11 == v01 && v11 == v10 && v11 == v21 && v11 == v12)
+            {
+                out[x + z * areaWidth] = -1;
+            }
+            else
+            {
+                out[x + z * areaWidth] = river;
+            }
+        }
+    }
+
+    releaseArea(l->p, &pv);
+}
+
+
+#ifdef SIMD_DISPATCH
+
+SIMD_AVX512_FUNC
+static int smoothRowAVX512(int *row, const int *in0, const int *in1, const int *in2,
+        int x, int z, int w, int64_t ss)
+{
+    const __m512i vss = _mm512_set1_epi64(ss);
+    const __m512i zs = _mm512_set1_epi64(z);
+    __m512i xs = _mm512_add_epi64(_mm512_set1_epi64(x),
+            _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7));
+    __m512i v11, v10, v21, v01, v12, r;
+    __mmask8 mh, mv;
+    int i;
+
+    for (i = 0; i + 8 <= w; i += 8)
+    {
+        v11 = load8Ints64(in1 + i+1);
+        v10 = load8Ints64(in0 + i+1);
+        v21 = load8Ints64(in1 + i+2);
+        v01 = load8Ints64(in1 + i);
+        v12 = load8Ints64(in2 + i+1);
+
+        mh = _mm512_cmpeq_epi64_mask(v01, v21);
+        mv = _mm512_cmpeq_epi64_mask(v10, v12);
+        v11 = _mm512_mask_mov_epi64(v11, mh, v01);
+        v11 = _mm512_mask_mov_epi64(v11, mv, v10);
+        mv &= _mm512_cmpneq_epi64_mask(v01, v10);
+        if (mh & mv)
+        {
+            // both axes agree on different values: the random value picks
+            // v01 over v10
+            r = mod8Int64(_mm512_srai_epi64(set8ChunkSeeds64(vss, xs, zs), 24), 2);
+            v11 = _mm512_mask_mov_epi64(v11, _mm512_mask_testn_epi64_mask(mh & mv, r, r), v01);
+        }
+        _mm256_storeu_si256((__m256i*)(row + i), _mm512_cvtepi64_epi32(v11));
+        xs = _mm512_add_epi64(xs, _mm512_set1_epi64(8));
+    }
+
+    return i;
+}
+
+#endif // SIMD_DISPATCH
+
+void mapSmooth(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+{
+    int pX = areaX - 1;
+    int pZ = areaZ - 1;
+    int pWidth = areaWidth + 2;
+    int pHeight = areaHeight + 2;
+    int x, z;
+
+    LayerView pv;
+    requestArea(l->p, &pv, pX, pZ, pWidth, pHeight);
+    const int *in = pv.data;
+    const int stride = pv.stride;
+
+    if (isUniformArea(&pv, pWidth, pHeight))
+    {
+        // the random choice is between two equal entries
+        fillArea(out, areaWidth, in[0], areaWidth, areaHeight);
+        releaseArea(l->p, &pv);
+        return;
+    }
+
+    const int64_t ws = l->worldSeed;
+    const int64_t ss = ws * (ws * 6364136223846793005LL + 1442695040888963407LL);
+    ChunkSeedRow seeds;
+
+    for (z = 0; z < areaHeight; z++)
+    {
+        x = 0;
+#ifdef SIMD_DISPATCH
+        if (simdLevel >= SIMD_AVX512)
+            x = smoothRowAVX512(out + z*areaWidth, in + z*stride, in + (z+1)*stride,
+                    in + (z+2)*stride, areaX, areaZ + z, areaWidth, ss);
+#endif
+        initChunkSeedRow(&seeds, ss, x + areaX, z + areaZ, 1, areaWidth - x);
+        for (; x < areaWidth; x++, nextChunkSeedRow(&seeds))
+        {
+            int v11 = in[x+1 + (z+1)*stride];
+            int v10 = in[x+1 + (z+0)*stride];
+            int v21 = in[x+2 + (z+1)*stride];
+            int v01 = in[x+0 + (z+1)*stride];
+            int v12 = in[x+1 + (z+2)*stride];
+
+            if (v01 == v21 && v10 == v12 && v01 != v10)
+            {
+                l->chunkSeed = getRowChunkSeed(&seeds);
+
+                if (mcNextInt(l, 2) == 0)
+                    v11 = v01;
+                else
+                    v11 = v10;
+            }
+            else
+            {
+                if (v01 == v21) v11 = v01;
+                if (v10 == v12) v11 = v10;
+            }
+
+            out[x + z * areaWidth] = v11;
+        }
+    }
+
+    releaseArea(l->p, &pv);
+}
+
+
+void mapRareBiome(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+{
+    int x, z;
+
+    LayerView pv;
+    requestArea(l->p, &pv, areaX, areaZ, areaWidth, areaHeight);
+    const int *in = pv.data;
+    const int stride = pv.stride;
+
+    const int64_t ws = l->worldSeed;
+    const int64_t ss = ws * (ws * 6364136223846793005LL + 1442695040888963407LL);
+    ChunkSeedRow seeds;
+
+    for (z = 0; z < areaHeight; z++)
+    {
+        initChunkSeedRow(&seeds, ss, areaX, z + areaZ, 1, areaWidth);
+        for (x = 0; x < areaWidth; x++, nextChunkSeedRow(&seeds))
+        {
+            l->chunkSeed = getRowChunkSeed(&seeds);
+            int v11 = in[x + z*stride];
+
+            if (mcNextInt(l, 57) == 0 && v11 == plains)
+            {
+                // Sunflower Plains
+                out[x + z*areaWidth] = plains + 128;
+            }
+            else
+            {
+                out[x + z*areaWidth] = v11;
+            }
+        }
+    }
+
+    releaseArea(l->p, &pv);
+}
+
+
+inline static int replaceOcean(int *out, int v10, int v21, int v01, int v12, int id, int replaceID)
+{
+    if (isOceanic(id)) return 0;
+
+    if (!isOceanic(v10) && !isOceanic(v21) && !isOceanic(v01) && !isOceanic(v12))
+        *out = id;
+    else
+        *out = replaceID;
+
+    return 1;
+}
+
+inline static int isBiomeJFTO(int id)
+{
+    return biomeExists(id) && (getBiomeType(id) == Jungle || id == forest || id == taiga || isOceanic(id));
+}
+
+/* Shore of the entry 'v11' with the direct neighbours v10, v21, v01, v12. */
+static inline int getShore(int v11, int v10, int v21, int v01, int v12)
+{
+    int biome = biomeExists(v11) ? v11 : 0;
+    int out = v11;
+
+    if (v11 == mushroom_fields)
+    {
+        if (v10 != ocean && v21 != ocean && v01 != ocean && v12 != ocean)
+            out = v11;
+        else
+            out = mushroom_field_shore;
+    }
+    else if (/*biome < 128 &&*/ getBiomeType(biome) == Jungle)
+    {
+        if (isBiomeJFTO(v10) && isBiomeJFTO(v21) && isBiomeJFTO(v01) && isBiomeJFTO(v12))
+        {
+            if (!isOceanic(v10) && !isOceanic(v21) && !isOceanic(v01) && !isOceanic(v12))
+                out = v11;
+            else
+                out = beach;
+        }
+        else
+        {
+            out = jungleEdge;
+        }
+    }
+    else if (v11 != mountains && v11 != wooded_mountains && v11 != mountain_edge)
+    {
+        if (isBiomeSnowy(biome))
+        {
+            replaceOcean(&out, v10, v21, v01, v12, v11, snowy_beach);
+        }
+        else if (v11 != badlands && v11 != wooded_badlands_plateau)
+        {
+            if (v11 != ocean && v11 != deep_ocean && v11 != river && v11 != swamp)
+            {
+                if (!isOceanic(v10) && !isOceanic(v21) && !isOceanic(v01) && !isOceanic(v12))
+                    out = v11;
+                else
+                    out = beach;
+            }
+            else
+            {
+                out = v11;
+            }
+        }
+        else
+        {
+            if (!isOceanic(v10) && !isOceanic(v21) && !isOceanic(v01) && !isOceanic(v12))
+            {
+                if (getBiomeType(v10) == Mesa && getBiomeType(v21) == Mesa && getBiomeType(v01) == Mesa && getBiomeType(v12) == Mesa)
+                    out = v11;
+                else
+                    out = desert;
+            }
+            else
+            {
+                out = v11;
+            }
+        }
+    }
+    else
+    {
+        replaceOcean(&out, v10, v21, v01, v12, v11, stone_shore);
+    }
+
+    return out;
+}
+
+#ifdef SIMD_DISPATCH
+
+/* getShore() for 16 entries at a time. */
+SIMD_AVX512_FUNC
+static int shoreRowAVX512(int *row, const int *in0, const int *in1, const int *in2, int w)
+{
+    const __m512i oceanic = _mm512_set1_epi32(BC_OCEANIC);
+    __m512i v11, v10, v21, v01, v12, c11, c10, c21, c01, c12, call, cany;
+    __mmask16 mmu, mju, mmo, msn, mba, mot, shore, land;
+    int i;
+
+    for (i = 0; i + 16 <= w; i += 16)
+    {
+        v11 = _mm512_loadu_si512(in1 + i+1);
+        v10 = _mm512_loadu_si512(in0 + i+1);
+        v21 = _mm512_loadu_si512(in1 + i+2);
+        v01 = _mm512_loadu_si512(in1 + i);
+        v12 = _mm512_loadu_si512(in2 + i+1);
+
+        c11 = biomeCats16(v11);
+        c10 = biomeCats16(v10);
+        c21 = biomeCats16(v21);
+        c01 = biomeCats16(v01);
+        c12 = biomeCats16(v12);
+        call = _mm512_and_si512(_mm512_and_si512(c10, c21), _mm512_and_si512(c01, c12));
+        cany = _mm512_or_si512(_mm512_or_si512(c10, c21), _mm512_or_si512(c01, c12));
+        shore = _mm512_test_epi32_mask(cany, oceanic);
+        land = _mm512_testn_epi32_mask(c11, oceanic);
+
+        // the branches of getShore(), which exclude one another in this order
+        mmu = _mm512_cmpeq_epi32_mask(v11, _mm512_set1_epi32(mushroom_fields));
+        mju = _mm512_test_epi32_mask(c11, _mm512_set1_epi32(BC_JUNGLE)) & ~mmu;
+        mmo = _mm512_cmpeq_epi32_mask(v11, _mm512_set1_epi32(mountains)) |
+              _mm512_cmpeq_epi32_mask(v11, _mm512_set1_epi32(wooded_mountains)) |
+              _mm512_cmpeq_epi32_mask(v11, _mm512_set1_epi32(mountain_edge));
+        mmo &= ~(mmu | mju);
+        msn = _mm512_test_epi32_mask(c11, _mm512_set1_epi32(BC_SNOWY)) & ~(mmu | mju | mmo);
+        mba = _mm512_cmpeq_epi32_mask(v11, _mm512_set1_epi32(badlands)) |
+              _mm512_cmpeq_epi32_mask(v11, _mm512_set1_epi32(wooded_badlands_plateau));
+        mba &= ~(mmu | mju | mmo | msn);
+        mot = ~(mmu | mju | mmo | msn | mba);
+        mot &= _mm512_cmpneq_epi32_mask(v11, _mm512_set1_epi32(ocean)) &
+               _mm512_cmpneq_epi32_mask(v11, _mm512_set1_epi32(deep_ocean)) &
+               _mm512_cmpneq_epi32_mask(v11, _mm512_set1_epi32(river)) &
+               _mm512_cmpneq_epi32_mask(v11, _mm512_set1_epi32(swamp));
+
+        mmu &= anyNeighbour16(v10, v21, v01, v12, ocean);
+        v11 = _mm512_mask_mov_epi32(v11, mmu, _mm512_set1_epi32(mushroom_field_shore));
+        v11 = _mm512_mask_mov_epi32(v11, mju & _mm512_testn_epi32_mask(call, _mm512_set1_epi32(BC_JFTO)),
+                _mm512_set1_epi32(jungle_edge));
+        v11 = _mm512_mask_mov_epi32(v11, mju & _mm512_test_epi32_mask(call, _mm512_set1_epi32(BC_JFTO)) & shore,
+                _mm512_set1_epi32(beach));
+        v11 = _mm512_mask_mov_epi32(v11, mmo & land & shore, _mm512_set1_epi32(stone_shore));
+        v11 = _mm512_mask_mov_epi32(v11, msn & land & shore, _mm512_set1_epi32(snowy_beach));
+        v11 = _mm512_mask_mov_epi32(v11, mba & ~shore & _mm512_testn_epi32_mask(call, _mm512_set1_epi32(BC_MESA)),
+                _mm512_set1_epi32(desert));
+        v11 = _mm512_mask_mov_epi32(v11, mot & shore, _mm512_set1_epi32(beach));
+        _mm512_storeu_si512(row + i, v11);
+    }
+
+    return i;
+}
+
+#endif // SIMD_DISPATCH
+
+void mapShore(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+{
+    int pX = areaX - 1;
+    int pZ = areaZ - 1;
+    int pWidth = areaWidth + 2;
+    int pHeight = areaHeight + 2;
+    int x, z;
+
+    LayerView pv;
+    requestArea(l->p, &pv, pX, pZ, pWidth, pHeight);
+    const int *in = pv.data;
+    const int stride = pv.stride;
+
+    if (isUniformArea(&pv, pWidth, pHeight))
+    {
+        fillArea(out, areaWidth, getShore(in[0], in[0], in[0], in[0], in[0]), areaWidth, areaHeight);
+        releaseArea(l->p, &pv);
+        return;
+    }
+
+    for (z = 0; z < areaHeight; z++)
+    {
+        x = 0;
+#ifdef SIMD_DISPATCH
+        if (simdLevel >= SIMD_AVX512)
+            x = shoreRowAVX512(out + z*areaWidth, in + z*stride, in + (z+1)*stride,
+                    in + (z+2)*stride, areaWidth);
+#endif
+        for (; x < areaWidth; x++)
+        {
+            int v11 = in[x+1 + (z+1)*stride];
+            int v10 = in[x+1 + (z+0)*stride];
+            int v21 = in[x+2 + (z+1)*stride];
+            int v01 = in[x+0 + (z+1)*stride];
+            int v12 = in[x+1 + (z+2)*stride];
+
+            out[x + z*areaWidth] = getShore(v11, v10, v21, v01, v12);
+        }
+    }
+
+    releaseArea(l->p, &pv);
+}
+
+
+/* Mixes the river 'riv' into the biome 'v'. */
+static inline int getRiverMix(int v, int riv)
+{
+    if (isOceanic(v) || riv != river)
+        return v;
+    if (v == snowy_tundra)
+        return frozen_river;
+    if (v == mushroom_fields || v == mushroom_field_shore)
+        return mushroom_field_shore;
+    return riv & 255;
+}
+
+void mapRiverMix(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+{
+    int x, z;
+    LayerView pv, pv2;
+
+    if (l->p2 == NULL)
+    {
+        printf("mapRiverMix() requires two parents! Use setupMultiLayer()\n");
+        exit(1);
+    }
+
+    requestArea(l->p, &pv, areaX, areaZ, areaWidth, areaHeight); // biome chain
+    requestArea(l->p2, &pv2, areaX, areaZ, areaWidth, areaHeight); // rivers
+
+    if (isUniformArea(&pv2, areaWidth, areaHeight) && isUniformArea(&pv, areaWidth, areaHeight))
+    {
+        fillArea(out, areaWidth, getRiverMix(pv.data[0], pv2.data[0]), areaWidth, areaHeight);
+    }
+    else
+    {
+        for (z = 0; z < areaHeight; z++)
+        {
+            const int *buf = pv.data + (size_t)z*pv.stride;
+            const int *riv = pv2.data + (size_t)z*pv2.stride;
+            int *row = out + (size_t)z*areaWidth;
+
+            for (x = 0; x < areaWidth; x++)
+                row[x] = getRiverMix(buf[x], riv[x]);
+        }
+    }
+
+    releaseArea(l->p2, &pv2);
+    releaseArea(l->p, &pv);
+}
+
+
+
+/* Initialises data for the ocean temperature types using the world seed.
+ * This function is called when the world seed is applied in setWorldSeed().
+ */
+static void oceanRndInit(OceanRnd *rnd, int64_t seed)
+{
+    int i = 0;
+    memset(rnd, 0, sizeof(*rnd));
+    rnd->seed = seed & 0xffffffffffff;
+    rnd->init = 1;
+    setSeed(&seed);
+    rnd->a = nextDouble(&seed) * 256.0;
+    rnd->b = nextDouble(&seed) * 256.0;
+    rnd->c = nextDouble(&seed) * 256.0;
+
+    for (i = 0; i < 256; i++)
+    {
+        rnd->d[i] = i;
+    }
+    for (i = 0; i < 256; i++)
+    {
+        int n3 = nextInt(&seed, 256 - i) + i;
+        int n4 = rnd->d[i];
+        rnd->d[i] = rnd->d[n3];
+        rnd->d[n3] = n4;
+        rnd->d[i + 256] = rnd->d[i];
+    }
+}
+
+static double lerp(const double part, const double from, const double to)
+{
+    return from + part * (to - from);
+}
+
+/* Table of vectors to cube edge centres (12 + 4 extra), used for ocean PRNG */
+const double cEdgeX[] = {1.0,-1.0, 1.0,-1.0, 1.0,-1.0, 1.0,-1.0, 0.0, 0.0, 0.0, 0.0,  1.0, 0.0,-1.0, 0.0};
+const double cEdgeY[] = {1.0, 1.0,-1.0,-1.0, 0.0, 0.0, 0.0, 0.0, 1.0,-1.0, 1.0,-1.0,  1.0,-1.0, 1.0,-1.0};
+const double cEdgeZ[] = {0.0, 0.0, 0.0, 0.0, 1.0, 1.0,-1.0,-1.0, 1.0, 1.0,-1.0,-1.0,  0.0, 1.0, 0.0,-1.0};
+
+static double indexedLerp(int idx, const double d1, const double d2, const double d3)
+{
+    idx &= 0xf;
+    return cEdgeX[idx] * d1 + cEdgeY[idx] * d2 + cEdgeZ[idx] * d3;
+}
+
+
+static double getOceanTemp(const OceanRnd *rnd, double d1, double d2, double d3)
+{
+    d1 += rnd->a;
+    d2 += rnd->b;
+    d3 += rnd->c;
+    int i1 = (int)d1 - (int)(d1 < 0);
+    int i2 = (int)d2 - (int)(d2 < 0);
+    int i3 = (int)d3 - (int)(d3 < 0);
+    d1 -= i1;
+    d2 -= i2;
+    d3 -= i3;
+    double t1 = d1*d1*d1 * (d1 * (d1*6.0-15.0) + 10.0);
+    double t2 = d2*d2*d2 * (d2 * (d2*6.0-15.0) + 10.0);
+    double t3 = d3*d3*d3 * (d3 * (d3*6.0-15.0) + 10.0);
+
+    i1 &= 0xff;
+    i2 &= 0xff;
+    i3 &= 0xff;
+
+    int a1 = rnd->d[i1]   + i2;
+    int a2 = rnd->d[a1]   + i3;
+    int a3 = rnd->d[a1+1] + i3;
+    int b1 = rnd->d[i1+1] + i2;
+    int b2 = rnd->d[b1]   + i3;
+    int b3 = rnd->d[b1+1] + i3;
+
+    double l1 = indexedLerp(rnd->d[a2],   d1,   d2,   d3);
+    double l2 = indexedLerp(rnd->d[b2],   d1-1, d2,   d3);
+    double l3 = indexedLerp(rnd->d[a3],   d1,   d2-1, d3);
+    double l4 = indexedLerp(rnd->d[b3],   d1-1, d2-1, d3);
+    double l5 = indexedLerp(rnd->d[a2+1], d1,   d2,   d3-1);
+    double l6 = indexedLerp(rnd->d[b2+1], d1-1, d2,   d3-1);
+    double l7 = indexedLerp(rnd->d[a3+1], d1,   d2-1, d3-1);
+    double l8 = indexedLerp(rnd->d[b3+1], d1-1, d2-1, d3-1);
+
+    l1 = lerp(t1, l1, l2);
+    l3 = lerp(t1, l3, l4);
+    l5 = lerp(t1, l5, l6);
+    l7 = lerp(t1, l7, l8);
+
+    l1 = lerp(t2, l1, l3);
+    l5 = lerp(t2, l5, l7);
+
+    return lerp(t3, l1, l5);
+}
+
+static inline int getOceanType(const OceanRnd *rnd, int x, int z)
+{
+    double tmp = getOceanTemp(rnd, x / 8.0, z / 8.0, 0);
+
+    if (tmp > 0.4)
+        return warm_ocean;
+    else if (tmp > 0.2)
+        return lukewarm_ocean;
+    else if (tmp < -0.4)
+        return frozen_ocean;
+    else if (tmp < -0.2)
+        return cold_ocean;
+    else
+        return ocean;
+}
+
+#ifdef SIMD_DISPATCH
+
+/* The gradient indices of the 8 corners of the lattice cell (i1,i2,i3) in
+ * getOceanTemp(), packed into 4 bits each.
+ */
+static inline int getOceanCell(const OceanRnd *rnd, int i1, int i2, int i3)
+{
+    i1 &= 0xff;
+    int a1 = rnd->d[i1]   + i2;
+    int a2 = rnd->d[a1]   + i3;
+    int a3 = rnd->d[a1+1] + i3;
+    int b1 = rnd->d[i1+1] + i2;
+    int b2 = rnd->d[b1]   + i3;
+    int b3 = rnd->d[b1+1] + i3;
+
+    return  (rnd->d[a2]   & 0xf)        | (rnd->d[b2]   & 0xf) << 4  |
+            (rnd->d[a3]   & 0xf) << 8   | (rnd->d[b3]   & 0xf) << 12 |
+            (rnd->d[a2+1] & 0xf) << 16  | (rnd->d[b2+1] & 0xf) << 20 |
+            (rnd->d[a3+1] & 0xf) << 24  | (rnd->d[b3+1] & 0xf) << 28;
+}
+
+/* indexedLerp() of 8 entries, with the corner gradients at bit 'shift' of
+ * the packed cells 'g'.
+ */
+SIMD_AVX512_FUNC static inline __m512d indexed8Lerp(__m512i g, int shift,
+        __m512d d1, __m512d d2, __m512d d3)
+{
+    const __m512d ex0 = _mm512_loadu_pd(cEdgeX), ex1 = _mm512_loadu_pd(cEdgeX + 8);
+    const __m512d ey0 = _mm512_loadu_pd(cEdgeY), ey1 = _mm512_loadu_pd(cEdgeY + 8);
+    const __m512d ez0 = _mm512_loadu_pd(cEdgeZ), ez1 = _mm512_loadu_pd(cEdgeZ + 8);
+    __m512i idx = _mm512_and_si512(_mm512_srli_epi64(g, shift), _mm512_set1_epi64(0xf));
+
+    return _mm512_add_pd(
+            _mm512_add_pd(_mm512_mul_pd(_mm512_permutex2var_pd(ex0, idx, ex1), d1),
+                          _mm512_mul_pd(_mm512_permutex2var_pd(ey0, idx, ey1), d2)),
+            _mm512_mul_pd(_mm512_permutex2var_pd(ez0, idx, ez1), d3));
+}
+
+SIMD_AVX512_FUNC static inline __m512d lerp8(__m512d part, __m512d from, __m512d to)
+{
+    return _mm512_add_pd(from, _mm512_mul_pd(part, _mm512_sub_pd(to, from)));
+}
+
+/* getOceanType() for the entries [0, w) of the row z starting at x, 8 at a
+ * time. The samples of a row lie on one plane of constant d2 and d3, and as
+ * d1 advances by 1/8 per entry, the 8 entries of a group cover at most two
+ * lattice cells, whose gradients are looked up once. The arithmetic follows
+ * getOceanTemp() operation by operation, so the types are identical.
+ */
+SIMD_AVX512_FUNC
+static int oceanTypeRowAVX512(const OceanRnd *rnd, int *row, int x, int z, int w)
+{
+    const __m512d zero = _mm512_setzero_pd();
+    const __m512d one = _mm512_set1_pd(1.0);
+    double d2 = z / 8.0 + rnd->b;
+    double d3 = rnd->c;
+    int i2 = (int)d2 - (int)(d2 < 0);
+    int i3 = (int)d3 - (int)(d3 < 0);
+    d2 -= i2;
+    d3 -= i3;
+    double t2 = d2*d2*d2 * (d2 * (d2*6.0-15.0) + 10.0);
+    double t3 = d3*d3*d3 * (d3 * (d3*6.0-15.0) + 10.0);
+    i2 &= 0xff;
+    i3 &= 0xff;
+
+    const __m512d vd2 = _mm512_set1_pd(d2), vd2m = _mm512_set1_pd(d2-1);
+    const __m512d vd3 = _mm512_set1_pd(d3), vd3m = _mm512_set1_pd(d3-1);
+    const __m512d vt2 = _mm512_set1_pd(t2), vt3 = _mm512_set1_pd(t3);
+    __m512d d1, d1m, t1, f, l1, l2, l3, l4, l5, l6, l7, l8;
+    __m512i g, r;
+    __m256i xi;
+    int i, lo, hi, cell0, cell1;
+    double e;
+
+    lo = hi = INT_MIN;
+    cell0 = cell1 = 0;
+
+    for (i = 0; i + 8 <= w; i += 8)
+    {
+        // lattice cells of the first and last entry of the group
+        e = (x+i) / 8.0 + rnd->a;
+        int c0 = (int)e - (int)(e < 0);
+        e = (x+i+7) / 8.0 + rnd->a;
+        int c1 = (int)e - (int)(e < 0);
+        if (c1 - c0 > 1)
+            break;
+        if (c0 != lo)
+        {
+            cell0 = c0 == hi ? cell1 : getOceanCell(rnd, c0, i2, i3);
+            lo = c0;
+        }
+        if (c1 != hi)
+        {
+            cell1 = c1 == lo ? cell0 : getOceanCell(rnd, c1, i2, i3);
+            hi = c1;
+        }
+
+        xi = _mm256_add_epi32(_mm256_set1_epi32(x+i), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        // (x / 8.0) is exact, as is the multiplication by 0.125
+        d1 = _mm512_add_pd(_mm512_mul_pd(_mm512_cvtepi32_pd(xi), _mm512_set1_pd(0.125)),
+                _mm512_set1_pd(rnd->a));
+        f = _mm512_cvtepi32_pd(_mm512_cvttpd_epi32(d1));
+        f = _mm512_mask_sub_pd(f, _mm512_cmp_pd_mask(d1, zero, _CMP_LT_OQ), f, one);
+        g = _mm512_mask_blend_epi64(_mm512_cmp_pd_mask(f, _mm512_set1_pd(lo), _CMP_EQ_OQ),
+                _mm512_set1_epi64((uint32_t)cell1), _mm512_set1_epi64((uint32_t)cell0));
+        d1 = _mm512_sub_pd(d1, f);
+        d1m = _mm512_sub_pd(d1, one);
+        t1 = _mm512_mul_pd(_mm512_mul_pd(_mm512_mul_pd(d1, d1), d1),
+                _mm512_add_pd(_mm512_mul_pd(d1, _mm512_sub_pd(
+                    _mm512_mul_pd(d1, _mm512_set1_pd(6.0)), _mm512_set1_pd(15.0))),
+                    _mm512_set1_pd(10.0)));
+
+        l1 = indexed8Lerp(g,  0, d1,  vd2,  vd3);
+        l2 = indexed8Lerp(g,  4, d1m, vd2,  vd3);
+        l3 = indexed8Lerp(g,  8, d1,  vd2m, vd3);
+        l4 = indexed8Lerp(g, 12, d1m, vd2m, vd3);
+        l5 = indexed8Lerp(g, 16, d1,  vd2,  vd3m);
+        l6 = indexed8Lerp(g, 20, d1m, vd2,  vd3m);
+        l7 = indexed8Lerp(g, 24, d1,  vd2m, vd3m);
+        l8 = indexed8Lerp(g, 28, d1m, vd2m, vd3m);
+
+        l1 = lerp8(t1, l1, l2);
+        l3 = lerp8(t1, l3, l4);
+        l5 = lerp8(t1, l5, l6);
+        l7 = lerp8(t1, l7, l8);
+        l1 = lerp8(vt2, l1, l3);
+        l5 = lerp8(vt2, l5, l7);
+        l1 = lerp8(vt3, l1, l5);
+
+        // the cases of getOceanType(), in reverse order of precedence
+        r = _mm512_set1_epi64(ocean);
+        r = _mm512_mask_mov_epi64(r, _mm512_cmp_pd_mask(l1, _mm512_set1_pd(-0.2), _CMP_LT_OQ),
+                _mm512_set1_epi64(cold_ocean));
+        r = _mm512_mask_mov_epi64(r, _mm512_cmp_pd_mask(l1, _mm512_set1_pd(-0.4), _CMP_LT_OQ),
+                _mm512_set1_epi64(frozen_ocean));
+        r = _mm512_mask_mov_epi64(r, _mm512_cmp_pd_mask(l1, _mm512_set1_pd(0.2), _CMP_GT_OQ),
+                _mm512_set1_epi64(lukewarm_ocean));
+        r = _mm512_mask_mov_epi64(r, _mm512_cmp_pd_mask(l1, _mm512_set1_pd(0.4), _CMP_GT_OQ),
+                _mm512_set1_epi64(warm_ocean));
+        _mm256_storeu_si256((__m256i*)(row + i), _mm512_cvtepi64_epi32(r));
+    }
+
+    return i;
+}
+
+#endif // SIMD_DISPATCH
+
+void mapOceanTemp(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+{
+    int x, z;
+    OceanRnd *rnd = l->oceanRnd;
+
+    for (z = 0; z < areaHeight; z++)
+    {
+        x = 0;
+#ifdef SIMD_DISPATCH
+        if (simdLevel >= SIMD_AVX512)
+            x = oceanTypeRowAVX512(rnd, out + z*areaWidth, areaX, areaZ + z, areaWidth);
+#endif
+        for (; x < areaWidth; x++)
+        {
+            out[x + z*areaWidth] = getOceanType(rnd, x + areaX, z + areaZ);
+        }
+    }
+}
+
+/* Ocean type of an oceanic entry of the land layer that is not next to land. */
+static inline int getDeepMix(int landID, int oceanID)
+{
+    if (landID == deep_ocean)
+    {
+        switch (oceanID)
+        {
+        case lukewarm_ocean:
+            return deep_lukewarm_ocean;
+        case ocean:
+            return deep_ocean;
+        case cold_ocean:
+            return deep_cold_ocean;
+        case frozen_ocean:
+            return deep_frozen_ocean;
+        }
+    }
+    return oceanID;
+}
+
+/* Only warm and frozen oceans change next to land, namely when any of the
+ * land entries at the offsets {-8,-4,0,4,8}^2 is not oceanic. This test is
+ * separable: a row pass marks the columns with land at the horizontal
+ * offsets, and the output rows combine five of these rows.
+ */
+void mapOceanMix(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+{
+    int landX = areaX-8, landZ = areaZ-8;
+    int landWidth = areaWidth+16, landHeight = areaHeight+16;
+    LayerView pv, pv2;
+
+    if (l->p2 == NULL)
+    {
+        printf("mapOceanMix() requires two parents! Use setupMultiLayer()\n");
+        exit(1);
+    }
+
+    requestArea(l->p, &pv, landX, landZ, landWidth, landHeight);
+    requestArea(l->p2, &pv2, areaX, areaZ, areaWidth, areaHeight);
+    const int *map1 = pv.data, *map2 = pv2.data;
+    const int stride1 = pv.stride, stride2 = pv2.stride;
+
+    int x, z;
+    int *buf = NULL;
+    unsigned char *rows = NULL;
+
+    // uniform oceans have no land in range
+    int uniform = isUniformArea(&pv, landWidth, landHeight);
+
+    if (uniform && (!isOceanic(map1[0]) || isUniformArea(&pv2, areaWidth, areaHeight)))
+    {
+        fillArea(out, areaWidth, isOceanic(map1[0]) ? getDeepMix(map1[0], map2[0]) : map1[0],
+                areaWidth, areaHeight);
+        releaseArea(l->p2, &pv2);
+        releaseArea(l->p, &pv);
+        return;
+    }
+
+    for (z = 0; z < areaHeight && rows == NULL && !uniform; z++)
+    {
+        for (x = 0; x < areaWidth; x++)
+        {
+            int oceanID = map2[x + z*stride2];
+            if (oceanID == warm_ocean || oceanID == frozen_ocean)
+            {
+                // land proximity is needed: horizontal pass over all rows
+                buf = allocScratch(l, ((size_t)landHeight * areaWidth + landWidth + 3) / 4);
+                rows = (unsigned char *) buf;
+                break;
+            }
+        }
+    }
+
+    if (rows != NULL)
+    {
+        unsigned char *land = rows + (size_t)landHeight * areaWidth;
+
+        for (z = 0; z < landHeight; z++)
+        {
+            const int *in = map1 + (size_t)z*stride1;
+            unsigned char *row = rows + (size_t)z*areaWidth;
+
+            for (x = 0; x < landWidth; x++)
+                land[x] = !isOceanic(in[x]);
+            for (x = 0; x < areaWidth; x++)
+                row[x] = land[x] | land[x+4] | land[x+8] | land[x+12] | land[x+16];
+        }
+    }
+
+    for (z = 0; z < areaHeight; z++)
+    {
+        // proximity rows of the land offsets -8, -4, 0, 4 and 8
+        const unsigned char *r0 = rows != NULL ? rows + (size_t)z*areaWidth : NULL;
+        const size_t s4 = 4 * (size_t)areaWidth;
+
+        for (x = 0; x < areaWidth; x++)
+        {
+            int landID = map1[(x+8) + (z+8)*stride1];
+            int oceanID = map2[x + z*stride2];
+
+            if (!isOceanic(landID))
+            {
+                out[x + z*areaWidth] = landID;
+            }
+            else if ((oceanID == warm_ocean || oceanID == frozen_ocean) && r0 != NULL &&
+                (r0[x] | r0[x+s4] | r0[x+2*s4] | r0[x+3*s4] | r0[x+4*s4]))
+            {
+                out[x + z*areaWidth] = oceanID == warm_ocean ? lukewarm_ocean : cold_ocean;
+            }
+            else
+            {
+                out[x + z*areaWidth] = getDeepMix(landID, oceanID);
+            }
+        }
+    }
+
+    if (buf != NULL)
+        freeScratch(l, buf);
+    releaseArea(l->p2, &pv2);
+    releaseArea(l->p, &pv);
+}
+
+
+
+/* Draws the two random values r in [0, 1024) of the voronoi corner at the
+ * parent entry (x,z), which offset it by (r / 1024 - 0.5) * 3.6 in x and z.
+ */
+static inline void getVoronoiJitter(int64_t ss, int64_t ws, int x, int z, int *r)
+{
+    int64_t cs = getChunkSeed(ss, x << 2, z << 2);
+    r[0] = (int)((cs >> 24) & 1023);
+    cs *= cs * 6364136223846793005LL + 1442695040888963407LL;
+    cs += ws;
+    r[1] = (int)((cs >> 24) & 1023);
+}
+
+/* Chooses the corner (0: a, 1: b, 2: c, 3: d) that is closest to the entry
+ * (i,j) of the cell with the jitters 'ra', 'rb', 'rc' and 'rd', in double
+ * precision as in the original voronoi zoom.
+ */
+static int getVoronoiCornerDouble(const int *ra, const int *rb, const int *rc, const int *rd, int i, int j)
+{
+    double da1 = (ra[0] / 1024.0 - 0.5) * 3.6;
+    double da2 = (ra[1] / 1024.0 - 0.5) * 3.6;
+    double db1 = (rb[0] / 1024.0 - 0.5) * 3.6 + 4.0;
+    double db2 = (rb[1] / 1024.0 - 0.5) * 3.6;
+    double dc1 = (rc[0] / 1024.0 - 0.5) * 3.6;
+    double dc2 = (rc[1] / 1024.0 - 0.5) * 3.6 + 4.0;
+    double dd1 = (rd[0] / 1024.0 - 0.5) * 3.6 + 4.0;
+    double dd2 = (rd[1] / 1024.0 - 0.5) * 3.6 + 4.0;
+
+    double da = (j-da2)*(j-da2) + (i-da1)*(i-da1);
+    double db = (j-db2)*(j-db2) + (i-db1)*(i-db1);
+    double dc = (j-dc2)*(j-dc2) + (i-dc1)*(i-dc1);
+    double dd = (j-dd2)*(j-dd2) + (i-dd1)*(i-dd1);
+
+    if (da < db && da < dc && da < dd)
+        return 0;
+    else if (db < da && db < dc && db < dd)
+        return 1;
+    else if (dc < da && dc < db && dc < dd)
+        return 2;
+    else
+        return 3;
+}
+
+/* The jitters are multiples of 3.6 / 1024 = 9 / 2560, which makes the squared
+ * distances, scaled by 2560^2, exact integers below 2^31. Rounding in double
+ * precision never reverses the order of two different distances, but it does
+ * break exact ties, so only those have to be decided in double precision.
+ */
+static inline int voronoiDist(int i, int j, const int *r)
+{
+    int dx = 2560*i - 9*(r[0] - 512);
+    int dz = 2560*j - 9*(r[1] - 512);
+    return dx*dx + dz*dz;
+}
+
+static inline int getVoronoiCorner(const int *ra, const int *rb, const int *rc, const int *rd, int i, int j)
+{
+    int da = voronoiDist(i, j, ra);
+    int db = voronoiDist(i-4, j, rb);
+    int dc = voronoiDist(i, j-4, rc);
+    int dd = voronoiDist(i-4, j-4, rd);
+
+    if (da == db || da == dc || da == dd || db == dc || db == dd || dc == dd)
+        return getVoronoiCornerDouble(ra, rb, rc, rd, i, j);
+
+    if (da < db && da < dc && da < dd)
+        return 0;
+    else if (db < dc && db < dd)
+        return 1;
+    else if (dc < dd)
+        return 2;
+    else
+        return 3;
+}
+
+#ifdef SIMD_DISPATCH
+
+/* Fills the 4x4 entries of a voronoi cell, with the 16 integer distance tests
+ * of each corner in one vector.
+ */
+SIMD_AVX512_FUNC
+static void voronoiCellAVX512(int *cell, const int *ra, const int *rb, const int *rc, const int *rd,
+        const int *v)
+{
+    const __m512i is = _mm512_setr_epi32(0, 2560, 5120, 7680, 0, 2560, 5120, 7680,
+            0, 2560, 5120, 7680, 0, 2560, 5120, 7680);
+    const __m512i js = _mm512_setr_epi32(0, 0, 0, 0, 2560, 2560, 2560, 2560,
+            5120, 5120, 5120, 5120, 7680, 7680, 7680, 7680);
+    const __m512i ia = _mm512_sub_epi32(is, _mm512_set1_epi32(9*(ra[0] - 512)));
+    const __m512i ja = _mm512_sub_epi32(js, _mm512_set1_epi32(9*(ra[1] - 512)));
+    const __m512i ib = _mm512_sub_epi32(is, _mm512_set1_epi32(9*(rb[0] - 512) + 4*2560));
+    const __m512i jb = _mm512_sub_epi32(js, _mm512_set1_epi32(9*(rb[1] - 512)));
+    const __m512i ic = _mm512_sub_epi32(is, _mm512_set1_epi32(9*(rc[0] - 512)));
+    const __m512i jc = _mm512_sub_epi32(js, _mm512_set1_epi32(9*(rc[1] - 512) + 4*2560));
+    const __m512i id = _mm512_sub_epi32(is, _mm512_set1_epi32(9*(rd[0] - 512) + 4*2560));
+    const __m512i jd = _mm512_sub_epi32(js, _mm512_set1_epi32(9*(rd[1] - 512) + 4*2560));
+    __m512i da, db, dc, dd, res;
+    __mmask16 ma, mb, mc, tie;
+    int k;
+
+    da = _mm512_add_epi32(_mm512_mullo_epi32(ia, ia), _mm512_mullo_epi32(ja, ja));
+    db = _mm512_add_epi32(_mm512_mullo_epi32(ib, ib), _mm512_mullo_epi32(jb, jb));
+    dc = _mm512_add_epi32(_mm512_mullo_epi32(ic, ic), _mm512_mullo_epi32(jc, jc));
+    dd = _mm512_add_epi32(_mm512_mullo_epi32(id, id), _mm512_mullo_epi32(jd, jd));
+
+    ma = _mm512_cmplt_epi32_mask(da, db) & _mm512_cmplt_epi32_mask(da, dc) & _mm512_cmplt_epi32_mask(da, dd);
+    mb = _mm512_cmplt_epi32_mask(db, dc) & _mm512_cmplt_epi32_mask(db, dd) & ~ma;
+    mc = _mm512_cmplt_epi32_mask(dc, dd) & ~(ma | mb);
+    tie = _mm512_cmpeq_epi32_mask(da, db) | _mm512_cmpeq_epi32_mask(da, dc) |
+          _mm512_cmpeq_epi32_mask(da, dd) | _mm512_cmpeq_epi32_mask(db, dc) |
+          _mm512_cmpeq_epi32_mask(db, dd) | _mm512_cmpeq_epi32_mask(dc, dd);
+
+    res = _mm512_set1_epi32(v[3]);
+    res = _mm512_mask_mov_epi32(res, mc, _mm512_set1_epi32(v[2]));
+    res = _mm512_mask_mov_epi32(res, mb, _mm512_set1_epi32(v[1]));
+    res = _mm512_mask_mov_epi32(res, ma, _mm512_set1_epi32(v[0]));
+    _mm512_storeu_si512(cell, res);
+
+    for (k = 0; tie; k++, tie >>= 1)
+    {
+        if (tie & 1)
+            cell[k] = v[getVoronoiCornerDouble(ra, rb, rc, rd, k & 3, k >> 2)];
+    }
+}
+
+#endif // SIMD_DISPATCH
+
+static void voronoiArea(Layer *l, int * __restrict out, size_t outStride,
+        int areaX, int areaZ, int areaWidth, int areaHeight)
+{
+    areaX -= 2;
+    areaZ -= 2;
+    int pX = areaX >> 2;
+    int pZ = areaZ >> 2;
+    int pWidth = ((areaX + areaWidth - 1) >> 2) - pX + 2;
+    int pHeight = ((areaZ + areaHeight - 1) >> 2) - pZ + 2;
+    int x, z, i, j, k;
+    LayerView pv;
+
+    requestArea(l->p, &pv, pX, pZ, pWidth, pHeight);
+    const int *in = pv.data;
+    const int stride = pv.stride;
+
+    if (isUniformArea(&pv, pWidth, pHeight) && (in[0] & 255) == in[0])
+    {
+        fillArea(out, outStride, in[0], areaWidth, areaHeight);
+        releaseArea(l->p, &pv);
+        return;
+    }
+
+    const int64_t ws = l->worldSeed;
+    const int64_t ss = ws * (ws * 6364136223846793005LL + 1442695040888963407LL);
+
+    // the jitters of the corners along the rows z and z+1, which the next row
+    // of cells takes over; they are drawn on demand, since uniform cells do
+    // not need them (negative until drawn)
+    int *jit0 = allocScratch(l, 4 * (size_t)pWidth);
+    int *jit1 = jit0 + 2*pWidth;
+    int *tmp;
+
+    for (x = 0; x < pWidth; x++)
+        jit0[2*x] = -1;
+
+    for (z = 0; z < pHeight - 1; z++)
+    {
+        const int *in0 = in + (size_t)z*stride;
+        const int *in1 = in0 + stride;
+        int v[4]; // the entries at the corners a, b, c and d
+        int cell[16];
+
+        for (x = 0; x < pWidth; x++)
+            jit1[2*x] = -1;
+
+        // the cell covers the entries starting at (x<<2, z<<2) of the zoomed
+        // grid, which is clipped to the requested area
+        int oz = (z << 2) - (areaZ & 3);
+        int j0 = oz < 0 ? -oz : 0;
+        int j1 = oz + 4 > areaHeight ? areaHeight - oz : 4;
+
+        v[0] = in0[0];
+        v[2] = in1[0];
+
+        for (x = 0; x < pWidth - 1; x++)
+        {
+            int *ra = jit0 + 2*x, *rb = ra + 2;
+            int *rc = jit1 + 2*x, *rd = rc + 2;
+
+            v[1] = in0[x+1] & 255;
+            v[3] = in1[x+1] & 255;
+
+            if (v[0] == v[1] && v[0] == v[2] && v[0] == v[3])
+            {
+                for (k = 0; k < 16; k++)
+                    cell[k] = v[0];
+            }
+            else
+            {
+                if (ra[0] < 0) getVoronoiJitter(ss, ws, x+pX, z+pZ, ra);
+                if (rb[0] < 0) getVoronoiJitter(ss, ws, x+pX+1, z+pZ, rb);
+                if (rc[0] < 0) getVoronoiJitter(ss, ws, x+pX, z+pZ+1, rc);
+                if (rd[0] < 0) getVoronoiJitter(ss, ws, x+pX+1, z+pZ+1, rd);
+#ifdef SIMD_DISPATCH
+                if (simdLevel >= SIMD_AVX512)
+                {
+                    voronoiCellAVX512(cell, ra, rb, rc, rd, v);
+                }
+                else
+#endif
+                {
+                    for (k = 0; k < 16; k++)
+                        cell[k] = v[getVoronoiCorner(ra, rb, rc, rd, k & 3, k >> 2)];
+                }
+            }
+
+            int ox = (x << 2) - (areaX & 3);
+            int i0 = ox < 0 ? -ox : 0;
+            int i1 = ox + 4 > areaWidth ? areaWidth - ox : 4;
+
+            for (j = j0; j < j1; j++)
+            {
+                int *row = out + (oz+j)*outStride + ox;
+                for (i = i0; i < i1; i++)
+                    row[i] = cell[i + 4*j];
+            }
+
+            v[0] = v[1];
+            v[2] = v[3];
+        }
+
+        tmp = jit0;
+        jit0 = jit1;
+        jit1 = tmp;
+    }
+
+    freeScratch(l, jit0 < jit1 ? jit0 : jit1);
+    releaseArea(l->p, &pv);
+}
+
+void mapVoronoiZoom(Layer *l, int * __restrict out, int areaX, int areaZ, int areaWidth, int areaHeight)
+{
+    voronoiArea(l, out, areaWidth, areaX, areaZ, areaWidth, areaHeight);
+}
+
+
+
+
+
+//==============================================================================
+// Point Queries
+//==============================================================================
+
+/* A point query evaluates the entries of the parents on demand, so that only
+ * the entries which actually influence the result are generated. Most layers
+ * only look at their neighbours for a few biomes, and zoom layers copy or pick
+ * a single parent entry in most places. Since neighbouring entries share much
+ * of their dependencies, genPoint() provides each layer with a memo that
+ * covers its planned area, in which unevaluated entries are POINT_UNSET.
+ */
+static int evalPoint(Layer *l, int x, int z)
+{
+    int v = 0;
+
+    if (l->getPoint != NULL && l->tiles == NULL)
+        v = l->getPoint(l, x, z);
+    else
+        genLayerArea(l, &v, x, z, 1, 1);
+
+    return v;
+}
+
+static inline int getPoint(Layer *l, int x, int z)
+{
+    if (l->data != NULL)
+    {
+        const unsigned int dx = x - l->areaX;
+        const unsigned int dz = z - l->areaZ;
+        if (dx < (unsigned int)l->areaW && dz < (unsigned int)l->areaH)
+        {
+            int *e = &l->data[dx + dz * l->areaW];
+            if (*e == POINT_UNSET)
+                *e = evalPoint(l, x, z);
+            return *e;
+        }
+    }
+
+    return evalPoint(l, x, z);
+}
+
+int getLayerPoint(Layer *l, int x, int z)
+{
+    return getPoint(l, x, z);
+}
+
+
+static int pointSkip(Layer *l, int x, int z)
+{
+    return getPoint(l->p, x, z);
+}
+
+static int pointIsland(Layer *l, int x, int z)
+{
+    const int64_t ws = l->worldSeed;
+    const int64_t ss = ws * (ws * 6364136223846793005LL + 1442695040888963407LL);
+
+    if (x == 0 && z == 0)
+        return 1;
+
+    return (getChunkSeed(ss, x, z) >> 24) % 10 == 0;
+}
+
+static int pointZoom(Layer *l, int x, int z)
+{
+    const int pX = x >> 1;
+    const int pZ = z >> 1;
+    const int ws = (int)l->worldSeed;
+    const int ss = ws * (ws * 1284865837 + 4150755663);
+
+    if (((x | z) & 1) == 0)
+        return getPoint(l->p, pX, pZ);
+
+    const int chunkX = pX << 1;
+    const int chunkZ = pZ << 1;
+
+    register int cs = ss;
+    cs += chunkX;
+    cs *= cs * 1284865837 + 4150755663;
+    cs += chunkZ;
+    cs *= cs * 1284865837 + 4150755663;
+    cs += chunkX;
+    cs *= cs * 1284865837 + 4150755663;
+    cs += chunkZ;
+
+    if ((x & 1) == 0)
+        return getPoint(l->p, pX, pZ + ((cs >> 24) & 1));
+
+    cs *= cs * 1284865837 + 4150755663;
+    cs += ws;
+
+    if ((z & 1) == 0)
+        return getPoint(l->p, pX + ((cs >> 24) & 1), pZ);
+
+    cs *= cs * 1284865837 + 4150755663;
+    cs += ws;
+
+    if (l->p->getMap == mapIsland)
+    {
+        const int i = (cs >> 24) & 3;
+        return getPoint(l->p, pX + (i & 1), pZ + (i >> 1));
+    }
+
+    int a  = getPoint(l->p, pX,   pZ);
+    int a1 = getPoint(l->p, pX+1, pZ);
+    int b  = getPoint(l->p, pX,   pZ+1);
+    int b1 = getPoint(l->p, pX+1, pZ+1);
+
+    if      (a1 == b  && b  == b1) return a1;
+    else if (a  == a1 && a  == b ) return a;
+    else if (a  == a1 && a  == b1) return a;
+    else if (a  == b  && a  == b1) return a;
+    else if (a  == a1 && b  != b1) return a;
+    else if (a  == b  && a1 != b1) return a;
+    else if (a  == b1 && a1 != b ) return a;
+    else if (a1 == b  && a  != b1) return a1;
+    else if (a1 == b1 && a  != b ) return a1;
+    else if (b  == b1 && a  != a1) return b;
+    else
+    {
+        const int i = (cs >> 24) & 3;
+        return i==0 ? a : i==1 ? a1 : i==2 ? b : b1;
+    }
+}
+
+static int pointAddIsland(Layer *l, int x, int z)
+{
+    const int64_t ws = l->worldSeed;
+    const int64_t ss = ws * (ws * 6364136223846793005LL + 1442695040888963407LL);
+    int v11 = getPoint(l->p, x, z);
+
+    if (v11 == 0)
+    {
+        int v00 = getPoint(l->p, x-1, z-1);
+        int v20 = getPoint(l->p, x+1, z-1);
+        int v02 = getPoint(l->p, x-1, z+1);
+        int v22 = getPoint(l->p, x+1, z+1);
+
+        if (v00 != 0 || v20 != 0 || v02 != 0 || v22 != 0)
+            return addIslandShore(getChunkSeed(ss, x, z), ws, v00, v20, v02, v22);
+    }
+    else if (v11 > 0)
+    {
+        if (getPoint(l->p, x-1, z-1) == 0 || getPoint(l->p, x+1, z-1) == 0 ||
+            getPoint(l->p, x-1, z+1) == 0 || getPoint(l->p, x+1, z+1) == 0)
+        {
+            if ((getChunkSeed(ss, x, z) >> 24) % 5 == 0)
+                return (v11 == 4) ? 4 : 0;
+        }
+    }
+
+    return v11;
+}
+
+static int pointRemoveTooMuchOcean(Layer *l, int x, int z)
+{
+    int v11 = getPoint(l->p, x, z);
+
+    if (v11 != 0 ||
+        getPoint(l->p, x, z-1) != 0 || getPoint(l->p, x+1, z) != 0 ||
+        getPoint(l->p, x-1, z) != 0 || getPoint(l->p, x, z+1) != 0)
+        return v11;
+
+    setChunkSeed(l, (int64_t)x, (int64_t)z);
+    return mcNextInt(l, 2) == 0;
+}
+
+static int pointAddSnow(Layer *l, int x, int z)
+{
+    int v11 = getPoint(l->p, x, z);
+
+    if (isShallowOcean(v11))
+        return v11;
+
+    setChunkSeed(l, (int64_t)x, (int64_t)z);
+    int r = mcNextInt(l, 6);
+
+    if (r == 0)      return 4;
+    else if (r <= 1) return 3;
+    else             return 1;
+}
+
+static int pointCoolWarm(Layer *l, int x, int z)
+{
+    int v11 = getPoint(l->p, x, z);
+    int v;
+
+    if (v11 == 1)
+    {
+        if ((v = getPoint(l->p, x, z-1)) == 3 || v == 4 ||
+            (v = getPoint(l->p, x+1, z)) == 3 || v == 4 ||
+            (v = getPoint(l->p, x-1, z)) == 3 || v == 4 ||
+            (v = getPoint(l->p, x, z+1)) == 3 || v == 4)
+            return 2;
+    }
+
+    return v11;
+}
+
+static int pointHeatIce(Layer *l, int x, int z)
+{
+    int v11 = getPoint(l->p, x, z);
+    int v;
+
+    if (v11 == 4)
+    {
+        if ((v = getPoint(l->p, x, z-1)) == 1 || v == 2 ||
+            (v = getPoint(l->p, x+1, z)) == 1 || v == 2 ||
+            (v = getPoint(l->p, x-1, z)) == 1 || v == 2 ||
+            (v = getPoint(l->p, x, z+1)) == 1 || v == 2)
+            return 3;
+    }
+
+    return v11;
+}
+
+static int pointSpecial(Layer *l, int x, int z)
+{
+    int v = getPoint(l->p, x, z);
+
+    if (v == 0)
+        return v;
+
+    setChunkSeed(l, (int64_t)x, (int64_t)z);
+    if (mcNextInt(l, 13) == 0)
+        v |= (1 + mcNextInt(l, 15)) << 8 & 0xf00;
+
+    return v;
+}
+
+static int pointAddMushroomIsland(Layer *l, int x, int z)
+{
+    int v11 = getPoint(l->p, x, z);
+
+    // surrounded by ocean?
+    if (v11 == 0 &&
+        !getPoint(l->p, x-1, z-1) && !getPoint(l->p, x+1, z-1) &&
+        !getPoint(l->p, x-1, z+1) && !getPoint(l->p, x+1, z+1))
+    {
+        setChunkSeed(l, (int64_t)x, (int64_t)z);
+        if (mcNextInt(l, 100) == 0)
+            return mushroom_fields;
+    }
+
+    return v11;
+}
+
+static int pointDeepOcean(Layer *l, int x, int z)
+{
+    int v11 = getPoint(l->p, x, z);
+
+    if (isShallowOcean(v11) &&
+        isShallowOcean(getPoint(l->p, x, z-1)) &&
+        isShallowOcean(getPoint(l->p, x+1, z)) &&
+        isShallowOcean(getPoint(l->p, x-1, z)) &&
+        isShallowOcean(getPoint(l->p, x, z+1)))
+        return getDeepOcean(v11);
+
+    return v11;
+}
+
+static int pointBiome(Layer *l, int x, int z)
+{
+    return getClimateBiome(l, getPoint(l->p, x, z), x, z, lushBiomes);
+}
+
+static int pointBiomeBE(Layer *l, int x, int z)
+{
+    return getClimateBiome(l, getPoint(l->p, x, z), x, z, lushBiomesBE);
+}
+
+static int pointAddBamboo(Layer *l, int x, int z)
+{
+    int v = getPoint(l->p, x, z);
+
+    if (v != jungle)
+        return v;
+
+    setChunkSeed(l, (int64_t)x, (int64_t)z);
+    return mcNextInt(l, 10) == 0 ? bamboo_jungle : v;
+}
+
+static int pointRiverInit(Layer *l, int x, int z)
+{
+    if (getPoint(l->p, x, z) <= 0)
+        return 0;
+
+    setChunkSeed(l, (int64_t)x, (int64_t)z);
+    return mcNextInt(l, 299999)+2;
+}
+
+static int pointBiomeEdge(Layer *l, int x, int z)
+{
+    int v11 = getPoint(l->p, x, z);
+
+    if (v11 != wooded_badlands_plateau && v11 != badlands_plateau &&
+        v11 != giant_tree_taiga && v11 != desert && v11 != swamp)
+        return v11;
+
+    int v10 = getPoint(l->p, x, z-1);
+    int v21 = getPoint(l->p, x+1, z);
+    int v01 = getPoint(l->p, x-1, z);
+    int v12 = getPoint(l->p, x, z+1);
+
+    return getBiomeEdge(v11, v10, v21, v01, v12);
+}
+
+static int getHillsPoint(Layer *l, int x, int z, int v, int a11)
+{
+    int equals = 0;
+
+    if (equalOrPlateau(getPoint(l->p, x, z-1), a11)) equals++;
+    if (equalOrPlateau(getPoint(l->p, x+1, z), a11)) equals++;
+    if (equalOrPlateau(getPoint(l->p, x-1, z), a11)) equals++;
+    if (equalOrPlateau(getPoint(l->p, x, z+1), a11)) equals++;
+
+    return equals >= 3 ? v : a11;
+}
+
+static int pointHills(Layer *l, int x, int z)
+{
+    int a11 = getPoint(l->p, x, z);
+    int b11 = getPoint(l->p2, x, z);
+    int check;
+
+    setChunkSeed(l, (int64_t)x, (int64_t)z);
+    int v = getHills(l, a11, b11, &check);
+
+    return check ? getHillsPoint(l, x, z, v, a11) : v;
+}
+
+static int pointHills113(Layer *l, int x, int z)
+{
+    int a11 = getPoint(l->p, x, z);
+    int b11 = getPoint(l->p2, x, z);
+    int check;
+
+    setChunkSeed(l, (int64_t)x, (int64_t)z);
+    int v = getHills113(l, a11, b11, &check);
+
+    return check ? getHillsPoint(l, x, z, v, a11) : v;
+}
+
+static int pointRiver(Layer *l, int x, int z)
+{
+    int v11 = reduceID(getPoint(l->p, x, z));
+
+    if (v11 == reduceID(getPoint(l->p, x-1, z)) &&
+        v11 == reduceID(getPoint(l->p, x, z-1)) &&
+        v11 == reduceID(getPoint(l->p, x+1, z)) &&
+        v11 == reduceID(getPoint(l->p, x, z+1)))
+        return -1;
+
+    return river;
+}
+
+static int pointSmooth(Layer *l, int x, int z)
+{
+    int v10 = getPoint(l->p, x, z-1);
+    int v21 = getPoint(l->p, x+1, z);
+    int v01 = getPoint(l->p, x-1, z);
+    int v12 = getPoint(l->p, x, z+1);
+
+    if (v01 == v21 && v10 == v12)
+    {
+        setChunkSeed(l, (int64_t)x, (int64_t)z);
+        return mcNextInt(l, 2) == 0 ? v01 : v10;
+    }
+    if (v10 == v12) return v10;
+    if (v01 == v21) return v01;
+
+    return getPoint(l->p, x, z);
+}
+
+static int pointRareBiome(Layer *l, int x, int z)
+{
+    int v11 = getPoint(l->p, x, z);
+
+    setChunkSeed(l, (int64_t)x, (int64_t)z);
+    if (mcNextInt(l, 57) == 0 && v11 == plains)
+        return plains + 128; // Sunflower Plains
+
+    return v11;
+}
+
+static int pointShore(Layer *l, int x, int z)
+{
+    int v11 = getPoint(l->p, x, z);
+
+    if (v11 == ocean || v11 == deep_ocean || v11 == river || v11 == swamp)
+        return v11;
+
+    int v10 = getPoint(l->p, x, z-1);
+    int v21 = getPoint(l->p, x+1, z);
+    int v01 = getPoint(l->p, x-1, z);
+    int v12 = getPoint(l->p, x, z+1);
+
+    return getShore(v11, v10, v21, v01, v12);
+}
+
+static int pointRiverMix(Layer *l, int x, int z)
+{
+    int v = getPoint(l->p, x, z); // biome chain
+
+    if (isOceanic(v))
+        return v;
+
+    int r = getPoint(l->p2, x, z); // rivers
+
+    if (r != river)
+        return v;
+    if (v == snowy_tundra)
+        return frozen_river;
+    if (v == mushroom_fields || v == mushroom_field_shore)
+        return mushroom_field_shore;
+    return r & 255;
+}
+
+static int pointOceanTemp(Layer *l, int x, int z)
+{
+    return getOceanType(l->oceanRnd, x, z);
+}
+
+static int pointOceanMix(Layer *l, int x, int z)
+{
+    int landID = getPoint(l->p, x, z);
+    int i, j;
+
+    if (!isOceanic(landID))
+        return landID;
+
+    int oceanID = getPoint(l->p2, x, z);
+
+    // only warm and frozen oceans change next to land
+    if (oceanID == warm_ocean || oceanID == frozen_ocean)
+    {
+        for (i = -8; i <= 8; i += 4)
+        {
+            for (j = -8; j <= 8; j += 4)
+            {
+                if (!isOceanic(getPoint(l->p, x+i, z+j)))
+                    return oceanID == warm_ocean ? lukewarm_ocean : cold_ocean;
+            }
+        }
+    }
+
+    return getDeepMix(landID, oceanID);
+}
+
+static int pointVoronoiZoom(Layer *l, int x, int z)
+{
+    x -= 2;
+    z -= 2;
+    const int pX = x >> 2;
+    const int pZ = z >> 2;
+    const int64_t ws = l->worldSeed;
+    const int64_t ss = ws * (ws * 6364136223846793005LL + 1442695040888963407LL);
+    int ra[2], rb[2], rc[2], rd[2];
+
+    getVoronoiJitter(ss, ws, pX, pZ, ra);
+    getVoronoiJitter(ss, ws, pX+1, pZ, rb);
+    getVoronoiJitter(ss, ws, pX, pZ+1, rc);
+    getVoronoiJitter(ss, ws, pX+1, pZ+1, rd);
+
+    // as in a 1x1 area of mapVoronoiZoom(), where only the second column of
+    // parent entries is masked
+    switch (getVoronoiCorner(ra, rb, rc, rd, x & 3, z & 3))
+    {
+    case 0:  return getPoint(l->p, pX, pZ);
+    case 1:  return getPoint(l->p, pX+1, pZ) & 255;
+    case 2:  return getPoint(l->p, pX, pZ+1);
+    default: return getPoint(l->p, pX+1, pZ+1) & 255;
+    }
+}
+
+
+/* Describes how each layer function accesses its parents, and the function
+ * that evaluates single entries of the layer. The zoom is the magnification
+ * relative to the parents, with the zoomed grid shifted by 'offset'. For zoom
+ * layers, the margin only extends to the positive side.
+ */
+static const struct
+{
+    void (*getMap)(Layer *layer, int *out, int x, int z, int w, int h);
+    int (*getPoint)(Layer *layer, int x, int z);
+    int zoom, offset, edge, edge2;
+}
+layerInfo[] =
+{
+    //  LAYER_FUNCTION          POINT_FUNCTION            ZOOM OFFSET EDGE EDGE2
+    {   mapNull,                NULL,                     1,   0,     0,   0   },
+    {   mapSkip,                pointSkip,                1,   0,     0,   0   },
+    {   mapIsland,              pointIsland,              1,   0,     0,   0   },
+    {   mapZoom,                pointZoom,                2,   0,     1,   0   },
+    {   mapAddIsland,           pointAddIsland,           1,   0,     1,   0   },
+    {   mapRemoveTooMuchOcean,  pointRemoveTooMuchOcean,  1,   0,     1,   0   },
+    {   mapAddSnow,             pointAddSnow,             1,   0,     0,   0   },
+    {   mapCoolWarm,            pointCoolWarm,            1,   0,     1,   0   },
+    {   mapHeatIce,             pointHeatIce,             1,   0,     1,   0   },
+    {   mapSpecial,             pointSpecial,             1,   0,     0,   0   },
+    {   mapAddMushroomIsland,   pointAddMushroomIsland,   1,   0,     1,   0   },
+    {   mapDeepOcean,           pointDeepOcean,           1,   0,     1,   0   },
+    {   mapBiome,               pointBiome,               1,   0,     0,   0   },
+    {   mapBiomeBE,             pointBiomeBE,             1,   0,     0,   0   },
+    {   mapAddBamboo,           pointAddBamboo,           1,   0,     0,   0   },
+    {   mapRiverInit,           pointRiverInit,           1,   0,     0,   0   },
+    {   mapBiomeEdge,           pointBiomeEdge,           1,   0,     1,   0   },
+    {   mapHills,               pointHills,               1,   0,     1,   1   },
+    {   mapHills113,            pointHills113,            1,   0,     1,   1   },
+    {   mapRiver,               pointRiver,               1,   0,     1,   0   },
+    {   mapSmooth,              pointSmooth,              1,   0,     1,   0   },
+    {   mapRareBiome,           pointRareBiome,           1,   0,     0,   0   },
+    {   mapShore,               pointShore,               1,   0,     1,   0   },
+    {   mapRiverMix,            pointRiverMix,            1,   0,     0,   0   },
+    {   mapOceanTemp,           pointOceanTemp,           1,   0,     0,   0   },
+    {   mapOceanMix,            pointOceanMix,            1,   0,     8,   0   },
+    {   mapVoronoiZoom,         pointVoronoiZoom,         4,   2,     1,   0   },
+};
+
+void setLayerInfo(Layer *l)
+{
+    int i;
+
+    l->getPoint = NULL;
+    l->zoom = 1;
+    l->offset = 0;
+    l->edge = l->edge2 = 1;
+
+    for (i = 0; i < (int)(sizeof(layerInfo) / sizeof(*layerInfo)); i++)
+    {
+        if (layerInfo[i].getMap == l->getMap)
+        {
+            l->getPoint = layerInfo[i].getPoint;
+            l->zoom = layerInfo[i].zoom;
+            l->offset = layerInfo[i].offset;
+            l->edge = layerInfo[i].edge;
+            l->edge2 = layerInfo[i].edge2;
+            return;
+        }
+    }
 }
 
 
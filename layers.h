@@ -13,23 +13,17 @@
 #define NULL ((void*)0)
 #endif
 
-#define SIMD_NOTIFY 0
-
-#if defined USE_SIMD && __AVX2__
-#include <emmintrin.h>
-#include <smmintrin.h>
+/* With USE_SIMD, the vectorised layer functions are built for several
+ * instruction set levels, of which the best one that the processor supports
+ * is selected at run time (see setSimdLevel()). This requires the target
+ * attributes of GCC or Clang on x86.
+ */
+#if defined USE_SIMD && defined __GNUC__ && (defined __x86_64__ || defined __i386__)
+#define SIMD_DISPATCH
 #include <immintrin.h>
-#if SIMD_NOTIFY
-#warning "Using AVX2 extensions."
-#endif
-#elif defined USE_SIMD && defined __SSE4_2__
-#include <emmintrin.h>
-#include <smmintrin.h>
-#if SIMD_NOTIFY
-#warning "Using SSE4.2 extensions."
-#endif
-#else
-//#warning "Using no SIMD extensions."
+#define SIMD_SSE4_2_FUNC __attribute__((target("sse4.2")))
+#define SIMD_AVX2_FUNC __attribute__((target("avx2")))
+#define SIMD_AVX512_FUNC __attribute__((target("avx512f,avx512dq")))
 #endif
 
 #define STRUCT(S) typedef struct S S; struct S
@@ -159,6 +153,46 @@ STRUCT(OceanRnd)
 {
     int d[512];
     double a, b, c;
+    int64_t seed;       // lower 48 bits of the world seed of the data
+    int init;           // has the data been initialised for 'seed'?
+};
+
+/* Scratch memory that the layers of a generator draw their temporary buffers
+ * from. Buffers are taken and released in stack order; genArea() plans the
+ * size of each request and grows the arena ahead of time when necessary.
+ */
+STRUCT(LayerArena)
+{
+    int *mem;
+    size_t size;        // capacity in ints
+    size_t used;        // ints in use
+};
+
+/* Bounded cache of generated tiles for the layers that opt in to it. The tiles
+ * are keyed by the layer, its world seed and the tile coordinates, and are
+ * replaced in least-recently-used order within sets of TILE_WAYS slots.
+ */
+enum { TILE_WAYS = 4 };
+
+STRUCT(TileSlot)
+{
+    const struct Layer *layer;
+    int64_t seed;
+    int x, z;
+    unsigned int epoch; // slot is valid if this matches the cache epoch
+    unsigned int stamp; // time of last use
+};
+
+STRUCT(TileCache)
+{
+    int tileShift;      // tiles are (1 << tileShift) entries wide
+    int setCnt;         // number of sets of TILE_WAYS slots
+    unsigned int epoch; // incremented to invalidate all tiles
+    unsigned int epoch48; // likewise for tiles that depend on 48 seed bits
+    int64_t seed;       // world seed of the last applySeed()
+    unsigned int clock;
+    TileSlot *slots;
+    int *data;          // tile contents of each slot
 };
 
 STRUCT(Layer)
@@ -175,8 +209,42 @@ STRUCT(Layer)
     void (*getMap)(Layer *layer, int *out, int x, int z, int w, int h);
 
     Layer *p, *p2;      // parent layers
+
+    // How the layer function accesses the parents (see setLayerInfo()).
+    int zoom;           // magnification relative to the parents (1, 2 or 4)
+    int offset;         // offset of the zoomed grid in entries of this layer
+    int edge, edge2;    // margins required from the parents 'p' and 'p2'
+
+    // Evaluates the single entry (x,z) for point queries (may be NULL).
+    int (*getPoint)(Layer *layer, int x, int z);
+
+    LayerArena *arena;  // scratch memory (may be NULL)
+    TileCache *tiles;   // tile cache, if the layer has opted in (may be NULL)
+
+    // State of the current generation request (maintained by the generator).
+    // The layers are generated parents first, each into a buffer that covers
+    // exactly the union of the areas requested by its children. The buffer
+    // is reused by later layers once all the children have been generated.
+    // For point queries, the buffer is instead a memo of evaluated entries.
+    int *data;          // generated area of the layer
+    int areaX, areaZ, areaW, areaH; // planned area (areaW == 0: not planned)
+    int valid;          // does 'data' currently hold the planned area?
+    int refs;           // pending references during graph traversals
+    int slot;           // buffer assigned to the layer by the plan
+    Layer *next;        // next layer in the order of generation
+};
+
+/* Read-only view of an area of a layer, as obtained by requestArea(). */
+STRUCT(LayerView)
+{
+    const int *data;    // entry (x,z) of the area is at data[x + z*stride]
+    int stride;
+    int *buf;           // scratch buffer that holds the area (may be NULL)
 };
 
+/* Marks the entries of a point query memo that have not been evaluated. */
+enum { POINT_UNSET = -0x7f7f7f80 }; // all bytes are 0x80
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -192,9 +260,100 @@ extern Biome biomes[256];
 /* initBiomes() has to be called before any of the generators can be used */
 void initBiomes();
 
-/* Applies the given world seed to the layer and all dependent layers. */
+/* Instruction set levels of the vectorised layer functions. */
+enum SimdLevel
+{
+    SIMD_NONE, SIMD_SSE4_2, SIMD_AVX2, SIMD_AVX512,
+    SIMD_BEST
+};
+
+/* Limits the vectorised layer functions to the given instruction set level,
+ * for instance to compare the performance of the levels. The level is capped
+ * to what the processor and the build support, and this effective level is
+ * returned. initBiomes() selects the best available level.
+ */
+int setSimdLevel(int level);
+int getSimdLevel();
+
+/* Applies the given world seed to the layer and all dependent layers.
+ * Layers that are shared between several children are only seeded once.
+ * The data of the ocean temperatures (OceanRnd) only depends on the lower 48
+ * bits of the seed and is kept if these stay the same.
+ */
 void setWorldSeed(Layer *layer, int64_t seed);
 
+/* Sets the zoom and the margins of a layer according to its layer function.
+ * This is done by setupLayer() and has to be repeated when the function of a
+ * layer is replaced by one that accesses its parents differently. Unknown
+ * layer functions are assumed to be 3x3 stencils without zoom.
+ */
+void setLayerInfo(Layer *l);
+
+/* Generates the area (x,z,w,h) of a layer into 'out'. If the area is covered
+ * by the buffer that the current genArea() request has planned for the layer,
+ * it is copied from there. Layers with a tile cache assemble the area from
+ * cached tiles.
+ */
+void genLayerArea(Layer *l, int * __restrict out, int x, int z, int w, int h);
+
+/* Like genLayerArea(), but the rows of 'out' are 'stride' entries apart.
+ * The zoom layers (mapZoom and mapVoronoiZoom) write their rows in place;
+ * the other layers are generated into scratch memory and copied.
+ */
+void genLayerAreaStrided(Layer *l, int * __restrict out, size_t stride,
+        int x, int z, int w, int h);
+
+/* Provides a read-only view of the area (x,z,w,h) of a layer, which is how
+ * layers access the data of their parents. The view points directly into the
+ * planned buffer of the layer where possible. Otherwise, the area is generated
+ * into scratch memory, which is held until the view is released again with
+ * releaseArea(). Views have to be released in reverse order.
+ */
+void requestArea(Layer *l, LayerView *v, int x, int z, int w, int h);
+void releaseArea(Layer *l, LayerView *v);
+
+/* Evaluates the entry (x,z) of a layer for a point query, from only those
+ * entries of the parents that the result depends on. The entries are memoized
+ * in the buffers that genPoint() plans, where POINT_UNSET marks the entries
+ * that have not been evaluated yet. Use genPoint() rather than calling this
+ * directly, since without the memo the shared dependencies are evaluated
+ * over and over again.
+ */
+int getLayerPoint(Layer *l, int x, int z);
+
+/* Writes the first random value mcNextInt(mod) of each entry of an area for
+ * the start seed 'ss' (see getChunkSeed() and processWorldSeed()), as the
+ * layers draw it. This is often the only value that decides an entry, which
+ * lets seed filters check it without generating the parent layers.
+ */
+void genChunkInts(int64_t ss, int * __restrict out, int x, int z, int w, int h, int mod);
+
+/* Whether the layer and all its parents only hold land (1) and ocean (0), as
+ * the layers from mapIsland() to mapRemoveTooMuchOcean() do. mapAddSnow()
+ * generates such a parent as bits on demand, so the generator leaves it out
+ * of its plan.
+ */
+int hasLandBits(const Layer *l);
+
+/* Number of world seeds that the seed lanes evaluate at once. */
+enum { SEED_LANES = 8 };
+
+/* Whether the layer can be evaluated in seed lanes with mapLayerLanes(). This
+ * requires AVX-512 and is supported by the layers down to the 1:256 biomes
+ * (and the river init of those).
+ */
+int hasLayerLanes(const Layer *l);
+
+/* Evaluates the area (x,z,w,h) of a layer for the SEED_LANES world seeds
+ * 'seeds' at once, from the parent area that getParentArea() gives. The
+ * maps are interleaved, with the entry (i,j) of seeds[k] at the index
+ * (i + j*w)*SEED_LANES + k, which is also how 'in' is expected. The world
+ * seed of the layer itself is not used or changed. Returns zero, without
+ * writing anything, if the layer has no seed lanes (see hasLayerLanes()).
+ */
+int mapLayerLanes(Layer *l, const int64_t *seeds, int * __restrict out, const int *in,
+        int x, int z, int w, int h);
+
 
 //==============================================================================
 // Static Helpers
@@ -300,6 +459,56 @@ static inline int mcNextInt(Layer *layer, int mod)
 
 
 
+/* Takes a temporary buffer of 'n' ints from the scratch arena of the layer,
+ * falling back to the heap if there is no arena or it is exhausted. Buffers
+ * have to be released with freeScratch() in reverse order of allocation.
+ */
+static inline int *allocScratch(Layer *l, size_t n)
+{
+    LayerArena *a = l->arena;
+    if (a != NULL && n > 0 && a->used + n <= a->size)
+    {
+        int *buf = a->mem + a->used;
+        a->used += n;
+        return buf;
+    }
+    return (int *) malloc(n * sizeof(int));
+}
+
+static inline void freeScratch(Layer *l, int *buf)
+{
+    LayerArena *a = l->arena;
+    if (a != NULL && buf >= a->mem && buf < a->mem + a->size)
+        a->used = buf - a->mem;
+    else
+        free(buf);
+}
+
+/* Transforms the area (x,z,w,h) of a layer into the area that it requires
+ * from a parent with the margin 'edge' (i.e. l->edge or l->edge2).
+ */
+static inline void getParentArea(const Layer *l, int edge, int *x, int *z, int *w, int *h)
+{
+    if (l->zoom == 1)
+    {
+        *x -= edge;
+        *z -= edge;
+        *w += 2*edge;
+        *h += 2*edge;
+    }
+    else
+    {
+        const int s = l->zoom == 4 ? 2 : 1;
+        int x0 = (*x - l->offset) >> s;
+        int z0 = (*z - l->offset) >> s;
+        *w = ((*x - l->offset + *w - 1) >> s) - x0 + 1 + edge;
+        *h = ((*z - l->offset + *h - 1) >> s) - z0 + 1 + edge;
+        *x = x0;
+        *z = z0;
+    }
+}
+
+
 static inline int64_t processWorldSeed(register int64_t ws, const int64_t bs)
 {
     ws *= ws * 6364136223846793005LL + 1442695040888963407LL;
@@ -339,6 +548,63 @@ static inline void setChunkSeed(Layer *layer, int64_t chunkX, int64_t chunkZ)
     layer->chunkSeed += chunkZ;
 }
 
+/* For a fixed z, the chunk seed getChunkSeed(ss, x, z) is a polynomial of
+ * degree 8 in x. The seeds along a row are therefore stepped with a table of
+ * forward differences: eight independent additions per entry, rather than
+ * four dependent multiply-add rounds, and with identical results. The row
+ * starts at 'x' and advances by 'dx' with each nextChunkSeedRow(). Rows of
+ * fewer than CHUNK_ROW_MIN entries 'n' do not amortise the table and evaluate
+ * the seeds that are used directly.
+ */
+enum { CHUNK_ROW_MIN = 24 };
+
+typedef struct
+{
+    int64_t d[9];
+    int64_t ss, x, z, dx;
+    int direct;
+} ChunkSeedRow;
+
+static inline void initChunkSeedRow(ChunkSeedRow *r, int64_t ss, int64_t x, int64_t z, int64_t dx, int n)
+{
+    int i, j;
+    r->ss = ss;
+    r->x = x;
+    r->z = z;
+    r->dx = dx;
+    r->direct = n < CHUNK_ROW_MIN;
+    if (r->direct)
+        return;
+    for (i = 0; i < 9; i++)
+        r->d[i] = getChunkSeed(ss, x + i*dx, z);
+    for (i = 1; i < 9; i++)
+        for (j = 8; j >= i; j--)
+            r->d[j] -= r->d[j-1];
+}
+
+/* The chunk seed of the current entry of the row. */
+static inline int64_t getRowChunkSeed(const ChunkSeedRow *r)
+{
+    return r->direct ? getChunkSeed(r->ss, r->x, r->z) : r->d[0];
+}
+
+static inline void nextChunkSeedRow(ChunkSeedRow *r)
+{
+    if (r->direct)
+    {
+        r->x += r->dx;
+        return;
+    }
+    r->d[0] += r->d[1];
+    r->d[1] += r->d[2];
+    r->d[2] += r->d[3];
+    r->d[3] += r->d[4];
+    r->d[4] += r->d[5];
+    r->d[5] += r->d[6];
+    r->d[6] += r->d[7];
+    r->d[7] += r->d[8];
+}
+
 static inline void setBaseSeed(Layer *layer, int64_t seed)
 {
     layer->baseSeed = seed;
@@ -354,9 +620,9 @@ static inline void setBaseSeed(Layer *layer, int64_t seed)
     layer->chunkSeed = 0;
 }
 
-#if defined USE_SIMD && __AVX2__
+#ifdef SIMD_DISPATCH
 
-static inline __m256i set8ChunkSeeds(int ws, __m256i xs, __m256i zs)
+SIMD_AVX2_FUNC static inline __m256i set8ChunkSeeds(int ws, __m256i xs, __m256i zs)
 {
     __m256i out = _mm256_set1_epi32(ws);
     __m256i mul = _mm256_set1_epi32(1284865837);
@@ -367,7 +633,7 @@ static inline __m256i set8ChunkSeeds(int ws, __m256i xs, __m256i zs)
     return _mm256_add_epi32(zs, _mm256_mullo_epi32(out, _mm256_add_epi32(add, _mm256_mullo_epi32(out, mul))));
 }
 
-static inline __m256i mc8NextInt(__m256i* cs, int ws, int mask)
+SIMD_AVX2_FUNC static inline __m256i mc8NextInt(__m256i* cs, int ws, int mask)
 {
     __m256i andm = _mm256_set1_epi32(mask);
     __m256i ret = _mm256_and_si256(andm, _mm256_srli_epi32(*cs, 24));
@@ -375,13 +641,13 @@ static inline __m256i mc8NextInt(__m256i* cs, int ws, int mask)
     return _mm256_add_epi32(ret, _mm256_and_si256(andm, _mm256_cmpgt_epi32(_mm256_set1_epi32(0), ret)));
 }
 
-static inline __m256i select8Random2(__m256i* cs, int ws, __m256i a1, __m256i a2)
+SIMD_AVX2_FUNC static inline __m256i select8Random2(__m256i* cs, int ws, __m256i a1, __m256i a2)
 {
     __m256i cmp = _mm256_cmpeq_epi32(_mm256_set1_epi32(0), mc8NextInt(cs, ws, 0x1));
     return _mm256_or_si256(_mm256_and_si256(cmp, a1), _mm256_andnot_si256(cmp, a2));
 }
 
-static inline __m256i select8Random4(__m256i* cs, int ws, __m256i a1, __m256i a2, __m256i a3, __m256i a4)
+SIMD_AVX2_FUNC static inline __m256i select8Random4(__m256i* cs, int ws, __m256i a1, __m256i a2, __m256i a3, __m256i a4)
 {
     __m256i val = mc8NextInt(cs, ws, 0x3);
     __m256i v2 = _mm256_set1_epi32(2);
@@ -394,7 +660,7 @@ static inline __m256i select8Random4(__m256i* cs, int ws, __m256i a1, __m256i a2
     );
 }
 
-static inline __m256i select8ModeOrRandom(__m256i* cs, int ws, __m256i a1, __m256i a2, __m256i a3, __m256i a4)
+SIMD_AVX2_FUNC static inline __m256i select8ModeOrRandom(__m256i* cs, int ws, __m256i a1, __m256i a2, __m256i a3, __m256i a4)
 {
     __m256i cmp1 = _mm256_cmpeq_epi32(a1, a2);
     __m256i cmp2 = _mm256_cmpeq_epi32(a1, a3);
@@ -403,39 +669,23 @@ static inline __m256i select8ModeOrRandom(__m256i* cs, int ws, __m256i a1, __m25
     __m256i cmp5 = _mm256_cmpeq_epi32(a2, a4);
     __m256i cmp6 = _mm256_cmpeq_epi32(a3, a4);
     __m256i isa1 = _mm256_or_si256(
-                       _mm256_andnot_si256(cmp6, cmp1),
-                       _mm256_or_si256 (
-                           _mm256_andnot_si256(cmp5, cmp2),
-                           _mm256_andnot_si256(cmp4, cmp3)
+                       _mm256_or_si256(_mm256_and_si256(cmp1, cmp2), _mm256_and_si256(cmp1, cmp3)),
+                       _mm256_or_si256(
+                           _mm256_or_si256(_mm256_and_si256(cmp2, cmp3), _mm256_andnot_si256(cmp6, cmp1)),
+                           _mm256_or_si256(_mm256_andnot_si256(cmp5, cmp2), _mm256_andnot_si256(cmp4, cmp3))
                        )
                    );
-    __m256i isa2 = _mm256_or_si256(
-                       _mm256_andnot_si256(cmp3, cmp4),
-                       _mm256_andnot_si256(cmp2, cmp5)
-                   );
-    __m256i isa3 = _mm256_andnot_si256(cmp1, cmp6);
-
-    return _mm256_or_si256(
-        _mm256_andnot_si256(
-            _mm256_or_si256(
-                isa1,
-                _mm256_or_si256(isa2, isa3)
-            ),
-            select8Random4(cs, ws, a1, a2, a3, a4)
-        ),
-        _mm256_or_si256(
-            _mm256_and_si256(isa1, a1),
-            _mm256_or_si256(
-                _mm256_and_si256(isa2, a2),
-                _mm256_and_si256(isa3, a3)
-            )
-        )
-    );
+    __m256i ret = select8Random4(cs, ws, a1, a2, a3, a4);
+
+    // the cases of selectModeOrRandom(), in reverse order of precedence
+    ret = _mm256_blendv_epi8(ret, a3, _mm256_andnot_si256(cmp1, cmp6));
+    ret = _mm256_blendv_epi8(ret, a2, _mm256_andnot_si256(cmp2, cmp5));
+    ret = _mm256_blendv_epi8(ret, a2, _mm256_andnot_si256(cmp3, cmp4));
+    ret = _mm256_blendv_epi8(ret, a1, isa1);
+    return _mm256_blendv_epi8(ret, a2, _mm256_and_si256(cmp4, cmp6));
 }
 
-#elif defined USE_SIMD && defined __SSE4_2__
-
-static inline __m128i set4ChunkSeeds(int ws, __m128i xs, __m128i zs)
+SIMD_SSE4_2_FUNC static inline __m128i set4ChunkSeeds(int ws, __m128i xs, __m128i zs)
 {
     __m128i out = _mm_set1_epi32(ws);
     __m128i mul = _mm_set1_epi32(1284865837);
@@ -446,7 +696,7 @@ static inline __m128i set4ChunkSeeds(int ws, __m128i xs, __m128i zs)
     return _mm_add_epi32(zs, _mm_mullo_epi32(out, _mm_add_epi32(add, _mm_mullo_epi32(out, mul))));
 }
 
-static inline __m128i mc4NextInt(__m128i* cs, int ws, int mask)
+SIMD_SSE4_2_FUNC static inline __m128i mc4NextInt(__m128i* cs, int ws, int mask)
 {
     __m128i andm = _mm_set1_epi32(mask);
     __m128i ret = _mm_and_si128(andm, _mm_srli_epi32(*cs, 24));
@@ -454,13 +704,13 @@ static inline __m128i mc4NextInt(__m128i* cs, int ws, int mask)
     return _mm_add_epi32(ret, _mm_and_si128(andm, _mm_cmplt_epi32(ret, _mm_set1_epi32(0))));
 }
 
-static inline __m128i select4Random2(__m128i* cs, int ws, __m128i a1, __m128i a2)
+SIMD_SSE4_2_FUNC static inline __m128i select4Random2(__m128i* cs, int ws, __m128i a1, __m128i a2)
 {
     __m128i cmp = _mm_cmpeq_epi32(_mm_set1_epi32(0), mc4NextInt(cs, ws, 0x1));
     return _mm_or_si128(_mm_and_si128(cmp, a1), _mm_andnot_si128(cmp, a2));
 }
 
-static inline __m128i select4Random4(__m128i* cs, int ws, __m128i a1, __m128i a2, __m128i a3, __m128i a4)
+SIMD_SSE4_2_FUNC static inline __m128i select4Random4(__m128i* cs, int ws, __m128i a1, __m128i a2, __m128i a3, __m128i a4)
 {
     __m128i val = mc4NextInt(cs, ws, 0x3);
     __m128i v2 = _mm_set1_epi32(2);
@@ -473,9 +723,8 @@ static inline __m128i select4Random4(__m128i* cs, int ws, __m128i a1, __m128i a2
     );
 }
 
-static inline __m128i select4ModeOrRandom(__m128i* cs, int ws, __m128i a1, __m128i a2, __m128i a3, __m128i a4)
+SIMD_SSE4_2_FUNC static inline __m128i select4ModeOrRandom(__m128i* cs, int ws, __m128i a1, __m128i a2, __m128i a3, __m128i a4)
 {
-    //((a == b)&(c != d) | (a == c)&(b != d) | (a == d)&(b != c))&a | ((b == c)&(a != d) | (b == d)&(a != c))&b | ((c == d)&(a != b))&c
     __m128i cmp1 = _mm_cmpeq_epi32(a1, a2);
     __m128i cmp2 = _mm_cmpeq_epi32(a1, a3);
     __m128i cmp3 = _mm_cmpeq_epi32(a1, a4);
@@ -483,36 +732,119 @@ static inline __m128i select4ModeOrRandom(__m128i* cs, int ws, __m128i a1, __m12
     __m128i cmp5 = _mm_cmpeq_epi32(a2, a4);
     __m128i cmp6 = _mm_cmpeq_epi32(a3, a4);
     __m128i isa1 = _mm_or_si128(
-                       _mm_andnot_si128(cmp6, cmp1),
-                       _mm_or_si128 (
-                           _mm_andnot_si128(cmp5, cmp2),
-                           _mm_andnot_si128(cmp4, cmp3)
+                       _mm_or_si128(_mm_and_si128(cmp1, cmp2), _mm_and_si128(cmp1, cmp3)),
+                       _mm_or_si128(
+                           _mm_or_si128(_mm_and_si128(cmp2, cmp3), _mm_andnot_si128(cmp6, cmp1)),
+                           _mm_or_si128(_mm_andnot_si128(cmp5, cmp2), _mm_andnot_si128(cmp4, cmp3))
                        )
                    );
-    __m128i isa2 = _mm_or_si128(
-                       _mm_andnot_si128(cmp3, cmp4),
-                       _mm_andnot_si128(cmp2, cmp5)
-                   );
-    __m128i isa3 = _mm_andnot_si128(cmp1, cmp6);
-    return _mm_or_si128(
-        _mm_andnot_si128(
-            _mm_or_si128(
-                isa1,
-                _mm_or_si128(isa2, isa3)
-            ),
-            select4Random4(cs, ws, a1, a2, a3, a4)
-        ),
-        _mm_or_si128(
-            _mm_and_si128(isa1, a1),
-            _mm_or_si128(
-                _mm_and_si128(isa2, a2),
-                _mm_and_si128(isa3, a3)
-            )
-        )
-    );
+    __m128i ret = select4Random4(cs, ws, a1, a2, a3, a4);
+
+    // the cases of selectModeOrRandom(), in reverse order of precedence
+    ret = _mm_blendv_epi8(ret, a3, _mm_andnot_si128(cmp1, cmp6));
+    ret = _mm_blendv_epi8(ret, a2, _mm_andnot_si128(cmp2, cmp5));
+    ret = _mm_blendv_epi8(ret, a2, _mm_andnot_si128(cmp3, cmp4));
+    ret = _mm_blendv_epi8(ret, a1, isa1);
+    return _mm_blendv_epi8(ret, a2, _mm_and_si128(cmp4, cmp6));
+}
+
+SIMD_AVX512_FUNC static inline __m512i set16ChunkSeeds(int ws, __m512i xs, __m512i zs)
+{
+    __m512i out = _mm512_set1_epi32(ws);
+    __m512i mul = _mm512_set1_epi32(1284865837);
+    __m512i add = _mm512_set1_epi32(4150755663);
+    out = _mm512_add_epi32(xs, _mm512_mullo_epi32(out, _mm512_add_epi32(add, _mm512_mullo_epi32(out, mul))));
+    out = _mm512_add_epi32(zs, _mm512_mullo_epi32(out, _mm512_add_epi32(add, _mm512_mullo_epi32(out, mul))));
+    out = _mm512_add_epi32(xs, _mm512_mullo_epi32(out, _mm512_add_epi32(add, _mm512_mullo_epi32(out, mul))));
+    return _mm512_add_epi32(zs, _mm512_mullo_epi32(out, _mm512_add_epi32(add, _mm512_mullo_epi32(out, mul))));
 }
 
-#else
+SIMD_AVX512_FUNC static inline __m512i mc16NextInt(__m512i* cs, int ws, int mask)
+{
+    // the logical shift leaves no negative results to correct
+    __m512i ret = _mm512_and_si512(_mm512_set1_epi32(mask), _mm512_srli_epi32(*cs, 24));
+    *cs = _mm512_add_epi32(_mm512_set1_epi32(ws), _mm512_mullo_epi32(*cs, _mm512_add_epi32(_mm512_set1_epi32(4150755663), _mm512_mullo_epi32(*cs, _mm512_set1_epi32(1284865837)))));
+    return ret;
+}
+
+SIMD_AVX512_FUNC static inline __m512i select16Random2(__m512i* cs, int ws, __m512i a1, __m512i a2)
+{
+    __m512i val = mc16NextInt(cs, ws, 0x1);
+    return _mm512_mask_blend_epi32(_mm512_test_epi32_mask(val, val), a1, a2);
+}
+
+SIMD_AVX512_FUNC static inline __m512i select16Random4(__m512i* cs, int ws, __m512i a1, __m512i a2, __m512i a3, __m512i a4)
+{
+    __m512i val = mc16NextInt(cs, ws, 0x3);
+    __m512i ret = _mm512_mask_blend_epi32(_mm512_cmpeq_epi32_mask(val, _mm512_set1_epi32(1)), a1, a2);
+    ret = _mm512_mask_blend_epi32(_mm512_cmpeq_epi32_mask(val, _mm512_set1_epi32(2)), ret, a3);
+    return _mm512_mask_blend_epi32(_mm512_cmpeq_epi32_mask(val, _mm512_set1_epi32(3)), ret, a4);
+}
+
+SIMD_AVX512_FUNC static inline __m512i select16ModeOrRandom(__m512i* cs, int ws, __m512i a1, __m512i a2, __m512i a3, __m512i a4)
+{
+    __mmask16 cmp1 = _mm512_cmpeq_epi32_mask(a1, a2);
+    __mmask16 cmp2 = _mm512_cmpeq_epi32_mask(a1, a3);
+    __mmask16 cmp3 = _mm512_cmpeq_epi32_mask(a1, a4);
+    __mmask16 cmp4 = _mm512_cmpeq_epi32_mask(a2, a3);
+    __mmask16 cmp5 = _mm512_cmpeq_epi32_mask(a2, a4);
+    __mmask16 cmp6 = _mm512_cmpeq_epi32_mask(a3, a4);
+    __mmask16 isa1 = (cmp1 & cmp2) | (cmp1 & cmp3) | (cmp2 & cmp3) |
+                     (cmp1 & ~cmp6) | (cmp2 & ~cmp5) | (cmp3 & ~cmp4);
+    __m512i ret = select16Random4(cs, ws, a1, a2, a3, a4);
+
+    // the cases of selectModeOrRandom(), in reverse order of precedence
+    ret = _mm512_mask_blend_epi32(cmp6 & ~cmp1, ret, a3);
+    ret = _mm512_mask_blend_epi32(cmp5 & ~cmp2, ret, a2);
+    ret = _mm512_mask_blend_epi32(cmp4 & ~cmp3, ret, a2);
+    ret = _mm512_mask_blend_epi32(isa1, ret, a1);
+    return _mm512_mask_blend_epi32(cmp4 & cmp6, ret, a2);
+}
+
+/* The full 64-bit chunk seeds of 8 entries, see getChunkSeed(). */
+SIMD_AVX512_FUNC static inline __m512i set8ChunkSeeds64(__m512i ss, __m512i xs, __m512i zs)
+{
+    const __m512i mul = _mm512_set1_epi64(6364136223846793005LL);
+    const __m512i add = _mm512_set1_epi64(1442695040888963407LL);
+    __m512i cs = _mm512_add_epi64(ss, xs);
+    cs = _mm512_add_epi64(zs, _mm512_mullo_epi64(cs, _mm512_add_epi64(add, _mm512_mullo_epi64(cs, mul))));
+    cs = _mm512_add_epi64(xs, _mm512_mullo_epi64(cs, _mm512_add_epi64(add, _mm512_mullo_epi64(cs, mul))));
+    return _mm512_add_epi64(zs, _mm512_mullo_epi64(cs, _mm512_add_epi64(add, _mm512_mullo_epi64(cs, mul))));
+}
+
+/* The non-negative remainders of 8 values in [-2^51, 2^51) by 'mod'. The
+ * quotient is estimated in double precision, which is exact for these values
+ * up to one unit that the correction afterwards removes.
+ */
+SIMD_AVX512_FUNC static inline __m512i mod8Int64(__m512i v, int mod)
+{
+    if ((mod & (mod-1)) == 0)
+        return _mm512_and_si512(v, _mm512_set1_epi64(mod-1));
+
+    const __m512d m = _mm512_set1_pd(mod);
+    const __m512d zero = _mm512_setzero_pd();
+    __m512d d = _mm512_cvtepi64_pd(v);
+    __m512d q = _mm512_roundscale_pd(_mm512_mul_pd(d, _mm512_set1_pd(1.0 / mod)),
+            _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+    d = _mm512_fnmadd_pd(q, m, d);
+    d = _mm512_mask_add_pd(d, _mm512_cmp_pd_mask(d, zero, _CMP_LT_OQ), d, m);
+    d = _mm512_mask_sub_pd(d, _mm512_cmp_pd_mask(d, m, _CMP_GE_OQ), d, m);
+    return _mm512_cvtpd_epi64(d);
+}
+
+/* mcNextInt() of 8 entries with the full 64-bit chunk seeds 'cs', which are
+ * advanced for the next call.
+ */
+SIMD_AVX512_FUNC static inline __m512i mc8NextInt64(__m512i *cs, __m512i ws, int mod)
+{
+    const __m512i mul = _mm512_set1_epi64(6364136223846793005LL);
+    const __m512i add = _mm512_set1_epi64(1442695040888963407LL);
+    __m512i ret = mod8Int64(_mm512_srai_epi64(*cs, 24), mod);
+    *cs = _mm512_add_epi64(ws, _mm512_mullo_epi64(*cs, _mm512_add_epi64(add, _mm512_mullo_epi64(*cs, mul))));
+    return ret;
+}
+
+#endif // SIMD_DISPATCH
 
 static inline int selectRandom2(Layer *l, int a1, int a2)
 {
@@ -544,8 +876,6 @@ static inline int selectModeOrRandom(Layer *l, int a1, int a2, int a3, int a4)
     return rndarg;
 }
 
-#endif
-
 //==============================================================================
 // Layers
 //==============================================================================
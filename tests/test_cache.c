@@ -0,0 +1,73 @@
+/* Regression tests for the buffers that callers pass to the finders.
+ * Build and run with: make test
+ * Overflows are best caught with: make test CFLAGS=-fsanitize=address
+ */
+
+#include "../finders.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+/* A filter that passes every check, such that checkForBiomes() generates the
+ * areas of all its scales into the cache. (The mushroom check always requires
+ * a mushroom island, so it is left out.)
+ */
+static BiomeFilter setupPassingFilter()
+{
+    BiomeFilter bf;
+    memset(&bf, 0, sizeof(bf));
+    bf.checkBiomePotential = 1;
+    bf.doTempCheck = 1;
+    bf.doOceanTypeCheck = 1;
+    bf.doMajorBiomeCheck = 1;
+    bf.doScale4Check = 1;
+    return bf;
+}
+
+/* checkForBiomes() on small and thin areas, with a cache from allocCache()
+ * for the requested area, must stay within that cache.
+ */
+static int testCheckForBiomesSmall()
+{
+    static const int sizes[][2] = { {1,1}, {1,2}, {3,1}, {1,17}, {5,5} };
+    LayerStack g = setupGenerator(MC_1_14);
+    BiomeFilter bf = setupPassingFilter();
+    int64_t seed;
+    int i, fails = 0;
+
+    for (i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++)
+    {
+        int w = sizes[i][0], h = sizes[i][1];
+        int *cache = allocCache(&g.layers[L_VORONOI_ZOOM_1], w, h);
+
+        for (seed = 0; seed < 16; seed++)
+        {
+            int64_t a = checkForBiomes(&g, cache, seed, -300, 1000, w, h, bf, 4);
+            int64_t b = checkForBiomes(&g, NULL, seed, -300, 1000, w, h, bf, 4);
+            if (a != 1 || b != 1)
+            {
+                printf("FAIL checkForBiomes %dx%d seed %lld: %lld %lld\n",
+                        w, h, (long long)seed, (long long)a, (long long)b);
+                fails++;
+                break;
+            }
+        }
+        free(cache);
+    }
+
+    freeGenerator(g);
+    return fails;
+}
+
+int main()
+{
+    int fails = 0;
+
+    initBiomes();
+
+    fails += testCheckForBiomesSmall();
+
+    printf("%s\n", fails ? "FAILED" : "OK");
+    return fails != 0;
+}
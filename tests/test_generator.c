@@ -0,0 +1,644 @@
+/* Tests of the generator functions against plain genArea().
+ * Build and run with: make test
+ */
+
+#include "../generator.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static const int versions[] = { MC_1_7, MC_1_12, MC_1_13, MC_1_14, MCBE };
+#define VERSION_CNT (int)(sizeof(versions) / sizeof(versions[0]))
+
+static int64_t testSeed(int i)
+{
+    return (int64_t)((uint64_t)(i + 1) * 0x9e3779b97f4a7c15ULL);
+}
+
+/* genAreaSeeds() has to match applySeed() and genArea() for every layer, with
+ * fewer seeds than it takes for the lanes as well as with enough of them.
+ * The generator is seeded beforehand, such that layers that are left out of
+ * the seeding keep a different seed.
+ */
+static int testGenAreaSeeds()
+{
+    static const int masks[] = { 0x01, 0x25, 0x3f, 0xbf, 0xff };
+    const int x = -13, z = 7, w = 9, h = 6;
+    int64_t seeds[SEED_LANES];
+    int *out = (int *) malloc(SEED_LANES * w*h * sizeof(int));
+    int *ref = (int *) malloc(w*h * sizeof(int));
+    int v, m, k, id, fails = 0;
+
+    for (k = 0; k < SEED_LANES; k++)
+        seeds[k] = testSeed(k);
+
+    for (v = 0; v < VERSION_CNT; v++)
+    {
+        LayerStack g = setupGenerator(versions[v]);
+        LayerStack r = setupGenerator(versions[v]);
+
+        for (id = 0; id < L_NUM && !fails; id++)
+        {
+            if (g.layers[id].getMap == NULL)
+                continue;
+
+            for (m = 0; m < (int)(sizeof(masks) / sizeof(masks[0])); m++)
+            {
+                applySeed(&g, -1);
+                memset(out, 0, SEED_LANES * w*h * sizeof(int));
+                genAreaSeeds(&g, id, seeds, masks[m], out, x, z, w, h);
+
+                for (k = 0; k < SEED_LANES; k++)
+                {
+                    if (!((masks[m] >> k) & 1))
+                        continue;
+                    applySeed(&r, seeds[k]);
+                    genArea(&r.layers[id], ref, x, z, w, h);
+                    if (memcmp(out + k*w*h, ref, w*h * sizeof(int)))
+                    {
+                        printf("FAIL genAreaSeeds mc %d layer %d mask 0x%02x lane %d\n",
+                                versions[v], id, masks[m], k);
+                        fails++;
+                        break;
+                    }
+                }
+            }
+        }
+
+        freeGenerator(r);
+        freeGenerator(g);
+    }
+
+    free(ref);
+    free(out);
+    return fails;
+}
+
+/* The vectorised layer functions of each instruction set level have to match
+ * the scalar ones, for every layer and for areas of odd sizes and positions.
+ */
+static int testSimdLevels()
+{
+    static const int areas[][4] = {
+        { 0, 0, 1, 1 }, { -7, 3, 5, 3 }, { 13, -29, 37, 11 },
+        { -1000003, 999983, 70, 9 }, { 250, -251, 17, 66 },
+    };
+    const int areaCnt = (int)(sizeof(areas) / sizeof(areas[0]));
+    const int size = 70 * 66;
+    int *out = (int *) malloc(size * sizeof(int));
+    int *ref = (int *) malloc(size * sizeof(int));
+    int best, level, v, s, a, id, fails = 0;
+
+    best = setSimdLevel(SIMD_BEST);
+
+    for (v = 0; v < VERSION_CNT; v++)
+    {
+        LayerStack g = setupGenerator(versions[v]);
+
+        for (s = 0; s < 3; s++)
+        {
+            applySeed(&g, testSeed(s));
+
+            for (id = 0; id < L_NUM; id++)
+            {
+                Layer *l = &g.layers[id];
+                if (l->getMap == NULL)
+                    continue;
+
+                for (a = 0; a < areaCnt; a++)
+                {
+                    const int *r = areas[a];
+                    setSimdLevel(SIMD_NONE);
+                    genArea(l, ref, r[0], r[1], r[2], r[3]);
+
+                    for (level = SIMD_SSE4_2; level <= best; level++)
+                    {
+                        setSimdLevel(level);
+                        genArea(l, out, r[0], r[1], r[2], r[3]);
+                        if (memcmp(out, ref, r[2]*r[3] * sizeof(int)))
+                        {
+                            printf("FAIL simd level %d mc %d seed %d layer %d "
+                                    "area (%d,%d) %dx%d\n", level, versions[v],
+                                    s, id, r[0], r[1], r[2], r[3]);
+                            fails++;
+                        }
+                    }
+                }
+            }
+        }
+
+        freeGenerator(g);
+    }
+
+    setSimdLevel(best);
+    free(ref);
+    free(out);
+    return fails;
+}
+
+STRUCT(RowCheck)
+{
+    const int *ref;     // the area from genArea()
+    int areaZ, w, h;
+    int next;           // the first row of the next band
+    int stop;           // row at which to stop, if any
+    int fails;
+};
+
+static int checkRows(void *data, const int *rows, int z, int rowCnt)
+{
+    RowCheck *c = (RowCheck *) data;
+
+    if (z != c->next || rowCnt < 1 || z + rowCnt > c->areaZ + c->h ||
+        memcmp(rows, c->ref + (size_t)(z - c->areaZ) * c->w,
+            (size_t)rowCnt * c->w * sizeof(int)))
+    {
+        c->fails++;
+    }
+    c->next = z + rowCnt;
+    return c->stop && c->next > c->stop ? c->stop : 0;
+}
+
+/* genAreaRows() has to pass the rows of genArea() in order, with the absolute
+ * z of the first row of each band, and stop once the callback asks for it.
+ */
+static int testGenAreaRows()
+{
+    static const int bands[] = { 1, 4, 7, 64, 1000 };
+    static const int layers[] = {
+        L_VORONOI_ZOOM_1, L_RIVER_MIX_4, L_SHORE_16, L_BIOME_256, L_ISLAND_4096
+    };
+    const int x = -71, z = -37, w = 45, h = 83;
+    int *ref = (int *) malloc(w*h * sizeof(int));
+    int v, i, b, ret, fails = 0;
+    RowCheck c;
+
+    for (v = 0; v < VERSION_CNT; v++)
+    {
+        LayerStack g = setupGenerator(versions[v]);
+        applySeed(&g, testSeed(v));
+
+        for (i = 0; i < (int)(sizeof(layers) / sizeof(layers[0])); i++)
+        {
+            Layer *l = &g.layers[layers[i]];
+            genArea(l, ref, x, z, w, h);
+
+            for (b = 0; b < (int)(sizeof(bands) / sizeof(bands[0])); b++)
+            {
+                memset(&c, 0, sizeof(c));
+                c.ref = ref;
+                c.areaZ = c.next = z;
+                c.w = w;
+                c.h = h;
+                ret = genAreaRows(l, x, z, w, h, bands[b], checkRows, &c);
+                if (ret != 0 || c.fails || c.next != z + h)
+                {
+                    printf("FAIL genAreaRows mc %d layer %d band %d\n",
+                            versions[v], layers[i], bands[b]);
+                    fails++;
+                }
+
+                // the value of the callback is passed on when it stops early
+                memset(&c, 0, sizeof(c));
+                c.ref = ref;
+                c.areaZ = c.next = z;
+                c.w = w;
+                c.h = h;
+                c.stop = z + h/2;
+                ret = genAreaRows(l, x, z, w, h, bands[b], checkRows, &c);
+                if (c.fails || ret != c.stop ||
+                    c.next <= c.stop || c.next > c.stop + bands[b])
+                {
+                    printf("FAIL genAreaRows early stop mc %d layer %d band %d\n",
+                            versions[v], layers[i], bands[b]);
+                    fails++;
+                }
+            }
+        }
+
+        freeGenerator(g);
+    }
+
+    free(ref);
+    return fails;
+}
+
+/* A graph in which the river mixes of more islands than there are buffer slots
+ * are all pending at once, so that some of the islands have no buffer and
+ * genAreaThreaded() generates the plan serially.
+ */
+static LayerStack setupDeepMix(int cnt)
+{
+    LayerStack g;
+    int i;
+
+    g.layerCnt = 2*cnt - 1;
+    g.layers = (Layer *) calloc(g.layerCnt, sizeof(Layer));
+    g.arena = (LayerArena *) calloc(1, sizeof(LayerArena));
+    g.tiles = NULL;
+
+    for (i = 0; i < cnt; i++)
+        setupLayer(4, &g.layers[i], NULL, 1 + i, mapIsland);
+    // layers[cnt+i] mixes island i into the mix of the islands above i
+    for (i = cnt-2; i >= 0; i--)
+    {
+        setupMultiLayer(4, &g.layers[cnt+i], &g.layers[i],
+                &g.layers[i == cnt-2 ? cnt-1 : cnt+i+1], 100, mapRiverMix);
+    }
+    for (i = 0; i < g.layerCnt; i++)
+        g.layers[i].arena = g.arena;
+
+    return g;
+}
+
+/* genAreaThreaded() has to match genArea() for any number of threads, also for
+ * more threads than rows and for plans that it cannot schedule.
+ */
+static int testGenAreaThreaded()
+{
+    static const int threads[] = { 1, 2, 3, 8 };
+    static const int layers[] = { L_VORONOI_ZOOM_1, L_RIVER_MIX_4, L_BIOME_256 };
+    static const int areas[][4] = {
+        { -100, -50, 300, 200 }, { 7, -3, 129, 5 }, { 0, 0, 1, 1 },
+    };
+    const int areaCnt = (int)(sizeof(areas) / sizeof(areas[0]));
+    const int size = 300 * 200;
+    int *out = (int *) malloc(size * sizeof(int));
+    int *ref = (int *) malloc(size * sizeof(int));
+    int v, i, a, t, fails = 0;
+    LayerStack g;
+
+    for (v = 0; v < VERSION_CNT; v++)
+    {
+        g = setupGenerator(versions[v]);
+        applySeed(&g, testSeed(v));
+
+        for (i = 0; i < (int)(sizeof(layers) / sizeof(layers[0])); i++)
+        {
+            for (a = 0; a < areaCnt; a++)
+            {
+                const int *r = areas[a];
+                genArea(&g.layers[layers[i]], ref, r[0], r[1], r[2], r[3]);
+
+                for (t = 0; t < (int)(sizeof(threads) / sizeof(threads[0])); t++)
+                {
+                    memset(out, 0, size * sizeof(int));
+                    genAreaThreaded(&g, layers[i], out, r[0], r[1], r[2], r[3],
+                            threads[t]);
+                    if (memcmp(out, ref, r[2]*r[3] * sizeof(int)))
+                    {
+                        printf("FAIL genAreaThreaded mc %d layer %d area %dx%d "
+                                "threads %d\n", versions[v], layers[i], r[2], r[3],
+                                threads[t]);
+                        fails++;
+                    }
+                }
+            }
+        }
+
+        freeGenerator(g);
+    }
+
+    g = setupDeepMix(24);
+    setWorldSeed(&g.layers[24], testSeed(0));
+    genArea(&g.layers[24], ref, -20, 10, 200, 150);
+    for (t = 0; t < (int)(sizeof(threads) / sizeof(threads[0])); t++)
+    {
+        memset(out, 0, size * sizeof(int));
+        genAreaThreaded(&g, 24, out, -20, 10, 200, 150, threads[t]);
+        if (memcmp(out, ref, 200*150 * sizeof(int)))
+        {
+            printf("FAIL genAreaThreaded without slots, threads %d\n", threads[t]);
+            fails++;
+        }
+    }
+    freeGenerator(g);
+
+    free(ref);
+    free(out);
+    return fails;
+}
+
+/* genPoint() has to match a 1x1 area of genArea() for every layer. */
+static int testGenPoint()
+{
+    static const int points[][2] = {
+        { 0, 0 }, { -1, -1 }, { 1023, -1024 }, { -123457, 98765 },
+        { 3000001, -2999999 },
+    };
+    int v, id, i, a, b, fails = 0;
+
+    for (v = 0; v < VERSION_CNT; v++)
+    {
+        LayerStack g = setupGenerator(versions[v]);
+        applySeed(&g, testSeed(v));
+
+        for (id = 0; id < L_NUM; id++)
+        {
+            Layer *l = &g.layers[id];
+            if (l->getMap == NULL)
+                continue;
+
+            for (i = 0; i < (int)(sizeof(points) / sizeof(points[0])); i++)
+            {
+                genArea(l, &a, points[i][0], points[i][1], 1, 1);
+                b = genPoint(l, points[i][0], points[i][1]);
+                if (a != b)
+                {
+                    printf("FAIL genPoint mc %d layer %d at (%d,%d): %d != %d\n",
+                            versions[v], id, points[i][0], points[i][1], b, a);
+                    fails++;
+                }
+            }
+        }
+
+        freeGenerator(g);
+    }
+
+    return fails;
+}
+
+/* genPoints() has to match genArea() for points that are far apart, for dense
+ * and sparse clusters, and for repeated points.
+ */
+static int testGenPoints()
+{
+    static const int layers[] = {
+        L_VORONOI_ZOOM_1, L_RIVER_MIX_4, L_SMOOTH_4, L_SHORE_16, L_BIOME_256
+    };
+    enum { N = 600 };
+    int x[N], z[N], out[N], ref;
+    int v, i, k, fails = 0;
+    uint32_t r = 12345;
+
+    for (k = 0; k < N; k++)
+    {
+        r = r * 1664525 + 1013904223;
+        if (k < 100)
+        {
+            // far apart
+            x[k] = (int)(r >> 8) - (1 << 23);
+            z[k] = (int)(r & 0xffffff) - (1 << 23);
+        }
+        else if (k < 400)
+        {
+            // a dense cluster, with repeated points
+            x[k] = -40 + (int)(r >> 28);
+            z[k] = 17 + (int)((r >> 12) & 0xf);
+        }
+        else
+        {
+            // a sparse cluster
+            x[k] = 5000 + (int)((r >> 8) % 700);
+            z[k] = -7000 + (int)(r % 700);
+        }
+    }
+
+    for (v = 0; v < VERSION_CNT; v++)
+    {
+        LayerStack g = setupGenerator(versions[v]);
+        applySeed(&g, testSeed(v));
+
+        for (i = 0; i < (int)(sizeof(layers) / sizeof(layers[0])); i++)
+        {
+            Layer *l = &g.layers[layers[i]];
+            genPoints(l, x, z, out, N);
+
+            for (k = 0; k < N; k++)
+            {
+                genArea(l, &ref, x[k], z[k], 1, 1);
+                if (out[k] != ref)
+                {
+                    printf("FAIL genPoints mc %d layer %d at (%d,%d): %d != %d\n",
+                            versions[v], layers[i], x[k], z[k], out[k], ref);
+                    fails++;
+                    break;
+                }
+            }
+        }
+
+        freeGenerator(g);
+    }
+
+    return fails;
+}
+
+/* genArea8() and genArea16() have to store the low bits of genArea() for every
+ * layer, also for areas of more than one band of rows.
+ */
+static int testGenAreaNarrow()
+{
+    static const int areas[][4] = {
+        { 0, 0, 1, 1 }, { -33, 21, 17, 9 }, { 500, -700, 301, 250 },
+    };
+    const int areaCnt = (int)(sizeof(areas) / sizeof(areas[0]));
+    const int size = 301 * 250;
+    int *ref = (int *) malloc(size * sizeof(int));
+    uint8_t *out8 = (uint8_t *) malloc(size);
+    uint16_t *out16 = (uint16_t *) malloc(size * sizeof(uint16_t));
+    int v, id, a, i, fails = 0;
+
+    for (v = 0; v < VERSION_CNT; v++)
+    {
+        LayerStack g = setupGenerator(versions[v]);
+        applySeed(&g, testSeed(v));
+
+        for (id = 0; id < L_NUM; id++)
+        {
+            Layer *l = &g.layers[id];
+            if (l->getMap == NULL)
+                continue;
+
+            for (a = 0; a < areaCnt; a++)
+            {
+                const int *r = areas[a];
+                const int n = r[2] * r[3];
+                genArea(l, ref, r[0], r[1], r[2], r[3]);
+
+                if (genArea8(l, out8, r[0], r[1], r[2], r[3]) != 0 ||
+                    genArea16(l, out16, r[0], r[1], r[2], r[3]) != 0)
+                {
+                    printf("FAIL genArea8/16 mc %d layer %d: out of memory\n",
+                            versions[v], id);
+                    fails++;
+                    continue;
+                }
+
+                for (i = 0; i < n; i++)
+                {
+                    if (out8[i] != (uint8_t)ref[i] || out16[i] != (uint16_t)ref[i])
+                    {
+                        printf("FAIL genArea8/16 mc %d layer %d area %dx%d\n",
+                                versions[v], id, r[2], r[3]);
+                        fails++;
+                        break;
+                    }
+                }
+            }
+        }
+
+        freeGenerator(g);
+    }
+
+    free(out16);
+    free(out8);
+    free(ref);
+    return fails;
+}
+
+/* genAreaStrided() has to store the rows of genArea() 'stride' entries apart
+ * and leave the entries in between untouched, for every layer.
+ */
+static int testGenAreaStrided()
+{
+    static const int areas[][5] = {
+        // x, z, w, h, stride
+        { 0, 0, 1, 1, 1 }, { -9, 4, 13, 7, 13 }, { -9, 4, 13, 7, 14 },
+        { 77, -301, 40, 33, 101 }, { -1, -1, 3, 20, 64 },
+    };
+    const int areaCnt = (int)(sizeof(areas) / sizeof(areas[0]));
+    const int size = 101 * 33;
+    const int mark = 0x5a5a5a5a;
+    int *out = (int *) malloc(size * sizeof(int));
+    int *ref = (int *) malloc(size * sizeof(int));
+    int v, id, a, i, j, bad, fails = 0;
+
+    for (v = 0; v < VERSION_CNT; v++)
+    {
+        LayerStack g = setupGenerator(versions[v]);
+        applySeed(&g, testSeed(v));
+
+        for (id = 0; id < L_NUM; id++)
+        {
+            Layer *l = &g.layers[id];
+            if (l->getMap == NULL)
+                continue;
+
+            for (a = 0; a < areaCnt; a++)
+            {
+                const int *r = areas[a];
+                const int stride = r[4];
+                genArea(l, ref, r[0], r[1], r[2], r[3]);
+
+                for (i = 0; i < size; i++)
+                    out[i] = mark;
+                genAreaStrided(l, out, stride, r[0], r[1], r[2], r[3]);
+
+                for (i = 0, bad = 0; i < size && !bad; i++)
+                {
+                    j = i % stride;
+                    if (i / stride < r[3] && j < r[2])
+                        bad = out[i] != ref[j + (i / stride) * r[2]];
+                    else
+                        bad = out[i] != mark;
+                }
+                if (bad)
+                {
+                    printf("FAIL genAreaStrided mc %d layer %d area %dx%d "
+                            "stride %d\n", versions[v], id, r[2], r[3], stride);
+                    fails++;
+                }
+            }
+        }
+
+        freeGenerator(g);
+    }
+
+    free(ref);
+    free(out);
+    return fails;
+}
+
+/* A generator with a tile cache has to give the same results as one without,
+ * while the seeds change, including seeds that only differ in the upper 16
+ * bits, for which the tiles of the ocean temperatures are kept.
+ */
+static int testTileCache()
+{
+    static const int64_t seeds[] = {
+        1, 1 + (1LL << 48), 1, -5, -5 + (7LL << 48), 1 + (1LL << 48),
+        (int64_t)0x8000000000000001ULL, 1, -5,
+    };
+    static const int layers[] = {
+        L_VORONOI_ZOOM_1, L_SHORE_16, L_BIOME_256,
+        L13_OCEAN_TEMP_256, L13_ZOOM_4, L13_OCEAN_MIX_4
+    };
+    const int w = 40, h = 30;
+    int *out = (int *) malloc(w*h * sizeof(int));
+    int *ref = (int *) malloc(w*h * sizeof(int));
+    int v, s, i, k, a, b, fails = 0;
+
+    for (v = 0; v < VERSION_CNT; v++)
+    {
+        LayerStack g = setupGenerator(versions[v]);
+        LayerStack r = setupGenerator(versions[v]);
+        const int ocean = versions[v] > MC_1_12;
+
+        // a small cache, such that tiles get evicted
+        if (!setupTileCache(&g, 4, 64) ||
+            !enableTileCache(&g, L_SHORE_16) ||
+            enableTileCache(&g, L_BIOME_256) ||
+            (ocean && !enableTileCache(&g, L13_OCEAN_TEMP_256)))
+        {
+            printf("FAIL tile cache setup mc %d\n", versions[v]);
+            fails++;
+        }
+
+        for (s = 0; s < (int)(sizeof(seeds) / sizeof(seeds[0])); s++)
+        {
+            applySeed(&g, seeds[s]);
+            applySeed(&r, seeds[s]);
+
+            for (i = 0; i < (int)(sizeof(layers) / sizeof(layers[0])); i++)
+            {
+                if (!ocean && layers[i] >= L13_OCEAN_TEMP_256 &&
+                    layers[i] <= L13_OCEAN_MIX_4)
+                    continue;
+
+                for (k = 0; k < 3; k++)
+                {
+                    const int x = -20 + 13*k - s, z = -15 + 5*k;
+                    genArea(&g.layers[layers[i]], out, x, z, w, h);
+                    genArea(&r.layers[layers[i]], ref, x, z, w, h);
+                    a = genPoint(&g.layers[layers[i]], x + k, z - k);
+                    b = genPoint(&r.layers[layers[i]], x + k, z - k);
+                    if (memcmp(out, ref, w*h * sizeof(int)) || a != b)
+                    {
+                        printf("FAIL tile cache mc %d seed %lld layer %d area (%d,%d)\n",
+                                versions[v], (long long)seeds[s], layers[i], x, z);
+                        fails++;
+                    }
+                }
+            }
+        }
+
+        freeGenerator(r);
+        freeGenerator(g);
+    }
+
+    free(ref);
+    free(out);
+    return fails;
+}
+
+int main()
+{
+    int fails = 0;
+
+    initBiomes();
+
+    fails += testGenAreaSeeds();
+    fails += testSimdLevels();
+    fails += testGenAreaRows();
+    fails += testGenAreaThreaded();
+    fails += testGenPoint();
+    fails += testGenPoints();
+    fails += testGenAreaNarrow();
+    fails += testGenAreaStrided();
+    fails += testTileCache();
+
+    printf("%s\n", fails ? "FAILED" : "OK");
+    return fails != 0;
+}
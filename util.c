@@ -126,6 +126,58 @@ void initBiomeTypeColours(unsigned char biomeColours[256][3])
 }
 
 
+/* Draws the entry (i,j) of a biome map as a square of pixscale^2 pixels and
+ * returns whether the biome ID is out of range.
+ */
+static int drawBiome(unsigned char *pixels,
+        const unsigned char biomeColours[256][3], const int id,
+        const unsigned int i, const unsigned int j,
+        const unsigned int sx, const unsigned int sy,
+        const unsigned int pixscale, const int flip)
+{
+    int invalid = 0;
+    unsigned int r, g, b;
+
+    if (id < 0 || id >= 256)
+    {
+        // This may happen for some intermediate layers
+        invalid = 1;
+        r = biomeColours[id&0x7f][0]-40; r = (r>0xff) ? 0x00 : r&0xff;
+        g = biomeColours[id&0x7f][1]-40; g = (g>0xff) ? 0x00 : g&0xff;
+        b = biomeColours[id&0x7f][2]-40; b = (b>0xff) ? 0x00 : b&0xff;
+    }
+    else
+    {
+        if (id < 128) {
+            r = biomeColours[id][0];
+            g = biomeColours[id][1];
+            b = biomeColours[id][2];
+        } else {
+            r = biomeColours[id][0]+40; r = (r>0xff) ? 0xff : r&0xff;
+            g = biomeColours[id][1]+40; g = (g>0xff) ? 0xff : g&0xff;
+            b = biomeColours[id][2]+40; b = (b>0xff) ? 0xff : b&0xff;
+        }
+    }
+
+    unsigned int m, n;
+    for (m = 0; m < pixscale; m++) {
+        for (n = 0; n < pixscale; n++) {
+            int idx = pixscale * i + n;
+            if (flip) 
+                idx += (sx * pixscale) * ((pixscale * j) + m);
+            else 
+                idx += (sx * pixscale) * ((pixscale * (sy-1-j)) + m);
+            
+            unsigned char *pix = pixels + 3*idx;
+            pix[0] = (unsigned char)r;
+            pix[1] = (unsigned char)g;
+            pix[2] = (unsigned char)b;
+        }
+    }
+
+    return invalid;
+}
+
 int biomesToImage(unsigned char *pixels, 
         const unsigned char biomeColours[256][3], const int *biomes, 
         const unsigned int sx, const unsigned int sy, 
@@ -138,51 +190,33 @@ int biomesToImage(unsigned char *pixels,
     {
         for (i = 0; i < sx; i++)
         {
-            int id = biomes[j*sx+i]; //if (id != swamp) id = 100;
-            unsigned int r, g, b;
-
-            if (id < 0 || id >= 256)
-            {
-                // This may happen for some intermediate layers
-                containsInvalidBiomes = 1;
-                r = biomeColours[id&0x7f][0]-40; r = (r>0xff) ? 0x00 : r&0xff;
-                g = biomeColours[id&0x7f][1]-40; g = (g>0xff) ? 0x00 : g&0xff;
-                b = biomeColours[id&0x7f][2]-40; b = (b>0xff) ? 0x00 : b&0xff;
-            }
-            else
-            {
-                if (id < 128) {
-                    r = biomeColours[id][0];
-                    g = biomeColours[id][1];
-                    b = biomeColours[id][2];
-                } else {
-                    r = biomeColours[id][0]+40; r = (r>0xff) ? 0xff : r&0xff;
-                    g = biomeColours[id][1]+40; g = (g>0xff) ? 0xff : g&0xff;
-                    b = biomeColours[id][2]+40; b = (b>0xff) ? 0xff : b&0xff;
-                }
-            }
-
-            unsigned int m, n;
-            for (m = 0; m < pixscale; m++) {
-                for (n = 0; n < pixscale; n++) {
-                    int idx = pixscale * i + n;
-                    if (flip) 
-                        idx += (sx * pixscale) * ((pixscale * j) + m);
-                    else 
-                        idx += (sx * pixscale) * ((pixscale * (sy-1-j)) + m);
-                    
-                    unsigned char *pix = pixels + 3*idx;
-                    pix[0] = (unsigned char)r;
-                    pix[1] = (unsigned char)g;
-                    pix[2] = (unsigned char)b;
-                }
-            }
+            containsInvalidBiomes |= drawBiome(pixels, biomeColours,
+                    biomes[j*sx+i], i, j, sx, sy, pixscale, flip);
         }
     }
 
     return containsInvalidBiomes;
 }
 
+int biomesToImage8(unsigned char *pixels, 
+        const unsigned char biomeColours[256][3], const uint8_t *biomes, 
+        const unsigned int sx, const unsigned int sy, 
+        const unsigned int pixscale, const int flip)
+{
+    unsigned int i, j;
+
+    for (j = 0; j < sy; j++)
+    {
+        for (i = 0; i < sx; i++)
+        {
+            drawBiome(pixels, biomeColours, biomes[j*sx+i],
+                    i, j, sx, sy, pixscale, flip);
+        }
+    }
+
+    return 0;
+}
+
 int savePPM(const char *path, const unsigned char *pixels, const unsigned int sx, const unsigned int sy)
 {
     FILE *fp = fopen(path, "wb");
@@ -1,6 +1,8 @@
 #ifndef UTIL_H_
 #define UTIL_H_
 
+#include <stdint.h>
+
 void initBiomeColours(unsigned char biomeColours[256][3]);
 void initBiomeTypeColours(unsigned char biomeColours[256][3]);
 
@@ -9,6 +11,14 @@ int biomesToImage(unsigned char *pixels,
         const unsigned int sx, const unsigned int sy, 
         const unsigned int pixscale, const int flip);
 
+/* Like biomesToImage() for a map of 8-bit biome IDs (see genArea8()), which
+ * are always in range.
+ */
+int biomesToImage8(unsigned char *pixels, 
+        const unsigned char biomeColours[256][3], const uint8_t *biomes, 
+        const unsigned int sx, const unsigned int sy, 
+        const unsigned int pixscale, const int flip);
+
 int savePPM(const char* path, const unsigned char *pixels, 
         const unsigned int sx, const unsigned int sy);
 